@@ -4,6 +4,8 @@
 #include <chrono>
 #include <cmath>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 #include "io.h"
 #include "roxdb/db.h"
@@ -40,35 +42,41 @@ int main(int argc, char* argv[]) {
 
   rox::DbOptions options;
   options.create_if_missing = true;
+  options.bulk_load = true;
   rox::DB db(db_path, options, schema);
 
-  // Find centroids
+  // Load dataset in bulk batches
+  constexpr const size_t kBatchSize = 10000;
   auto start = std::chrono::high_resolution_clock::now();
-  auto sift_centroids = FindCentroids(dataset.sift, n_clusters);
-  auto gist_centroids = FindCentroids(dataset.gist, n_clusters);
-  auto end = std::chrono::high_resolution_clock::now();
-  auto duration =
-      std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-  std::cout << "Clustering time: " << duration.count() << "ms" << std::endl;
-
-  db.SetCentroids("sift", sift_centroids);
-  db.SetCentroids("gist", gist_centroids);
-
-  // Load dataset
-  start = std::chrono::high_resolution_clock::now();
+  std::vector<rox::Record> batch;
+  batch.reserve(kBatchSize);
   for (int i = 0; i < n; i++) {
     rox::Record record;
+    record.id = i;
     record.vectors.push_back(dataset.sift[i]);
     record.vectors.push_back(dataset.gist[i]);
     record.scalars.emplace_back(dataset.image_id[i]);
     record.scalars.emplace_back(dataset.category[i]);
     record.scalars.emplace_back(static_cast<double>(dataset.confidence[i]));
     record.scalars.emplace_back(dataset.votes[i]);
-    db.PutRecord(i, record);
+    batch.push_back(std::move(record));
+    if (batch.size() == kBatchSize || i + 1 == n) {
+      db.PutRecords(batch);
+      batch.clear();
+    }
   }
+  auto end = std::chrono::high_resolution_clock::now();
+  auto duration =
+      std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  std::cout << "Loading time: " << duration.count() << "ms" << std::endl;
+
+  // Cluster the loaded records
+  start = std::chrono::high_resolution_clock::now();
+  db.TrainIndex("sift");
+  db.TrainIndex("gist");
   end = std::chrono::high_resolution_clock::now();
   duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-  std::cout << "Loading time: " << duration.count() << "ms" << std::endl;
+  std::cout << "Clustering time: " << duration.count() << "ms" << std::endl;
 
   std::cout << "Successfully loaded dataset" << std::endl;
 
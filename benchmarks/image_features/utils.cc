@@ -1,8 +1,5 @@
 #include "utils.h"
 
-#include <faiss/Clustering.h>
-#include <faiss/IndexFlat.h>
-
 #include <cassert>
 #include <iostream>
 #include <unordered_set>
@@ -10,42 +7,6 @@
 using rox::Float;
 using rox::Vector;
 
-auto FindCentroids(const std::vector<Vector>& vectors, size_t num_centroids)
-    -> std::vector<Vector> {
-  int n = vectors.size();
-  int d = vectors[0].size();
-
-  std::vector<float> flat_data(n * d);
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < d; j++) {
-      flat_data[(i * d) + j] = vectors[i][j];
-    }
-  }
-
-  faiss::ClusteringParameters cp;
-  cp.niter = 25;
-  cp.nredo = 5;
-
-  faiss::Clustering kmeans(d, num_centroids, cp);
-  faiss::IndexFlatL2 index(d);
-
-  kmeans.train(n, flat_data.data(), index);
-  std::vector<std::vector<float>> centroids(num_centroids,
-                                            std::vector<float>(d));
-  if (kmeans.centroids.size() == num_centroids * d) {
-    for (int i = 0; i < num_centroids; i++) {
-      for (int j = 0; j < d; j++) {
-        centroids[i][j] = kmeans.centroids[(i * d) + j];
-      }
-    }
-  } else {
-    std::cerr << "Error: Unexpected centroids size after clustering"
-              << std::endl;
-  }
-
-  return centroids;
-}
-
 auto GetDistanceL2Sq(const Vector& a, const Vector& b) -> Float {
   Float distance = 0.0;
   for (size_t i = 0; i < a.size(); ++i) {
@@ -4,9 +4,6 @@
 
 #include "roxdb/db.h"
 
-auto FindCentroids(const std::vector<rox::Vector>& vectors,
-                   size_t num_centroids) -> std::vector<rox::Vector>;
-
 auto GetDistanceL2Sq(const rox::Vector& a, const rox::Vector& b) -> rox::Float;
 
 auto AssignCentroid(const rox::Vector& v,
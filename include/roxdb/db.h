@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -12,6 +13,57 @@ namespace rox {
 
 struct DbOptions {
   bool create_if_missing = true;
+  // Offline build of a fresh database: records and index partitions are
+  // written to sorted SST files and ingested, bypassing the memtable and
+  // WAL. Bulk writes become visible on FlushRecords and on close, or when a
+  // record not ingested yet is deleted.
+  bool bulk_load = false;
+  // Memory budget of the cache of deserialized records, filled by record
+  // reads of GetRecord and queries
+  size_t record_cache_bytes = size_t{256} << 20;
+  // Records put are buffered and written in one batch once they reach this
+  // size, or on FlushRecords
+  size_t write_buffer_bytes = size_t{64} << 20;
+  // On open only IVF-Flat centroids are read, inverted lists are loaded per
+  // partition on first use. Load all of them in a background thread instead.
+  bool warm_up_indexes = false;
+  // Store IVF-Flat indexes as segment files next to the database, mapped
+  // and scanned in place on open, instead of in RocksDB values
+  bool index_segments = false;
+  // Checkpoint after this many written or deleted records, 0 to only
+  // checkpoint on close. Changes since the last checkpoint are lost on a
+  // crash.
+  size_t checkpoint_interval = 0;
+  // Write each record put or delete through in one RocksDB write batch with
+  // a log entry of the index change, replayed into the indexes on open. Index
+  // changes then survive a crash without saving the indexes on every write,
+  // and indexes are saved as soon as their centroids are set or trained.
+  // Bypasses the write buffer, so it is off by default for write throughput.
+  // Ignored in bulk-load mode.
+  bool durable_writes = false;
+  // Keep the scalar fields of all records in memory as columns, so filters
+  // are evaluated once per query for all records instead of on each fetched
+  // candidate. Filled by a scan of all records on open, which slows down the
+  // open of large databases, so it is off by default.
+  bool scalar_columns = false;
+
+  // RocksDB tuning. Records are looked up by key when evaluating filters and
+  // reranking, and hold a few KB of vectors each, so the defaults favor
+  // cached point lookups of large values.
+  enum class Compression { kNone, kLz4, kZstd };
+  // Block cache shared by all column families, 0 to disable it
+  size_t block_cache_bytes = size_t{512} << 20;
+  // Data block size of the records column family
+  size_t block_size = size_t{16} << 10;
+  // Bits per key of the bloom filters on record keys, 0 to disable them
+  int bloom_bits_per_key = 10;
+  // Of levels 2 and up, levels 0 and 1 are not compressed. Float vectors
+  // compress poorly, and RocksDB must be built with the chosen libraries.
+  Compression compression = Compression::kNone;
+  Compression bottommost_compression = Compression::kNone;
+  int max_background_jobs = 4;
+  // Flushes and compactions bypass the page cache, left to reads
+  bool direct_io_for_compaction = false;
 };  // struct DbOptions
 
 using Key = uint64_t;
@@ -26,11 +78,38 @@ struct VectorField {
   std::string name;
   size_t dim;
   size_t num_centroids;
+  // kCosine vectors are normalized on write, so it ranks like kInnerProduct
+  enum class Metric { kL2, kInnerProduct, kCosine, kL1 } metric = Metric::kL2;
+  enum class IndexType {
+    kIvfFlat,
+    kHnsw,
+    kIvfPq
+  } index_type = IndexType::kIvfFlat;
+  // HNSW only: max links per node on upper layers (2x on layer 0), and
+  // candidate list sizes used when building and searching the graph
+  size_t hnsw_m = 16;
+  size_t hnsw_ef_construction = 200;
+  size_t hnsw_ef_search = 64;
+  // IVF-Flat only: scalar quantization of the vectors in the inverted lists
+  enum class Quantization {
+    kNone,
+    kSq8,
+    kFp16
+  } quantization = Quantization::kNone;
+  // IVF-PQ only: bytes per code (must divide dim)
+  size_t pq_m = 0;
+  // Quantized indexes only: the number of best candidates per probed list, by
+  // approximate distance, that are reranked with exact vectors from storage
+  // (0 reranks all of them)
+  size_t rerank = 0;
 };  // struct VectorField
 
 struct ScalarField {
   std::string name;
   enum class Type { kDouble, kString, kInt } type;
+  // Keep a secondary index of the field in RocksDB, ordered by value, to
+  // find the records matching kEq and range filters without reading them
+  bool indexed = false;
 };  // struct ScalarField
 
 struct ScalarFilter {
@@ -51,10 +130,22 @@ struct Schema {
   std::unordered_map<std::string, size_t> vector_field_idx;
   std::unordered_map<std::string, size_t> scalar_field_idx;
 
-  auto AddVectorField(const std::string &name, size_t dimension,
-                      size_t num_centroids) -> Schema &;
-  auto AddScalarField(const std::string &name, ScalarField::Type type)
-      -> Schema &;
+  auto AddVectorField(
+      const std::string &name, size_t dimension, size_t num_centroids,
+      VectorField::Metric metric = VectorField::Metric::kL2,
+      VectorField::Quantization quantization = VectorField::Quantization::kNone,
+      size_t rerank = 0) -> Schema &;
+  auto AddHnswVectorField(const std::string &name, size_t dimension,
+                          VectorField::Metric metric = VectorField::Metric::kL2,
+                          size_t m = 16, size_t ef_construction = 200,
+                          size_t ef_search = 64) -> Schema &;
+  auto AddIvfPqVectorField(
+      const std::string &name, size_t dimension, size_t num_centroids,
+      size_t pq_m, VectorField::Metric metric = VectorField::Metric::kL2,
+      size_t rerank = 0) -> Schema &;
+  // Names of indexed fields cannot contain ':'
+  auto AddScalarField(const std::string &name, ScalarField::Type type,
+                      bool indexed = false) -> Schema &;
 
   auto GetVectorField(const std::string &name) const -> const VectorField &;
   auto GetScalarField(const std::string &name) const -> const ScalarField &;
@@ -96,9 +187,8 @@ struct QueryResult {
   }
 };  // struct QueryResult
 
-inline auto ApplyFilter(const Schema &schema, const Record &record,
+inline auto MatchFilter(const Scalar &scalar,
                         const ScalarFilter &filter) noexcept -> bool {
-  const auto &scalar = record.scalars[schema.scalar_field_idx.at(filter.field)];
   switch (filter.op) {
     case ScalarFilter::Op::kEq:
       return scalar == filter.value;
@@ -116,6 +206,12 @@ inline auto ApplyFilter(const Schema &schema, const Record &record,
   return false;
 }
 
+inline auto ApplyFilter(const Schema &schema, const Record &record,
+                        const ScalarFilter &filter) noexcept -> bool {
+  return MatchFilter(record.scalars[schema.scalar_field_idx.at(filter.field)],
+                     filter);
+}
+
 class DbImpl;
 
 class DB {
@@ -132,14 +228,33 @@ class DB {
   DB &operator=(const DB &) = delete;  // non-assignable
 
   auto PutRecord(Key key, const Record &record) -> void;
+  // Bulk load keyed by Record::id: centroids are assigned for the whole batch
+  // in parallel and records are written through in RocksDB write batches
+  auto PutRecords(std::span<const Record> records) -> void;
   auto GetRecord(Key key) const -> Record;
   auto DeleteRecord(Key key) -> void;
   auto FlushRecords() -> void;
+  // Flush records and save the index changes since the last checkpoint
+  auto Checkpoint() -> void;
 
+  // IVF fields only
   auto SetCentroids(const std::string &field,
                     const std::vector<Vector> &centroids) -> void;
+  // IVF fields only: cluster a random sample of up to sample_size stored
+  // records with k-means++ and iters Lloyd iterations, then rebuild the index
+  // around the new centroids. Quantizers still waiting for enough vectors
+  // are trained too.
+  auto TrainIndex(const std::string &field, size_t sample_size = 100000,
+                  size_t iters = 25) -> void;
 
   auto FullScan(const Query &query) const -> std::vector<QueryResult>;
+  // Keys of the records matching all filters, in ascending order. Served by
+  // the scalar columns or a secondary index when possible, otherwise by a
+  // scan of all records.
+  auto FindRecords(std::span<const ScalarFilter> filters) const
+      -> std::vector<Key>;
+  // nprobe is the number of probed clusters for IVF fields, and a lower
+  // bound on the search list size (ef) for HNSW fields
   auto KnnSearch(const Query &query, size_t nprobe = 1) const
       -> std::vector<QueryResult>;
 
@@ -38,23 +38,73 @@ auto ScalarFromString(const std::string &str) noexcept -> Scalar {
 }
 
 auto Schema::AddVectorField(const std::string &name, size_t dimension,
-                            size_t num_centroids) -> Schema & {
+                            size_t num_centroids, VectorField::Metric metric,
+                            VectorField::Quantization quantization,
+                            size_t rerank) -> Schema & {
   if (vector_field_idx.contains(name)) {
     throw std::invalid_argument("Vector field already exists");
   }
 
-  vector_fields.push_back({name, dimension, num_centroids});
+  VectorField field{name, dimension, num_centroids, metric};
+  field.quantization = quantization;
+  field.rerank = rerank;
+  vector_fields.push_back(field);
   vector_field_idx[name] = vector_fields.size() - 1;
   return *this;
 }
 
-auto Schema::AddScalarField(const std::string &name, ScalarField::Type type)
+auto Schema::AddHnswVectorField(const std::string &name, size_t dimension,
+                                VectorField::Metric metric, size_t m,
+                                size_t ef_construction, size_t ef_search)
     -> Schema & {
+  if (vector_field_idx.contains(name)) {
+    throw std::invalid_argument("Vector field already exists");
+  }
+  if (m < 2) {
+    throw std::invalid_argument("HNSW m must be at least 2");
+  }
+
+  VectorField field{name, dimension, 0, metric};
+  field.index_type = VectorField::IndexType::kHnsw;
+  field.hnsw_m = m;
+  field.hnsw_ef_construction = std::max(ef_construction, m);
+  field.hnsw_ef_search = ef_search;
+  vector_fields.push_back(field);
+  vector_field_idx[name] = vector_fields.size() - 1;
+  return *this;
+}
+
+auto Schema::AddIvfPqVectorField(const std::string &name, size_t dimension,
+                                 size_t num_centroids, size_t pq_m,
+                                 VectorField::Metric metric, size_t rerank)
+    -> Schema & {
+  if (vector_field_idx.contains(name)) {
+    throw std::invalid_argument("Vector field already exists");
+  }
+  if (pq_m == 0 || dimension % pq_m != 0) {
+    throw std::invalid_argument("PQ m must divide the vector dimension");
+  }
+
+  VectorField field{name, dimension, num_centroids, metric};
+  field.index_type = VectorField::IndexType::kIvfPq;
+  field.pq_m = pq_m;
+  field.rerank = rerank;
+  vector_fields.push_back(field);
+  vector_field_idx[name] = vector_fields.size() - 1;
+  return *this;
+}
+
+auto Schema::AddScalarField(const std::string &name, ScalarField::Type type,
+                            bool indexed) -> Schema & {
   if (scalar_field_idx.contains(name)) {
     throw std::invalid_argument("Scalar field already exists");
   }
+  // The name is followed by ':' in the keys of the index
+  if (indexed && name.find(':') != std::string::npos) {
+    throw std::invalid_argument("Indexed scalar field name contains ':'");
+  }
 
-  scalar_fields.push_back({name, type});
+  scalar_fields.push_back({name, type, indexed});
   scalar_field_idx[name] = scalar_fields.size() - 1;
   return *this;
 }
@@ -117,6 +167,10 @@ auto DB::PutRecord(Key key, const Record &record) -> void {
   impl_->PutRecord(key, record);
 }
 
+auto DB::PutRecords(std::span<const Record> records) -> void {
+  impl_->PutRecords(records);
+}
+
 auto DB::GetRecord(Key key) const -> Record { return impl_->GetRecord(key); }
 
 auto DB::DeleteRecord(Key key) -> void { impl_->DeleteRecord(key); }
@@ -126,10 +180,20 @@ auto DB::SetCentroids(const std::string &field,
   impl_->SetCentroids(field, centroids);
 }
 
+auto DB::TrainIndex(const std::string &field, size_t sample_size,
+                    size_t iters) -> void {
+  impl_->TrainIndex(field, sample_size, iters);
+}
+
 auto DB::FullScan(const Query &query) const -> std::vector<QueryResult> {
   return impl_->FullScan(query);
 }
 
+auto DB::FindRecords(std::span<const ScalarFilter> filters) const
+    -> std::vector<Key> {
+  return impl_->FindRecords(filters);
+}
+
 auto DB::KnnSearch(const Query &query, size_t nprobe) const
     -> std::vector<QueryResult> {
   return impl_->KnnSearch(query, nprobe);
@@ -137,6 +201,8 @@ auto DB::KnnSearch(const Query &query, size_t nprobe) const
 
 auto DB::FlushRecords() -> void { impl_->FlushRecords(); }
 
+auto DB::Checkpoint() -> void { impl_->Checkpoint(); }
+
 auto DB::KnnSearchIterativeMerge(const Query &query, size_t nprobe,
                                  size_t k_threshold) const
     -> std::vector<QueryResult> {
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <numeric>
 #include <queue>
 #include <string>
 #include <unordered_map>
@@ -14,6 +15,13 @@
 
 namespace rox {
 
+auto QueryHandler::GetFieldDistance(const std::string &field,
+                                    std::span<const Float> query,
+                                    std::span<const Float> vector) const
+    -> Float {
+  return GetDistance(db_.schema_.GetVectorField(field).metric, query, vector);
+}
+
 auto QueryHandler::KnnSearch(size_t nprobe) -> std::vector<QueryResult> {
   const auto k = query_.GetLimit();
   const auto &query_vectors = query_.GetVectors();
@@ -22,7 +30,9 @@ auto QueryHandler::KnnSearch(size_t nprobe) -> std::vector<QueryResult> {
   std::vector<AptIterator> its;
   for (const auto &[field_name, query_vec, weight] : query_vectors) {
     const auto &index = *db_.indexes_.at(field_name);
-    auto it = std::make_unique<IvfFlatIterator>(index, query_vec, nprobe, 0, 0);
+    auto it = index.NewIterator(query_vec, nprobe);
+    it->SetFilter(filter_.GetKeyFilter());
+    it->SetZoneFilter(filter_.GetZoneFilter());
     it->SeekCluster();
     its.emplace_back(field_name, query_vec, weight, std::move(it));
   }
@@ -45,13 +55,26 @@ auto QueryHandler::KnnSearch(size_t nprobe) -> std::vector<QueryResult> {
       }
       exhausted = false;
 
-      const auto &cluster = it.it->GetCluster();
+      const auto cluster_keys = it.it->GetClusterKeys();
+      const auto cluster_distances = it.it->GetClusterDistances();
+
+      // With reranking, only the best candidates by approximate distance
+      // have their records fetched and exact distances computed
+      std::vector<size_t> slots(cluster_keys.size());
+      std::iota(slots.begin(), slots.end(), 0);
+      const auto rerank = db_.schema_.GetVectorField(it.field).rerank;
+      if (rerank > 0 && slots.size() > rerank) {
+        std::ranges::nth_element(
+            slots, slots.begin() + rerank, {},
+            [&](const size_t slot) { return cluster_distances[slot]; });
+        slots.resize(rerank);
+      }
+
       std::for_each(
-          std::execution::par, cluster.begin(), cluster.end(),
-          [&](const auto &pair) {
-            const auto key = pair.first;
-            const auto &record_vec = pair.second;
-            const auto &distance = GetDistanceL2Sq(it.query, record_vec);
+          std::execution::par, slots.begin(), slots.end(),
+          [&](const size_t slot) {
+            const auto key = cluster_keys[slot];
+            const auto distance = cluster_distances[slot];
 
             {  // Skip if key is already visited
               std::lock_guard<std::mutex> lock(visited_mutex);
@@ -60,24 +83,22 @@ auto QueryHandler::KnnSearch(size_t nprobe) -> std::vector<QueryResult> {
               }
             }
 
-            const auto &record = db_.storage_->GetRecord(key);
-
             // Check filters
-            if (query_.GetFilters().size() > 0) {
-              if (!std::ranges::all_of(
-                      query_.GetFilters(), [&](const auto &filter) {
-                        return ApplyFilter(db_.schema_, record, filter);
-                      })) {
-                return;
-              }
+            if (!filter_.MatchesKey(key)) {
+              return;
+            }
+            const auto record = db_.storage_->GetRecordView(key);
+            if (!filter_.MatchesRecord(record)) {
+              return;
             }
 
             // Calculate total distance
             Float total_distance = 0.0;
             for (const auto &[field_name, query_vec, weight] : query_vectors) {
-              const auto &record_vec =
-                  record.vectors[db_.schema_.vector_field_idx.at(field_name)];
-              total_distance += GetDistanceL2Sq(query_vec, record_vec) * weight;
+              const auto record_vec =
+                  record.GetVector(db_.schema_.vector_field_idx.at(field_name));
+              total_distance +=
+                  GetFieldDistance(field_name, query_vec, record_vec) * weight;
             }
 
             // Update last seen distance
@@ -127,14 +148,15 @@ auto QueryHandler::KnnSearch(size_t nprobe) -> std::vector<QueryResult> {
 auto QueryHandler::GetTopK(const std::string &field, const Vector &query,
                            size_t k, size_t nprobe) const -> std::vector<Key> {
   const auto &idx = db_.indexes_.at(field);
-  auto it = std::make_unique<IvfFlatIterator>(*idx, query, nprobe, 0, 0);
+  auto it = idx->NewIterator(query, nprobe);
+  it->SetFilter(filter_.GetKeyFilter());
+  it->SetZoneFilter(filter_.GetZoneFilter());
 
   std::priority_queue<QueryResult> pq;
   it->Seek();
   while (it->Valid()) {
     const auto key = it->GetKey();
-    const auto &record_vec = it->GetVector();
-    const auto distance = GetDistanceL2Sq(query, record_vec);
+    const auto distance = it->GetDistance();
     it->Next();
 
     if (pq.size() < k) {
@@ -186,28 +208,29 @@ auto QueryHandler::KnnSearchIterativeMerge(size_t nprobe, size_t k_threshold)
     // calculate total distance for each candidate, apply filter, update
     // threshold
     for (const auto &key : candidates) {
-      const auto &record = db_.storage_->GetRecord(key);
-      if (query_.GetFilters().size() > 0) {
-        if (!std::ranges::all_of(query_.GetFilters(), [&](const auto &filter) {
-              return ApplyFilter(db_.schema_, record, filter);
-            })) {
-          continue;
-        }
+      if (!filter_.MatchesKey(key)) {
+        continue;
+      }
+      const auto record = db_.storage_->GetRecordView(key);
+      if (!filter_.MatchesRecord(record)) {
+        continue;
       }
 
       Float total_distance = 0.0;
       for (const auto &[field_name, query_vec, weight] : query_vectors) {
-        const auto &record_vec =
-            record.vectors[db_.schema_.vector_field_idx.at(field_name)];
-        total_distance += GetDistanceL2Sq(query_vec, record_vec) * weight;
+        const auto record_vec =
+            record.GetVector(db_.schema_.vector_field_idx.at(field_name));
+        total_distance +=
+            GetFieldDistance(field_name, query_vec, record_vec) * weight;
       }
       visited.insert(key);
 
       // Update threshold values
       for (const auto &[field_name, query_vec, weight] : query_vectors) {
-        const auto &record_vec =
-            record.vectors[db_.schema_.vector_field_idx.at(field_name)];
-        const auto distance = GetDistanceL2Sq(query_vec, record_vec);
+        const auto record_vec =
+            record.GetVector(db_.schema_.vector_field_idx.at(field_name));
+        const auto distance =
+            GetFieldDistance(field_name, query_vec, record_vec);
         threshold_values[field_name] =
             std::min(threshold_values[field_name], distance);
       }
@@ -249,11 +272,13 @@ auto QueryHandler::KnnSearchVBase(size_t nprobe, size_t n2)
   const auto &query_vectors = query_.GetVectors();
 
   // Iterator for each field
-  std::vector<IvfFlatIterator> its;
+  std::vector<std::unique_ptr<VectorIterator>> its;
   for (const auto &[field_name, query_vec, weight] : query_vectors) {
     const auto &index = *db_.indexes_.at(field_name);
-    auto it = IvfFlatIterator(index, query_vec, nprobe, 0, 0);
-    it.Seek();
+    auto it = index.NewIterator(query_vec, nprobe);
+    it->SetFilter(filter_.GetKeyFilter());
+    it->SetZoneFilter(filter_.GetZoneFilter());
+    it->Seek();
     its.push_back(std::move(it));
   }
 
@@ -302,7 +327,7 @@ auto QueryHandler::KnnSearchVBase(size_t nprobe, size_t n2)
     bool exhausted = true;
     for (size_t field_i = 0; field_i < query_vectors.size(); ++field_i) {
       const auto &[field_name, query_vec, weight] = query_vectors[field_i];
-      auto &it = its[field_i];
+      auto &it = *its[field_i];
       if (!it.Valid()) {
         continue;
       }
@@ -316,8 +341,7 @@ auto QueryHandler::KnnSearchVBase(size_t nprobe, size_t n2)
         }
 
         const auto key = it.GetKey();
-        const auto &record_vec = it.GetVector();
-        const auto distance = GetDistanceL2Sq(query_vec, record_vec);
+        const auto distance = it.GetDistance();
         it.Next();
 
         {  // Skip if key is already visited
@@ -326,23 +350,22 @@ auto QueryHandler::KnnSearchVBase(size_t nprobe, size_t n2)
           }
         }
 
-        const auto &record = db_.storage_->GetRecord(key);
         // Apply filters
-        if (query_.GetFilters().size() > 0) {
-          if (!std::ranges::all_of(
-                  query_.GetFilters(), [&](const auto &filter) {
-                    return ApplyFilter(db_.schema_, record, filter);
-                  })) {
-            continue;
-          }
+        if (!filter_.MatchesKey(key)) {
+          continue;
+        }
+        const auto record = db_.storage_->GetRecordView(key);
+        if (!filter_.MatchesRecord(record)) {
+          continue;
         }
 
         // Calculate total distance
         Float total_distance = 0.0;
         for (const auto &[field_name, query_vec, weight] : query_vectors) {
-          const auto &record_vec =
-              record.vectors[db_.schema_.vector_field_idx.at(field_name)];
-          total_distance += GetDistanceL2Sq(query_vec, record_vec) * weight;
+          const auto record_vec =
+              record.GetVector(db_.schema_.vector_field_idx.at(field_name));
+          total_distance +=
+              GetFieldDistance(field_name, query_vec, record_vec) * weight;
         }
 
         // Update last seen distance
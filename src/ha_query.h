@@ -1,6 +1,8 @@
 #pragma once
 
 #include <mutex>
+#include <span>
+#include <utility>
 
 #include "impl.h"
 #include "roxdb/db.h"
@@ -9,7 +11,10 @@ namespace rox {
 
 class QueryHandler {
  public:
-  QueryHandler(const DbImpl &db, const Query &query) : db_(db), query_(query) {}
+  QueryHandler(const DbImpl &db, const Query &query)
+      : QueryHandler(db, query, db.MakeFilter(query)) {}
+  QueryHandler(const DbImpl &db, const Query &query, QueryFilter filter)
+      : db_(db), query_(query), filter_(std::move(filter)) {}
 
   auto KnnSearch(size_t nprobe) -> std::vector<QueryResult>;
 
@@ -23,18 +28,23 @@ class QueryHandler {
     const std::string &field;
     const Vector &query;
     const Float weight;
-    std::unique_ptr<IvfFlatIterator> it;
+    std::unique_ptr<VectorIterator> it;
     std::unique_ptr<std::mutex> mutex = std::make_unique<std::mutex>();
     Float last_seen_distance = std::numeric_limits<Float>::max();
 
     // Constructor
     AptIterator(const std::string &field, const Vector &query, Float weight,
-                std::unique_ptr<IvfFlatIterator> it)
+                std::unique_ptr<VectorIterator> it)
         : field(field), query(query), weight(weight), it(std::move(it)) {}
   };
 
   const DbImpl &db_;
   const Query &query_;
+  const QueryFilter filter_;
+
+  // Distance between query and vector under the metric of field
+  auto GetFieldDistance(const std::string &field, std::span<const Float> query,
+                        std::span<const Float> vector) const -> Float;
 
   auto GetTopK(const std::string &field, const Vector &query, size_t k,
                size_t nprobe) const -> std::vector<Key>;
@@ -0,0 +1,344 @@
+#include "hnsw.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "roxdb/db.h"
+
+namespace rox {
+
+HnswIndex::HnswIndex(std::string field_name, size_t dim, size_t m,
+                     size_t ef_construction, size_t ef_search, Metric metric)
+    : field_name_(std::move(field_name)),
+      dim_(dim),
+      m_(m),
+      m0_(2 * m),
+      ef_construction_(std::max(ef_construction, m)),
+      ef_search_(ef_search),
+      metric_(metric),
+      level_mult_(1.0 / std::log(static_cast<double>(m))) {
+  if (m < 2) {
+    throw std::invalid_argument("HNSW m must be at least 2");
+  }
+}
+
+auto HnswIndex::Put(const Key& key, const Vector& v) -> void {
+  assert(v.size() == dim_);
+  if (keys_.size() >= std::numeric_limits<NodeId>::max()) {
+    throw std::runtime_error("HNSW index is full");
+  }
+  Delete(key);
+  Insert(key, v);
+}
+
+auto HnswIndex::Insert(Key key, std::span<const Float> v) -> void {
+  const int level = RandomLevel();
+  const NodeId id = AllocateNode(key, v, level);
+  key_to_node_[key] = id;
+
+  if (max_level_ < 0) {
+    entry_point_ = id;
+    max_level_ = level;
+    return;
+  }
+
+  const auto query = GetNodeVector(id);
+  NodeId ep = GreedySearch(query, entry_point_, max_level_, level + 1);
+  for (int l = std::min(level, max_level_); l >= 0; --l) {
+    const auto candidates = SearchLayer(query, ep, ef_construction_, l);
+    const auto neighbors = SelectNeighbors(candidates, m_);
+    SetNeighbors(id, l, neighbors);
+    for (const auto neighbor : neighbors) {
+      Connect(neighbor, id, l);
+    }
+    ep = candidates.front().second;
+  }
+
+  if (level > max_level_) {
+    entry_point_ = id;
+    max_level_ = level;
+  }
+}
+
+auto HnswIndex::Delete(const Key& key) -> void {
+  auto it = key_to_node_.find(key);
+  if (it == key_to_node_.end()) {
+    return;
+  }
+  deleted_[it->second] = true;
+  key_to_node_.erase(it);
+  // Rebuilding costs an insert per live node, amortized over the deletes
+  if (GetNumNodes() - GetNumLiveNodes() > GetNumLiveNodes()) {
+    Rebuild();
+  }
+}
+
+auto HnswIndex::Rebuild() -> void {
+  std::vector<Key> keys;
+  AlignedVector data;
+  keys.reserve(GetNumLiveNodes());
+  data.reserve(GetNumLiveNodes() * dim_);
+  for (NodeId id = 0; id < keys_.size(); ++id) {
+    if (!deleted_[id]) {
+      keys.push_back(keys_[id]);
+      const auto v = GetNodeVector(id);
+      data.insert(data.end(), v.begin(), v.end());
+    }
+  }
+
+  keys_.clear();
+  data_.clear();
+  levels_.clear();
+  deleted_.clear();
+  links0_.clear();
+  upper_links_.clear();
+  key_to_node_.clear();
+  entry_point_ = 0;
+  max_level_ = -1;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    Insert(keys[i], {data.data() + (i * dim_), dim_});
+  }
+}
+
+auto HnswIndex::NewIterator(const Vector& query, size_t nprobe) const
+    -> std::unique_ptr<VectorIterator> {
+  return std::make_unique<HnswIterator>(*this, query,
+                                        std::max(ef_search_, nprobe));
+}
+
+auto HnswIndex::GetNeighbors(NodeId id, int level) const noexcept
+    -> std::span<const NodeId> {
+  const NodeId* links =
+      level == 0 ? links0_.data() + (static_cast<size_t>(id) * (m0_ + 1))
+                 : upper_links_[id].data() + ((level - 1) * (m_ + 1));
+  return {links + 1, links[0]};
+}
+
+auto HnswIndex::SetNeighbors(NodeId id, int level,
+                             std::span<const NodeId> neighbors) -> void {
+  NodeId* links =
+      level == 0 ? links0_.data() + (static_cast<size_t>(id) * (m0_ + 1))
+                 : upper_links_[id].data() + ((level - 1) * (m_ + 1));
+  assert(neighbors.size() <= (level == 0 ? m0_ : m_));
+  links[0] = static_cast<NodeId>(neighbors.size());
+  std::ranges::copy(neighbors, links + 1);
+}
+
+auto HnswIndex::AllocateNode(Key key, std::span<const Float> v, int level)
+    -> NodeId {
+  const auto id = static_cast<NodeId>(keys_.size());
+  keys_.push_back(key);
+  data_.insert(data_.end(), v.begin(), v.end());
+  levels_.push_back(static_cast<uint8_t>(level));
+  deleted_.push_back(false);
+  links0_.resize(links0_.size() + m0_ + 1, 0);
+  upper_links_.emplace_back(level * (m_ + 1), 0);
+  return id;
+}
+
+auto HnswIndex::RandomLevel() -> int {
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  const double r = std::max(dist(level_gen_), 1e-12);
+  return std::min(static_cast<int>(-std::log(r) * level_mult_), kMaxLevel);
+}
+
+auto HnswIndex::GreedySearch(std::span<const Float> query, NodeId ep,
+                             int from_level, int to_level) const -> NodeId {
+  Float ep_distance = GetNodeDistance(query, ep);
+  for (int l = from_level; l >= to_level; --l) {
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (const auto neighbor : GetNeighbors(ep, l)) {
+        const auto distance = GetNodeDistance(query, neighbor);
+        if (distance < ep_distance) {
+          ep = neighbor;
+          ep_distance = distance;
+          changed = true;
+        }
+      }
+    }
+  }
+  return ep;
+}
+
+auto HnswIndex::SearchLayer(std::span<const Float> query, NodeId ep, size_t ef,
+                            int level) -> std::vector<Candidate> {
+  // Bump the tag instead of clearing visited marks
+  visited_.resize(keys_.size(), 0);
+  if (++visited_tag_ == 0) {
+    std::ranges::fill(visited_, 0);
+    visited_tag_ = 1;
+  }
+
+  // candidates: min heap of nodes to expand
+  // results: max heap of the ef nearest nodes found so far
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>>
+      candidates;
+  std::priority_queue<Candidate> results;
+  const Candidate start{GetNodeDistance(query, ep), ep};
+  candidates.push(start);
+  results.push(start);
+  visited_[ep] = visited_tag_;
+
+  while (!candidates.empty()) {
+    const auto [distance, id] = candidates.top();
+    if (distance > results.top().first) {
+      break;
+    }
+    candidates.pop();
+
+    for (const auto neighbor : GetNeighbors(id, level)) {
+      if (visited_[neighbor] == visited_tag_) {
+        continue;
+      }
+      visited_[neighbor] = visited_tag_;
+
+      const auto neighbor_distance = GetNodeDistance(query, neighbor);
+      if (results.size() < ef || neighbor_distance < results.top().first) {
+        candidates.push({neighbor_distance, neighbor});
+        results.push({neighbor_distance, neighbor});
+        if (results.size() > ef) {
+          results.pop();
+        }
+      }
+    }
+  }
+
+  std::vector<Candidate> sorted(results.size());
+  for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
+    *it = results.top();
+    results.pop();
+  }
+  return sorted;
+}
+
+auto HnswIndex::SelectNeighbors(const std::vector<Candidate>& candidates,
+                                size_t m) const -> std::vector<NodeId> {
+  // Keep a candidate only if it is closer to the base than to every neighbor
+  // selected so far, which spreads links out in different directions
+  std::vector<NodeId> selected;
+  selected.reserve(m);
+  for (const auto& [distance, id] : candidates) {
+    if (selected.size() >= m) {
+      break;
+    }
+    const auto v = GetNodeVector(id);
+    const bool diverse = std::ranges::none_of(selected, [&](NodeId other) {
+      return GetNodeDistance(v, other) < distance;
+    });
+    if (diverse) {
+      selected.push_back(id);
+    }
+  }
+  return selected;
+}
+
+auto HnswIndex::Connect(NodeId id, NodeId neighbor, int level) -> void {
+  const auto links = GetNeighbors(id, level);
+  const size_t max_links = level == 0 ? m0_ : m_;
+  if (links.size() < max_links) {
+    std::vector<NodeId> updated(links.begin(), links.end());
+    updated.push_back(neighbor);
+    SetNeighbors(id, level, updated);
+    return;
+  }
+
+  // Full, re-select among the existing links and the new one
+  const auto v = GetNodeVector(id);
+  std::vector<Candidate> candidates;
+  candidates.reserve(links.size() + 1);
+  for (const auto link : links) {
+    candidates.emplace_back(GetNodeDistance(v, link), link);
+  }
+  candidates.emplace_back(GetNodeDistance(v, neighbor), neighbor);
+  std::ranges::sort(candidates);
+  SetNeighbors(id, level, SelectNeighbors(candidates, max_links));
+}
+
+auto HnswIterator::Seek() -> void {
+  frontier_ = {};
+  results_ = {};
+  visited_.assign(index_.GetNumNodes(), false);
+  if (index_.max_level_ < 0) {
+    return;
+  }
+
+  const auto ep =
+      index_.GreedySearch(query_, index_.entry_point_, index_.max_level_, 1);
+  visited_[ep] = true;
+  frontier_.push({index_.GetNodeDistance(query_, ep), ep});
+  Expand();
+}
+
+auto HnswIterator::Next() -> void {
+  results_.pop();
+  Expand();
+}
+
+auto HnswIterator::Expand() -> void {
+  while (!frontier_.empty() &&
+         (results_.size() < ef_ || frontier_.top() < results_.top())) {
+    const auto candidate = frontier_.top();
+    frontier_.pop();
+    if (!index_.deleted_[candidate.second]) {
+      results_.push(candidate);
+    }
+
+    for (const auto neighbor : index_.GetNeighbors(candidate.second, 0)) {
+      if (visited_[neighbor]) {
+        continue;
+      }
+      visited_[neighbor] = true;
+      frontier_.push({index_.GetNodeDistance(query_, neighbor), neighbor});
+    }
+  }
+}
+
+auto HnswIterator::Valid() const -> bool { return !results_.empty(); }
+
+auto HnswIterator::GetKey() const noexcept -> Key {
+  return index_.keys_[results_.top().second];
+}
+
+auto HnswIterator::GetVector() const noexcept -> std::span<const Float> {
+  return index_.GetNodeVector(results_.top().second);
+}
+
+auto HnswIterator::GetDistance() const noexcept -> Float {
+  return results_.top().first;
+}
+
+auto HnswIterator::SeekCluster() -> void {
+  Seek();
+  FillCluster();
+}
+
+auto HnswIterator::NextCluster() -> void { FillCluster(); }
+
+auto HnswIterator::HasNextCluster() const -> bool {
+  return !cluster_keys_.empty();
+}
+
+auto HnswIterator::GetClusterKeys() const -> std::span<const Key> {
+  return cluster_keys_;
+}
+
+auto HnswIterator::GetClusterDistances() const -> std::span<const Float> {
+  return cluster_distances_;
+}
+
+auto HnswIterator::FillCluster() -> void {
+  cluster_keys_.clear();
+  cluster_distances_.clear();
+  for (; Valid() && cluster_keys_.size() < ef_; Next()) {
+    cluster_keys_.push_back(GetKey());
+    cluster_distances_.push_back(GetDistance());
+  }
+}
+
+}  // namespace rox
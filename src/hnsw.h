@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "roxdb/db.h"
+#include "vector.h"
+
+namespace rox {
+
+// Hierarchical navigable small world graph. Nodes are addressed by a dense
+// internal id: vectors live in one contiguous block, layer 0 links in a flat
+// fixed-stride array and upper layer links per node. Deleted nodes are kept as
+// tombstones so the graph stays connected, iterators skip them. Once they
+// outnumber the live nodes, the graph is rebuilt from the live ones.
+class HnswIndex : public VectorIndex {
+ public:
+  using NodeId = uint32_t;
+
+  HnswIndex(std::string field_name, size_t dim, size_t m,
+            size_t ef_construction, size_t ef_search,
+            Metric metric = Metric::kL2);
+
+  // Putting an existing key replaces its vector, tombstoning its node
+  auto Put(const Key &key, const Vector &v) -> void override;
+  auto Update(const Key &key, std::span<const Float> old_v [[maybe_unused]],
+              const Vector &v) -> void override {
+    Put(key, v);
+  }
+  auto Delete(const Key &key) -> void override;
+
+  // Search list size is max(ef_search, nprobe)
+  auto NewIterator(const Vector &query, size_t nprobe) const
+      -> std::unique_ptr<VectorIterator> override;
+
+  auto GetType() const noexcept -> IndexType override {
+    return IndexType::kHnsw;
+  }
+  auto GetName() const noexcept -> const std::string & override {
+    return field_name_;
+  }
+  auto GetMetric() const noexcept -> Metric override { return metric_; }
+  auto GetDim() const noexcept -> size_t override { return dim_; }
+
+  auto GetNumNodes() const noexcept -> size_t { return keys_.size(); }
+  auto GetNumLiveNodes() const noexcept -> size_t {
+    return key_to_node_.size();
+  }
+
+ private:
+  friend class HnswIterator;
+  friend class RdbStorage;
+  using Candidate = std::pair<Float, NodeId>;  // distance, node
+
+  constexpr static const int kMaxLevel = 16;
+
+  const std::string field_name_;
+  const size_t dim_;
+  const size_t m_;   // max links per node on upper layers
+  const size_t m0_;  // max links per node on layer 0
+  const size_t ef_construction_;
+  const size_t ef_search_;
+  const Metric metric_;
+  const double level_mult_;
+
+  std::vector<Key> keys_;
+  AlignedVector data_;  // keys_.size() x dim_, row-major
+  std::vector<uint8_t> levels_;
+  std::vector<bool> deleted_;
+  std::vector<NodeId> links0_;  // per node: count, then m0_ slots
+  // per node and level >= 1: count, then m_ slots
+  std::vector<std::vector<NodeId>> upper_links_;
+  std::unordered_map<Key, NodeId> key_to_node_;  // live nodes only
+  NodeId entry_point_ = 0;
+  int max_level_ = -1;  // -1 for an empty graph
+
+  std::mt19937 level_gen_{42};
+  std::vector<uint32_t> visited_;  // visited_[id] == visited_tag_ if visited
+  uint32_t visited_tag_ = 0;
+
+  auto GetNodeVector(NodeId id) const noexcept -> std::span<const Float> {
+    return {data_.data() + (static_cast<size_t>(id) * dim_), dim_};
+  }
+  auto GetNodeDistance(std::span<const Float> query, NodeId id) const noexcept
+      -> Float {
+    return GetDistance(metric_, query, GetNodeVector(id));
+  }
+
+  auto GetNeighbors(NodeId id, int level) const noexcept
+      -> std::span<const NodeId>;
+  auto SetNeighbors(NodeId id, int level, std::span<const NodeId> neighbors)
+      -> void;
+
+  auto AllocateNode(Key key, std::span<const Float> v, int level) -> NodeId;
+  // Link a new node of key, which must not be live
+  auto Insert(Key key, std::span<const Float> v) -> void;
+  // Drop the tombstones, inserting the live nodes again in id order
+  auto Rebuild() -> void;
+  auto RandomLevel() -> int;
+
+  // Greedy walk from ep through levels [to_level, from_level]
+  auto GreedySearch(std::span<const Float> query, NodeId ep, int from_level,
+                    int to_level) const -> NodeId;
+  // ef nearest nodes to query on level, ascending by distance
+  auto SearchLayer(std::span<const Float> query, NodeId ep, size_t ef,
+                   int level) -> std::vector<Candidate>;
+  // Heuristic selection of up to m diverse neighbors from sorted candidates
+  auto SelectNeighbors(const std::vector<Candidate> &candidates, size_t m) const
+      -> std::vector<NodeId>;
+  // Add a link from id to neighbor, pruning id's links if full
+  auto Connect(NodeId id, NodeId neighbor, int level) -> void;
+};  // class HnswIndex
+
+// Best-first walk over layer 0 starting at the node found by a greedy descent
+// from the entry point. Keeps at least ef expanded nodes buffered, and only
+// returns a node once no discovered node is closer, so results come out in
+// ascending distance order among the visited part of the graph.
+class HnswIterator : public VectorIterator {
+ public:
+  HnswIterator(const HnswIndex &index, const Vector &query, size_t ef)
+      : index_(index), query_(query), ef_(std::max<size_t>(ef, 1)) {}
+
+  auto Seek() -> void override;
+  auto Next() -> void override;
+  auto Valid() const -> bool override;
+
+  auto GetKey() const noexcept -> Key override;
+  auto GetVector() const noexcept -> std::span<const Float> override;
+  auto GetDistance() const noexcept -> Float override;
+
+  // Clusters are blocks of the next ef results
+  auto SeekCluster() -> void override;
+  auto NextCluster() -> void override;
+  auto HasNextCluster() const -> bool override;
+  auto GetClusterKeys() const -> std::span<const Key> override;
+  auto GetClusterDistances() const -> std::span<const Float> override;
+
+ private:
+  using Candidate = HnswIndex::Candidate;
+  using MinHeap =
+      std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>>;
+
+  const HnswIndex &index_;
+  const Vector &query_;
+  const size_t ef_;
+
+  std::vector<bool> visited_;
+  MinHeap frontier_;  // discovered but not expanded
+  MinHeap results_;   // expanded live nodes not returned yet
+  std::vector<Key> cluster_keys_;
+  std::vector<Float> cluster_distances_;
+
+  auto Expand() -> void;
+  auto FillCluster() -> void;
+};  // class HnswIterator
+
+}  // namespace rox
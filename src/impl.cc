@@ -2,13 +2,23 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <execution>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <queue>
+#include <random>
 #include <ranges>
+#include <span>
 #include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #ifdef USE_OPENMP
@@ -16,6 +26,10 @@
 #endif
 
 #include "ha_query.h"
+#include "hnsw.h"
+#include "ivf_pq.h"
+#include "ivf_sq.h"
+#include "kmeans.h"
 #include "roxdb/db.h"
 #include "storage.h"
 #include "vector.h"
@@ -40,7 +54,11 @@ DbImpl::DbImpl(const std::string &path, const DbOptions &options)
 
   // Load indexes
   for (const auto &field : schema_.vector_fields) {
-    indexes_[field.name] = storage_->GetIndex(field.name);
+    // Not saved yet if the database was not closed or checkpointed since it
+    // was created, then rebuilt from the logged deltas. Centroids set or
+    // trained since are saved right away with durable writes.
+    auto index = storage_->GetIndex(field);
+    indexes_[field.name] = index ? std::move(index) : MakeIndex(field);
   }
   // Populate schema idx maps
   for (size_t i = 0; i < schema_.vector_fields.size(); ++i) {
@@ -49,8 +67,18 @@ DbImpl::DbImpl(const std::string &path, const DbOptions &options)
   for (size_t i = 0; i < schema_.scalar_fields.size(); ++i) {
     schema_.scalar_field_idx[schema_.scalar_fields[i].name] = i;
   }
+  // Scalars first, so that zone maps are built as lists are loaded
+  LoadScalars();
+  for (auto &[field, index] : indexes_) {
+    AttachZoneMaps(*index);
+  }
+  ReplayDeltas();
   // Preload records
   storage_->PrefetchRecords(1000);
+  if (options.warm_up_indexes) {
+    warm_up_ = std::jthread(
+        [this](std::stop_token stop) { WarmUpIndexes(std::move(stop)); });
+  }
 }
 
 DbImpl::DbImpl(const std::string &path, const DbOptions &options,
@@ -58,38 +86,216 @@ DbImpl::DbImpl(const std::string &path, const DbOptions &options,
     : path_(path), options_(options), schema_(schema) {
   // Create Index, one per vector field
   for (const auto &field : schema.vector_fields) {
-    indexes_[field.name] = std::make_unique<IvfFlatIndex>(field.name, field.dim,
-                                                          field.num_centroids);
+    indexes_[field.name] = MakeIndex(field);
   }
   // Create Storage
   storage_ = std::make_unique<Storage>(path, options);
   storage_->PutSchema(schema_);
+  if (options.scalar_columns && !schema_.scalar_fields.empty()) {
+    scalars_ = std::make_unique<ScalarStore>(schema_);
+  }
+  for (auto &[field, index] : indexes_) {
+    AttachZoneMaps(*index);
+  }
+}
+
+auto DbImpl::MakeIndex(const VectorField &field)
+    -> std::unique_ptr<VectorIndex> {
+  switch (field.index_type) {
+    case VectorField::IndexType::kIvfFlat:
+      if (field.quantization != VectorField::Quantization::kNone) {
+        return std::make_unique<IvfSqIndex>(field.name, field.dim,
+                                            field.num_centroids,
+                                            field.quantization, field.metric);
+      }
+      return std::make_unique<IvfFlatIndex>(field.name, field.dim,
+                                            field.num_centroids, field.metric);
+    case VectorField::IndexType::kHnsw:
+      return std::make_unique<HnswIndex>(
+          field.name, field.dim, field.hnsw_m, field.hnsw_ef_construction,
+          field.hnsw_ef_search, field.metric);
+    case VectorField::IndexType::kIvfPq:
+      return std::make_unique<IvfPqIndex>(field.name, field.dim,
+                                          field.num_centroids, field.pq_m,
+                                          field.metric);
+  }
+  throw std::invalid_argument("Unknown vector index type");
 }
 
 DbImpl::~DbImpl() {
-  // Save indexes
+  StopWarmUp();
+  Checkpoint();
+
+  std::cout << "Cache hit: " << storage_->GetCacheHit() << std::endl;
+  std::cout << "Cache miss: " << storage_->GetCacheMiss() << std::endl;
+}
+
+auto DbImpl::WarmUpIndexes(std::stop_token stop) const -> void {
   for (const auto &[field, index] : indexes_) {
-    if (dirty_indexes_.contains(field)) {
-      storage_->PutIndex(field, *index);
+    const auto *ivf = dynamic_cast<const IvfFlatIndex *>(index.get());
+    if (ivf == nullptr) {
+      continue;
+    }
+    for (size_t p = 0; p < ivf->GetNumPartitions(); ++p) {
+      if (stop.stop_requested()) {
+        return;
+      }
+      try {
+        ivf->LoadPartition(p);
+      } catch (const std::exception &e) {
+        // Left to be loaded, and to fail, on first use
+        std::cerr << "Failed to warm up index " << field << ": " << e.what()
+                  << std::endl;
+        break;
+      }
     }
   }
-  // Save records
-  storage_->FlushRecords();
+}
 
-  std::cout << "Cache hit: " << storage_->GetCacheHit() << std::endl;
-  std::cout << "Cache miss: " << storage_->GetCacheMiss() << std::endl;
+auto DbImpl::StopWarmUp() -> void {
+  if (warm_up_.joinable()) {
+    warm_up_.request_stop();
+    warm_up_.join();
+  }
 }
 
-auto DbImpl::PutRecord(Key key, const Record &record) -> void {
+auto DbImpl::CheckVectors(const Record &record) const -> void {
+  if (record.vectors.size() != schema_.vector_fields.size()) {
+    throw std::invalid_argument("Vector field count mismatch");
+  }
+  for (size_t f = 0; f < schema_.vector_fields.size(); ++f) {
+    if (record.vectors[f].size() != schema_.vector_fields[f].dim) {
+      throw std::invalid_argument("Vector dimension mismatch");
+    }
+  }
+}
+
+auto DbImpl::PutRecord(Key key, const Record &input) -> void {
+  CheckVectors(input);
+  // Cosine fields are stored normalized, so they can be ranked by dot product
+  Record record = input;
+  for (const auto &field : schema_.vector_fields) {
+    if (field.metric == Metric::kCosine) {
+      NormalizeVector(record.vectors[schema_.vector_field_idx.at(field.name)]);
+    }
+  }
+
+  // An existing record is updated in place, its unchanged vectors keep
+  // their postings
+  const auto old = storage_->FindRecordView(key);
   // Add record to storage
   storage_->PutRecord(key, record);
+  if (scalars_) {
+    scalars_->Put(key, record.scalars);
+  }
   // Add record to indexes
   for (const auto &field : schema_.vector_fields) {
-    const auto &vector =
-        record.vectors[schema_.vector_field_idx.at(field.name)];
-    indexes_.at(field.name)->Put(key, vector);
+    const size_t field_idx = schema_.vector_field_idx.at(field.name);
+    const auto &vector = record.vectors[field_idx];
+    auto &index = *indexes_.at(field.name);
+    if (old) {
+      const auto old_vector = old->GetVector(field_idx);
+      if (std::ranges::equal(old_vector, vector)) {
+        UpdateZoneMap(index, key, vector);
+        continue;
+      }
+      index.Update(key, old_vector, vector);
+    } else {
+      index.Put(key, vector);
+    }
     dirty_indexes_.insert(field.name);
   }
+  CountWrites(1);
+}
+
+auto DbImpl::PutRecords(std::span<const Record> input) -> void {
+  // Checked up front, so that a bad batch writes nothing
+  for (const auto &record : input) {
+    CheckVectors(record);
+  }
+
+  // Cosine fields are stored normalized, as in PutRecord
+  std::vector<Record> normalized;
+  if (std::ranges::any_of(schema_.vector_fields, [](const auto &field) {
+        return field.metric == Metric::kCosine;
+      })) {
+    normalized.assign(input.begin(), input.end());
+    for (const auto &field : schema_.vector_fields) {
+      if (field.metric != Metric::kCosine) {
+        continue;
+      }
+      const size_t field_idx = schema_.vector_field_idx.at(field.name);
+      std::for_each(std::execution::par, normalized.begin(), normalized.end(),
+                    [&](auto &record) {
+                      NormalizeVector(record.vectors[field_idx]);
+                    });
+    }
+  }
+  const std::span<const Record> records =
+      normalized.empty() ? input : std::span<const Record>(normalized);
+
+  // Existing records are updated as in PutRecord. A key repeated in the batch
+  // updates its earlier occurrence.
+  std::vector<std::optional<RecordView>> olds(records.size());
+  std::transform(std::execution::par, records.begin(), records.end(),
+                 olds.begin(), [&](const auto &record) {
+                   return storage_->FindRecordView(record.id);
+                 });
+  std::vector<size_t> fresh;
+  std::vector<std::pair<size_t, const Record *>> updates;  // slot, earlier
+  std::unordered_map<Key, size_t> batch_slots;
+  for (size_t i = 0; i < records.size(); ++i) {
+    auto [it, inserted] = batch_slots.try_emplace(records[i].id, i);
+    if (!inserted) {
+      updates.emplace_back(i, &records[it->second]);
+      it->second = i;
+    } else if (olds[i]) {
+      updates.emplace_back(i, nullptr);
+    } else {
+      fresh.push_back(i);
+    }
+  }
+
+  storage_->PutRecords(records);
+  if (scalars_) {
+    for (const auto &record : records) {
+      scalars_->Put(record.id, record.scalars);
+    }
+  }
+
+  // Gather each field of new records into one contiguous block and index it
+  // in one pass
+  std::vector<Key> keys(fresh.size());
+  std::ranges::transform(fresh, keys.begin(),
+                         [&](size_t i) { return records[i].id; });
+  for (const auto &field : schema_.vector_fields) {
+    const size_t field_idx = schema_.vector_field_idx.at(field.name);
+    auto &index = *indexes_.at(field.name);
+    AlignedVector data(fresh.size() * field.dim);
+    for (size_t i = 0; i < fresh.size(); ++i) {
+      const auto &vector = records[fresh[i]].vectors[field_idx];
+      std::ranges::copy(vector, data.begin() + (i * field.dim));
+    }
+    bool changed = !fresh.empty();
+    index.PutBatch(keys, data.data());
+    for (const auto &[i, earlier] : updates) {
+      const auto &vector = records[i].vectors[field_idx];
+      const auto old_vector = earlier != nullptr
+                                  ? std::span<const Float>(
+                                        earlier->vectors[field_idx])
+                                  : olds[i]->GetVector(field_idx);
+      if (std::ranges::equal(old_vector, vector)) {
+        UpdateZoneMap(index, records[i].id, vector);
+        continue;
+      }
+      index.Update(records[i].id, old_vector, vector);
+      changed = true;
+    }
+    if (changed) {
+      dirty_indexes_.insert(field.name);
+    }
+  }
+  CountWrites(records.size());
 }
 
 auto DbImpl::GetRecord(Key key) const -> Record {
@@ -97,30 +303,415 @@ auto DbImpl::GetRecord(Key key) const -> Record {
 }
 
 auto DbImpl::DeleteRecord(Key key) -> void {
+  // Its vectors tell the indexes where the postings of the record are
+  const auto old = storage_->FindRecordView(key);
   // Remove record from storage
   storage_->DeleteRecord(key);
-  // Remove record from indexes
-  for (const auto &field : schema_.vector_fields) {
-    indexes_.at(field.name)->Delete(key);
+  if (scalars_) {
+    scalars_->Delete(key);
   }
+  // Remove record from indexes, a missing record has no postings
+  if (old) {
+    for (const auto &field : schema_.vector_fields) {
+      const size_t field_idx = schema_.vector_field_idx.at(field.name);
+      indexes_.at(field.name)->Remove(key, old->GetVector(field_idx));
+      dirty_indexes_.insert(field.name);
+    }
+  }
+  CountWrites(1);
 }
 
 auto DbImpl::SetCentroids(const std::string &field,
                           const std::vector<Vector> &centroids) -> void {
+  ApplyCentroids(field, centroids);
+  SaveTrainedIndex(field);
+}
+
+auto DbImpl::ApplyCentroids(const std::string &field,
+                            const std::vector<Vector> &centroids) -> void {
   if (!indexes_.contains(field)) {
     throw std::invalid_argument("Vector field not found");
   }
 
-  indexes_.at(field)->SetCentroids(centroids);
+  auto *index = indexes_.at(field).get();
+  if (auto *ivf = dynamic_cast<IvfFlatIndex *>(index)) {
+    ivf->SetCentroids(centroids);
+  } else if (auto *ivf_pq = dynamic_cast<IvfPqIndex *>(index)) {
+    ivf_pq->SetCentroids(centroids);
+  } else if (auto *ivf_sq = dynamic_cast<IvfSqIndex *>(index)) {
+    ivf_sq->SetCentroids(centroids);
+  } else {
+    throw std::invalid_argument("Centroids can only be set on IVF fields");
+  }
+  dirty_indexes_.insert(field);
+}
+
+auto DbImpl::TrainIndex(const std::string &field, size_t sample_size,
+                        size_t iters) -> void {
+  const auto &vector_field = schema_.GetVectorField(field);
+  if (vector_field.index_type == VectorField::IndexType::kHnsw) {
+    throw std::invalid_argument("Only IVF fields can be trained");
+  }
+  const size_t field_idx = schema_.vector_field_idx.at(field);
+  const size_t dim = vector_field.dim;
+  const size_t k = vector_field.num_centroids;
+
+  // Cluster a uniform sample of the records
+  const auto keys = GetRecordKeys();
+  std::vector<Key> sample;
+  std::ranges::sample(keys, std::back_inserter(sample),
+                      std::min(sample_size, keys.size()), std::mt19937{42});
+  if (sample.size() < k) {
+    throw std::invalid_argument("Not enough records to train the index");
+  }
+  AlignedVector data;
+  data.reserve(sample.size() * dim);
+  for (const auto key : sample) {
+    const auto record = storage_->GetRecordView(key);
+    const auto vector = record.GetVector(field_idx);
+    data.insert(data.end(), vector.begin(), vector.end());
+  }
+  const auto flat_centroids =
+      KMeans(data.data(), sample.size(), dim, k,
+             {.iters = iters,
+              .spherical = vector_field.metric == Metric::kCosine});
+  std::vector<Vector> centroids(k);
+  for (size_t c = 0; c < k; ++c) {
+    centroids[c].assign(flat_centroids.begin() + (c * dim),
+                        flat_centroids.begin() + ((c + 1) * dim));
+  }
+
+  // Rebuild the index, reassigning every record to the new centroids
+  StopWarmUp();
+  indexes_[field] = MakeIndex(vector_field);
+  AttachZoneMaps(*indexes_.at(field));
+  ApplyCentroids(field, centroids);
+  auto *index = indexes_.at(field).get();
+  constexpr const size_t kBatchSize = 4096;
+  for (size_t begin = 0; begin < keys.size(); begin += kBatchSize) {
+    const auto batch = std::span<const Key>(keys).subspan(
+        begin, std::min(kBatchSize, keys.size() - begin));
+    data.clear();
+    for (const auto key : batch) {
+      const auto record = storage_->GetRecordView(key);
+      const auto vector = record.GetVector(field_idx);
+      data.insert(data.end(), vector.begin(), vector.end());
+    }
+    index->PutBatch(batch, data.data());
+  }
+  if (auto *ivf_pq = dynamic_cast<IvfPqIndex *>(index)) {
+    if (!ivf_pq->IsTrained() &&
+        ivf_pq->GetNumPending() >= ProductQuantizer::kNumCodes) {
+      ivf_pq->Train();
+    }
+  } else if (auto *ivf_sq = dynamic_cast<IvfSqIndex *>(index)) {
+    if (!ivf_sq->IsTrained() && ivf_sq->GetNumPending() > 0) {
+      ivf_sq->Train();
+    }
+  }
   dirty_indexes_.insert(field);
+  SaveTrainedIndex(field);
+}
+
+auto DbImpl::SaveTrainedIndex(const std::string &field) -> void {
+  if (!options_.durable_writes || options_.bulk_load) {
+    return;
+  }
+  storage_->FlushRecords();
+  storage_->PutIndex(field, *indexes_.at(field));
+  dirty_indexes_.erase(field);
 }
 
 auto DbImpl::FlushRecords() -> void { storage_->FlushRecords(); }
 
-auto DbImpl::FullScan(const Query &query) const -> std::vector<QueryResult> {
-  if (query.GetLimit() == 0) {
+auto DbImpl::Checkpoint() -> void {
+  // Records first, so saved indexes never point to unsaved records
+  storage_->FlushRecords();
+  const uint64_t delta_end = storage_->GetDeltaEnd();
+  for (const auto &field : dirty_indexes_) {
+    storage_->PutIndex(field, *indexes_.at(field));
+  }
+  dirty_indexes_.clear();
+  if (delta_end > 0) {
+    storage_->TruncateDeltas(delta_end);
+  }
+  num_writes_ = 0;
+}
+
+auto DbImpl::ReplayDeltas() -> void {
+  // Only the last change of a key matters. The saved index may hold the key
+  // with any vector it had since, or with its last one if the put is already
+  // saved: it is looked up with all of them, so that only the lists they go
+  // to are loaded.
+  struct Change {
+    IndexDelta::Op op;
+    std::vector<std::vector<Vector>> old_vectors;
+  };  // struct Change
+  std::unordered_map<Key, Change> changes;
+  for (auto &delta : storage_->GetDeltas()) {
+    auto &change = changes[delta.key];
+    change.op = delta.op;
+    if (!delta.old_vectors.empty()) {
+      change.old_vectors.push_back(std::move(delta.old_vectors));
+    }
+  }
+  for (const auto &[key, change] : changes) {
+    const bool put = change.op == IndexDelta::Op::kPut;
+    const auto record = put ? storage_->GetRecordView(key) : RecordView();
+    for (const auto &field : schema_.vector_fields) {
+      const size_t field_idx = schema_.vector_field_idx.at(field.name);
+      std::vector<Vector> candidates;
+      for (const auto &old_vectors : change.old_vectors) {
+        if (field_idx < old_vectors.size()) {
+          candidates.push_back(old_vectors[field_idx]);
+        }
+      }
+      if (put) {
+        const auto vector = record.GetVector(field_idx);
+        candidates.emplace_back(vector.begin(), vector.end());
+      }
+      auto &index = *indexes_.at(field.name);
+      index.Discard(key, candidates);
+      if (put) {
+        index.Put(key, candidates.back());
+      }
+      dirty_indexes_.insert(field.name);
+    }
+  }
+}
+
+auto DbImpl::CountWrites(size_t n) -> void {
+  num_writes_ += n;
+  if (options_.checkpoint_interval > 0 &&
+      num_writes_ >= options_.checkpoint_interval) {
+    Checkpoint();
+  }
+}
+
+auto DbImpl::GetRecordKeys() -> std::vector<Key> {
+  // Cached records are not visible to storage iterators until flushed
+  storage_->FlushRecords();
+  std::vector<Key> keys;
+  for (auto it = storage_->GetIterator(RdbStorage::kRecordPrefix); it->Valid();
+       it->Next()) {
+    const auto rdb_key = it->key();
+    std::string_view key_view(rdb_key.data(), rdb_key.size());
+    if (!key_view.starts_with(RdbStorage::kRecordPrefix)) {
+      break;
+    }
+    keys.push_back(RdbStorage::GetKey(rdb_key));
+  }
+  return keys;
+}
+
+auto DbImpl::LoadScalars() -> void {
+  if (!options_.scalar_columns || schema_.scalar_fields.empty()) {
+    return;
+  }
+  scalars_ = std::make_unique<ScalarStore>(schema_);
+  for (auto it = storage_->GetIterator(RdbStorage::kRecordPrefix); it->Valid();
+       it->Next()) {
+    const auto rdb_key = it->key();
+    std::string_view key_view(rdb_key.data(), rdb_key.size());
+    if (!key_view.starts_with(RdbStorage::kRecordPrefix)) {
+      break;
+    }
+    const auto key = RdbStorage::GetKey(rdb_key);
+    scalars_->Put(key, storage_->GetRecordView(key, it->value()).GetScalars());
+  }
+}
+
+auto DbImpl::AttachZoneMaps(VectorIndex &index) -> void {
+  auto *ivf = dynamic_cast<IvfFlatIndex *>(&index);
+  if (ivf == nullptr) {
+    return;
+  }
+  if (scalars_ == nullptr) {
+    // Zone maps saved with the index would not follow the records
+    ivf->SetZoneMapBuilder(nullptr);
+    return;
+  }
+  ivf->SetZoneMapBuilder([this](std::span<const Key> keys, ZoneMap &zone_map) {
+    scalars_->Summarize(keys, zone_map);
+  });
+}
+
+auto DbImpl::UpdateZoneMap(VectorIndex &index, Key key,
+                           std::span<const Float> v) -> void {
+  if (scalars_ == nullptr) {
+    return;
+  }
+  if (auto *ivf = dynamic_cast<IvfFlatIndex *>(&index)) {
+    ivf->UpdateZoneMap(key, v);
+    // Saved with the index
+    dirty_indexes_.insert(ivf->GetName());
+  }
+}
+
+auto DbImpl::MakeFilter(const Query &query) const -> QueryFilter {
+  if (scalars_ != nullptr) {
+    return {schema_, scalars_.get(), query};
+  }
+  return {schema_, nullptr, query, FindCandidates(query.GetFilters())};
+}
+
+auto DbImpl::FindCandidates(std::span<const ScalarFilter> filters) const
+    -> std::optional<std::vector<Key>> {
+  // An equality is likely the narrowest, otherwise any range
+  const ScalarFilter *best = nullptr;
+  for (const auto &filter : filters) {
+    if (filter.op == ScalarFilter::Op::kNe ||
+        !schema_.GetScalarField(filter.field).indexed) {
+      continue;
+    }
+    if (best == nullptr || (filter.op == ScalarFilter::Op::kEq &&
+                            best->op != ScalarFilter::Op::kEq)) {
+      best = &filter;
+    }
+  }
+  if (best == nullptr) {
+    return std::nullopt;
+  }
+  return storage_->ScanScalarIndex(*best);
+}
+
+auto DbImpl::FindRecords(std::span<const ScalarFilter> filters) const
+    -> std::vector<Key> {
+  auto matches = [&](const RecordView &record) {
+    return std::ranges::all_of(filters, [&](const auto &filter) {
+      return record.ApplyFilter(schema_, filter);
+    });
+  };
+  std::vector<Key> keys;
+  if (scalars_ != nullptr) {
+    scalars_->Filter(filters).ForEach(
+        [&](size_t row) { keys.push_back(scalars_->GetKey(row)); });
+  } else if (auto candidates = FindCandidates(filters)) {
+    // The index serves one filter, the others are checked on the records
+    if (filters.size() == 1) {
+      keys = std::move(*candidates);
+    } else {
+      for (const auto key : *candidates) {
+        if (matches(storage_->GetRecordView(key))) {
+          keys.push_back(key);
+        }
+      }
+    }
+  } else {
+    storage_->FlushWriteBuffer();  // buffered records are not iterated
+    for (auto it = storage_->GetIterator(RdbStorage::kRecordPrefix);
+         it->Valid(); it->Next()) {
+      const auto rdb_key = it->key();
+      std::string_view key_view(rdb_key.data(), rdb_key.size());
+      if (!key_view.starts_with(RdbStorage::kRecordPrefix)) {
+        break;
+      }
+      const auto key = RdbStorage::GetKey(rdb_key);
+      if (matches(storage_->GetRecordView(key, it->value()))) {
+        keys.push_back(key);
+      }
+    }
+  }
+  std::ranges::sort(keys);
+  return keys;
+}
+
+QueryFilter::QueryFilter(const Schema &schema, const ScalarStore *scalars,
+                         const Query &query,
+                         std::optional<std::vector<Key>> candidates)
+    : schema_(schema),
+      scalars_(scalars),
+      filters_(query.GetFilters()) {
+  if (filters_.empty()) {
+    return;
+  }
+  if (scalars_ != nullptr) {
+    rows_ = scalars_->Filter(filters_);
+    num_matches_ = rows_.Count();
+  } else if (candidates) {
+    candidates_.emplace(candidates->begin(), candidates->end());
+  }
+}
+
+auto QueryFilter::GetNumMatches() const noexcept -> std::optional<size_t> {
+  if (filters_.empty()) {
+    return std::nullopt;
+  }
+  if (scalars_ != nullptr) {
+    return num_matches_;
+  }
+  if (candidates_) {
+    return candidates_->size();
+  }
+  return std::nullopt;
+}
+
+auto QueryFilter::GetMatchingKeys() const -> std::vector<Key> {
+  if (candidates_) {
+    return {candidates_->begin(), candidates_->end()};
+  }
+  std::vector<Key> keys;
+  keys.reserve(num_matches_);
+  rows_.ForEach([&](size_t row) { keys.push_back(scalars_->GetKey(row)); });
+  return keys;
+}
+
+auto QueryFilter::MatchesKey(Key key) const -> bool {
+  if (filters_.empty()) {
+    return true;
+  }
+  if (scalars_ != nullptr) {
+    const auto row = scalars_->GetRow(key);
+    return row && rows_.Test(*row);
+  }
+  return !candidates_ || candidates_->contains(key);
+}
+
+auto QueryFilter::GetZoneFilter() const -> ZoneFilter {
+  // Zone maps are only built from a scalar store
+  if (filters_.empty() || scalars_ == nullptr) {
     return {};
   }
+  return [this](const ZoneMap &zone_map) {
+    return std::ranges::all_of(filters_, [&](const auto &filter) {
+      return zone_map.MayMatch(schema_.scalar_field_idx.at(filter.field),
+                               filter);
+    });
+  };
+}
+
+auto QueryFilter::GetKeyFilter() const -> KeyFilter {
+  if (filters_.empty() || !push_down_ ||
+      (scalars_ == nullptr && !candidates_)) {
+    return {};
+  }
+  return [this](Key key) { return MatchesKey(key); };
+}
+
+auto QueryFilter::MatchesRecord(const RecordView &record) const -> bool {
+  if (scalars_ != nullptr) {
+    return true;  // already checked by MatchesKey
+  }
+  return std::ranges::all_of(filters_, [&](const auto &filter) {
+    return record.ApplyFilter(schema_, filter);
+  });
+}
+
+auto DbImpl::PrepareQuery(const Query &input) const -> Query {
+  Query query = input;
+  for (auto &[field_name, query_vec, weight] : query.vectors) {
+    if (schema_.GetVectorField(field_name).metric == Metric::kCosine) {
+      NormalizeVector(query_vec);
+    }
+  }
+  return query;
+}
+
+auto DbImpl::FullScan(const Query &input) const -> std::vector<QueryResult> {
+  if (input.GetLimit() == 0) {
+    return {};
+  }
+  const auto query = PrepareQuery(input);
 
   // auto records =
   //     records_ |  // Filter records based on scalar filters
@@ -148,6 +739,43 @@ auto DbImpl::FullScan(const Query &query) const -> std::vector<QueryResult> {
   // top() is the largest, pop() removes the largest in the heap
   // New candidate only needs to compare with the largest in the heap (top)
   std::priority_queue<QueryResult> pq;
+  const auto filter = MakeFilter(query);
+
+  // Records passing the filters are gathered into blocks, with each queried
+  // vector field copied into a contiguous buffer, so distances can be
+  // computed with the batched kernel.
+  constexpr const size_t kScanBlockSize = 256;
+  const auto &query_vectors = query.GetVectors();
+  std::vector<Key> block_keys;
+  block_keys.reserve(kScanBlockSize);
+  std::vector<AlignedVector> block_vectors(query_vectors.size());
+  std::vector<Float> block_distances(kScanBlockSize);
+  std::vector<Float> field_distances(kScanBlockSize);
+
+  auto flush_block = [&]() {
+    const size_t n = block_keys.size();
+    std::fill_n(block_distances.begin(), n, 0.0F);
+    for (size_t f = 0; f < query_vectors.size(); ++f) {
+      const auto &[field_name, query_vec, weight] = query_vectors[f];
+      GetDistances(schema_.GetVectorField(field_name).metric, query_vec,
+                   block_vectors[f].data(), n, field_distances.data());
+      for (size_t i = 0; i < n; ++i) {
+        block_distances[i] += field_distances[i] * weight;
+      }
+      block_vectors[f].clear();
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      QueryResult result{.id = block_keys[i], .distance = block_distances[i]};
+      if (pq.size() < query.limit) {
+        pq.push(result);
+      } else if (result.distance < pq.top().distance) {
+        pq.pop();
+        pq.push(result);
+      }
+    }
+    block_keys.clear();
+  };
 
   for (auto it = storage_->GetIterator(RdbStorage::kRecordPrefix); it->Valid();
        it->Next()) {
@@ -157,34 +785,30 @@ auto DbImpl::FullScan(const Query &query) const -> std::vector<QueryResult> {
       break;  // Skip keys that don't have the correct prefix
     }
     const auto key = RdbStorage::GetKey(rdb_key);
-    const auto record = storage_->GetRecord(key);
-
     // Filter records based on scalar filters
-    if (!std::ranges::all_of(query.GetFilters(), [&](const auto &filter) {
-          return ApplyFilter(schema_, record, filter);
-        })) {
+    if (!filter.MatchesKey(key)) {
+      continue;
+    }
+    const auto record = storage_->GetRecordView(key, it->value());
+    if (!filter.MatchesRecord(record)) {
       continue;
     }
 
-    // Calculate distance for each record
-    Float distance = 0.0;
-    for (const auto &[field_name, query_vec, weight] : query.GetVectors()) {
-      const auto &record_vec =
-          record.vectors[schema_.vector_field_idx.at(field_name)];
+    // Append record vectors to the current block
+    block_keys.push_back(key);
+    for (size_t f = 0; f < query_vectors.size(); ++f) {
+      const auto &[field_name, query_vec, weight] = query_vectors[f];
+      const auto record_vec =
+          record.GetVector(schema_.vector_field_idx.at(field_name));
       assert(query_vec.size() == record_vec.size());
-      distance += GetDistanceL2Sq(query_vec, record_vec) * weight;
+      block_vectors[f].insert(block_vectors[f].end(), record_vec.begin(),
+                              record_vec.end());
     }
-
-    QueryResult result{.id = key, .distance = distance};
-
-    // pq.emplace(result);
-    if (pq.size() < query.limit) {
-      pq.push(result);
-    } else if (result.distance < pq.top().distance) {
-      pq.pop();
-      pq.push(result);
+    if (block_keys.size() == kScanBlockSize) {
+      flush_block();
     }
   }
+  flush_block();
 
   std::vector<QueryResult> results;
   results.reserve(query.GetLimit());
@@ -197,18 +821,127 @@ auto DbImpl::FullScan(const Query &query) const -> std::vector<QueryResult> {
   return results;
 }
 
-auto DbImpl::KnnSearch(const Query &query, size_t nprobe) const
+auto DbImpl::KnnSearch(const Query &input, size_t nprobe) const
     -> std::vector<QueryResult> {
-  if (query.GetLimit() == 0) {
+  if (input.GetLimit() == 0) {
     return {};
   }
+  const auto query = PrepareQuery(input);
 
   // // Short curcuit for single vector search
   // if (query.vectors.size() == 1) {
   //   return SingleVectorKnnSearch(query, nprobe);
   // }
 
-  return MultiVectorKnnSearch(query, nprobe);
+  if (query.GetFilters().empty()) {
+    return MultiVectorKnnSearch(query, nprobe);
+  }
+  auto filter = MakeFilter(query);
+  const auto plan = PlanQuery(query, filter, nprobe);
+  if (plan.strategy == QueryPlan::Strategy::kBruteForce) {
+    return ScanMatches(query, filter);
+  }
+  filter.SetPushDown(plan.strategy == QueryPlan::Strategy::kPreFilter);
+  auto handler = QueryHandler(*this, query, std::move(filter));
+  return handler.KnnSearch(plan.nprobe);
+}
+
+auto DbImpl::PlanQuery(const Query &query, const QueryFilter &filter,
+                       size_t nprobe) const -> QueryPlan {
+  // Cost of fetching a record relative to checking or scoring a posting
+  constexpr const double kFetchCost = 16.0;
+  // Matches expected among the probed records, as a multiple of the limit
+  constexpr const double kProbeMargin = 2.0;
+  // Past this share of matching records, most postings of a list pass and
+  // are cheaper to score in one batch than to check one by one first
+  constexpr const double kPostFilterSelectivity = 0.5;
+
+  QueryPlan plan{.nprobe = nprobe};
+  const auto num_matches = filter.GetNumMatches();
+  if (!num_matches) {  // no statistics without scalar columns or indexes
+    return plan;
+  }
+  if (*num_matches == 0) {
+    plan.strategy = QueryPlan::Strategy::kBruteForce;
+    return plan;
+  }
+  const auto matches = static_cast<double>(*num_matches);
+  const auto total = std::max(
+      matches, static_cast<double>(scalars_ != nullptr
+                                       ? scalars_->GetNumRecords()
+                                       : storage_->EstimateNumRecords()));
+  const double selectivity = matches / total;
+  // Share of the records to probe for enough of them to match
+  const double wanted =
+      std::min(1.0, kProbeMargin * static_cast<double>(query.GetLimit()) /
+                        matches);
+
+  // Share of the records probed in a field with the given search width
+  auto get_share = [&](const VectorField &field, size_t width) {
+    if (field.index_type == VectorField::IndexType::kHnsw) {
+      return std::min(1.0, static_cast<double>(width) / total);
+    }
+    return std::min(1.0, static_cast<double>(width) /
+                             static_cast<double>(field.num_centroids));
+  };
+  for (const auto &[field_name, query_vec, weight] : query.GetVectors()) {
+    const auto &field = schema_.GetVectorField(field_name);
+    const double width =
+        field.index_type == VectorField::IndexType::kHnsw
+            ? wanted * total
+            : wanted * static_cast<double>(field.num_centroids);
+    plan.nprobe = std::max(plan.nprobe, static_cast<size_t>(std::ceil(width)));
+  }
+
+  // Probing checks each posting of the probed share and fetches the matches
+  // among them, brute force fetches all matches
+  double probe_cost = 0.0;
+  for (const auto &[field_name, query_vec, weight] : query.GetVectors()) {
+    const double share =
+        get_share(schema_.GetVectorField(field_name), plan.nprobe);
+    probe_cost += (total * share) + (matches * share * kFetchCost);
+  }
+  if (matches * kFetchCost <= probe_cost) {
+    plan.strategy = QueryPlan::Strategy::kBruteForce;
+  } else if (selectivity < kPostFilterSelectivity) {
+    plan.strategy = QueryPlan::Strategy::kPreFilter;
+  }
+  return plan;
+}
+
+auto DbImpl::ScanMatches(const Query &query, const QueryFilter &filter) const
+    -> std::vector<QueryResult> {
+  const auto keys = filter.GetMatchingKeys();
+  std::vector<std::optional<QueryResult>> scored(keys.size());
+  std::transform(
+      std::execution::par, keys.begin(), keys.end(), scored.begin(),
+      [&](const Key key) -> std::optional<QueryResult> {
+        const auto record = storage_->GetRecordView(key);
+        if (!filter.MatchesRecord(record)) {
+          return std::nullopt;
+        }
+        Float distance = 0.0F;
+        for (const auto &[field_name, query_vec, weight] :
+             query.GetVectors()) {
+          const auto record_vec =
+              record.GetVector(schema_.vector_field_idx.at(field_name));
+          distance += GetDistance(schema_.GetVectorField(field_name).metric,
+                                  query_vec, record_vec) *
+                      weight;
+        }
+        return QueryResult{.id = key, .distance = distance};
+      });
+  std::vector<QueryResult> results;
+  results.reserve(scored.size());
+  for (const auto &result : scored) {
+    if (result) {
+      results.push_back(*result);
+    }
+  }
+  const size_t k = std::min(query.GetLimit(), results.size());
+  std::ranges::partial_sort(results, results.begin() + k);
+  results.resize(k);
+  return results;
 }
 
 auto DbImpl::SingleVectorKnnSearch(const Query &query, size_t nprobe) const
@@ -219,20 +952,20 @@ auto DbImpl::SingleVectorKnnSearch(const Query &query, size_t nprobe) const
 
   // Create a Max Heap for top k results
   std::priority_queue<QueryResult> pq;
-  auto it = IvfFlatIterator(index, query_vec, nprobe, 0, 0);
+  const auto filter = MakeFilter(query);
+  auto it = index.NewIterator(query_vec, nprobe);
+  it->SetFilter(filter.GetKeyFilter());
+  it->SetZoneFilter(filter.GetZoneFilter());
 
   // Iterate over the index
-  for (it.Seek(); it.Valid(); it.Next()) {
-    const auto key = it.GetKey();
-    const auto &record_vec = it.GetVector();
-    const auto distance = GetDistanceL2Sq(query_vec, record_vec);
+  for (it->Seek(); it->Valid(); it->Next()) {
+    const auto key = it->GetKey();
+    const auto distance = it->GetDistance();
 
     // Check filters
-    if (query.GetFilters().size() > 0) {
-      const auto &record = storage_->GetRecord(key);
-      if (!std::ranges::all_of(query.GetFilters(), [&](const auto &filter) {
-            return ApplyFilter(schema_, record, filter);
-          })) {
+    if (!filter.IsEmpty()) {
+      if (!filter.MatchesKey(key) ||
+          !filter.MatchesRecord(storage_->GetRecordView(key))) {
         continue;
       }
     }
@@ -263,15 +996,17 @@ auto DbImpl::MultiVectorKnnSearch(const Query &query, size_t nprobe) const
   return handler.KnnSearch(nprobe);
 }
 
-auto DbImpl::KnnSearchIterativeMerge(const Query &query, size_t nprobe,
+auto DbImpl::KnnSearchIterativeMerge(const Query &input, size_t nprobe,
                                      size_t k_threshold) const
     -> std::vector<QueryResult> {
+  const auto query = PrepareQuery(input);
   auto handler = QueryHandler(*this, query);
   return handler.KnnSearchIterativeMerge(nprobe, k_threshold);
 }
 
-auto DbImpl::KnnSearchVBase(const Query &query, size_t nprobe, size_t n2)
+auto DbImpl::KnnSearchVBase(const Query &input, size_t nprobe, size_t n2)
     -> std::vector<QueryResult> {
+  const auto query = PrepareQuery(input);
   auto handler = QueryHandler(*this, query);
   return handler.KnnSearchVBase(nprobe, n2);
 }
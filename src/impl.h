@@ -1,15 +1,78 @@
 #pragma once
 
 #include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "hnsw.h"
+#include "ivf_pq.h"
+#include "ivf_sq.h"
 #include "roxdb/db.h"
+#include "scalar_store.h"
 #include "storage.h"
 #include "vector.h"
 
 namespace rox {
 
+// Scalar filters of a query. With a scalar store they are evaluated once for
+// all records into a bitmap, so candidates are rejected by key before their
+// record is fetched. Otherwise each fetched record is checked, candidates
+// being first narrowed to keys from a scalar index if any.
+class QueryFilter {
+ public:
+  // candidates, if any, includes all keys matching the filters
+  QueryFilter(const Schema &schema, const ScalarStore *scalars,
+              const Query &query,
+              std::optional<std::vector<Key>> candidates = std::nullopt);
+
+  auto IsEmpty() const noexcept -> bool { return filters_.empty(); }
+  // Number of matching records, an upper bound with candidates. std::nullopt
+  // without filters, or without a scalar store or candidates.
+  auto GetNumMatches() const noexcept -> std::optional<size_t>;
+  // Keys of the matching records, requires GetNumMatches(). With candidates
+  // their records must still be checked.
+  auto GetMatchingKeys() const -> std::vector<Key>;
+  // False if key is known not to match, before fetching its record
+  auto MatchesKey(Key key) const -> bool;
+  // Whether the fetched record of a key passing MatchesKey matches
+  auto MatchesRecord(const RecordView &record) const -> bool;
+  // MatchesKey for index iterators to skip postings before computing their
+  // distance, empty if keys can only be checked on their record. References
+  // this filter.
+  auto GetKeyFilter() const -> KeyFilter;
+  // Rules out the clusters of index iterators from their zone maps, empty
+  // without filters or a scalar store. References this filter.
+  auto GetZoneFilter() const -> ZoneFilter;
+  // Whether GetKeyFilter hands the filter to the index iterators
+  auto SetPushDown(bool push_down) noexcept -> void { push_down_ = push_down; }
+
+ private:
+  const Schema &schema_;
+  const ScalarStore *scalars_;
+  std::vector<ScalarFilter> filters_;
+  Bitmap rows_;  // matching rows of scalars_
+  size_t num_matches_ = 0;
+  std::optional<std::unordered_set<Key>> candidates_;
+  bool push_down_ = true;
+};  // class QueryFilter
+
+// How the scalar filters of a KNN query are applied
+struct QueryPlan {
+  enum class Strategy {
+    kPostFilter,  // probe the indexes, check candidates once scored
+    kPreFilter,   // probe the indexes, skipping non-matching postings
+    kBruteForce,  // score all matching records
+  } strategy = Strategy::kPostFilter;
+  // Search width, widened for the probed records to hold enough matches
+  size_t nprobe = 0;
+};  // struct QueryPlan
+
 class DbImpl {
  public:
   explicit DbImpl(const std::string &path, const DbOptions &options);
@@ -20,14 +83,20 @@ class DbImpl {
   DbImpl &operator=(const DB &) = delete;  // non-assignable
 
   auto PutRecord(Key key, const Record &record) -> void;
+  auto PutRecords(std::span<const Record> records) -> void;
   auto GetRecord(Key key) const -> Record;
   auto DeleteRecord(Key key) -> void;
   auto FlushRecords() -> void;
+  auto Checkpoint() -> void;
 
   auto SetCentroids(const std::string &field,
                     const std::vector<Vector> &centroids) -> void;
+  auto TrainIndex(const std::string &field, size_t sample_size, size_t iters)
+      -> void;
 
   auto FullScan(const Query &query) const -> std::vector<QueryResult>;
+  auto FindRecords(std::span<const ScalarFilter> filters) const
+      -> std::vector<Key>;
   auto KnnSearch(const Query &query, size_t nprobe) const
       -> std::vector<QueryResult>;
 
@@ -45,8 +114,61 @@ class DbImpl {
   Schema schema_;
   // std::unordered_map<Key, Record> records_;  // in-memory storage
   std::unique_ptr<Storage> storage_;
-  std::unordered_map<std::string, std::unique_ptr<IvfFlatIndex>> indexes_;
+  std::unordered_map<std::string, std::unique_ptr<VectorIndex>> indexes_;
   std::unordered_set<std::string> dirty_indexes_;
+  // Scalars of all records, nullptr without DbOptions::scalar_columns or
+  // scalar fields
+  std::unique_ptr<ScalarStore> scalars_;
+  // Records written since the last checkpoint
+  size_t num_writes_ = 0;
+  // Loads lazy index partitions in the background, see
+  // DbOptions::warm_up_indexes
+  std::jthread warm_up_;
+
+  // Throws std::invalid_argument unless record has a vector of the right
+  // dimension for each vector field
+  auto CheckVectors(const Record &record) const -> void;
+  // Copy of query with vectors of kCosine fields normalized
+  auto PrepareQuery(const Query &input) const -> Query;
+  // Keys of all records in storage, flushing cached records first
+  auto GetRecordKeys() -> std::vector<Key>;
+
+  // Fill scalars_ from the stored records
+  auto LoadScalars() -> void;
+  // Keep zone maps of scalars_ in index if it is an IVF-Flat index, drop
+  // those it was saved with if there is no scalars_
+  auto AttachZoneMaps(VectorIndex &index) -> void;
+  // After the scalars of key changed but not its vector v in index
+  auto UpdateZoneMap(VectorIndex &index, Key key, std::span<const Float> v)
+      -> void;
+  auto MakeFilter(const Query &query) const -> QueryFilter;
+  // Keys from the scalar index of one of filters, including all keys
+  // matching them, std::nullopt if none of them is served by an index
+  auto FindCandidates(std::span<const ScalarFilter> filters) const
+      -> std::optional<std::vector<Key>>;
+  // Pick the cheapest strategy for the selectivity of filter
+  auto PlanQuery(const Query &query, const QueryFilter &filter,
+                 size_t nprobe) const -> QueryPlan;
+  // Exact search over the records matching filter
+  auto ScanMatches(const Query &query, const QueryFilter &filter) const
+      -> std::vector<QueryResult>;
+  // Apply the index deltas logged since the last checkpoint
+  auto ReplayDeltas() -> void;
+  // SetCentroids without saving the index
+  auto ApplyCentroids(const std::string &field,
+                      const std::vector<Vector> &centroids) -> void;
+  // With durable writes, save the index of field at once. Deltas only replay
+  // postings, the centroids and quantizers they are assigned with must be
+  // stored before.
+  auto SaveTrainedIndex(const std::string &field) -> void;
+  // Checkpoint once options_.checkpoint_interval writes are reached
+  auto CountWrites(size_t n) -> void;
+  auto WarmUpIndexes(std::stop_token stop) const -> void;
+  // Must be called before an index is replaced
+  auto StopWarmUp() -> void;
+
+  static auto MakeIndex(const VectorField &field)
+      -> std::unique_ptr<VectorIndex>;
 
   auto SingleVectorKnnSearch(const Query &query, size_t nprobe) const
       -> std::vector<QueryResult>;
@@ -0,0 +1,350 @@
+#include "ivf_pq.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+#include "kmeans.h"
+#include "roxdb/db.h"
+
+namespace rox {
+
+ProductQuantizer::ProductQuantizer(size_t dim, size_t m)
+    : dim_(dim), m_(m), dsub_(m == 0 ? 0 : dim / m) {
+  if (m == 0 || dim % m != 0) {
+    throw std::invalid_argument(
+        "PQ subquantizer count must divide the vector dimension");
+  }
+}
+
+auto ProductQuantizer::Train(const Float* data, size_t n) -> void {
+  constexpr const size_t kIters = 25;
+  AlignedVector codebooks(m_ * kNumCodes * dsub_);
+  AlignedVector subvectors(n * dsub_);
+  for (size_t i = 0; i < m_; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      std::copy_n(data + (j * dim_) + (i * dsub_), dsub_,
+                  subvectors.begin() + (j * dsub_));
+    }
+    const auto codebook =
+        KMeans(subvectors.data(), n, dsub_, kNumCodes,
+               {.iters = kIters, .seed = static_cast<uint32_t>(i)});
+    std::ranges::copy(codebook, codebooks.begin() + (i * kNumCodes * dsub_));
+  }
+  codebooks_ = std::move(codebooks);
+}
+
+auto ProductQuantizer::Encode(std::span<const Float> v, uint8_t* code) const
+    -> void {
+  assert(v.size() == dim_);
+  for (size_t i = 0; i < m_; ++i) {
+    code[i] = static_cast<uint8_t>(AssignCentroid(
+        v.subspan(i * dsub_, dsub_), GetCodebook(i), kNumCodes, dsub_));
+  }
+}
+
+auto ProductQuantizer::Decode(const uint8_t* code, Float* v) const -> void {
+  for (size_t i = 0; i < m_; ++i) {
+    std::copy_n(GetCodebook(i) + (code[i] * dsub_), dsub_, v + (i * dsub_));
+  }
+}
+
+auto ProductQuantizer::ComputeTable(std::span<const Float> query,
+                                    Metric metric, Float* table) const
+    -> void {
+  assert(query.size() == dim_);
+  for (size_t i = 0; i < m_; ++i) {
+    GetDistances(metric, query.subspan(i * dsub_, dsub_), GetCodebook(i),
+                 kNumCodes, table + (i * kNumCodes));
+  }
+}
+
+auto ProductQuantizer::SetCodebooks(std::span<const Float> codebooks) -> void {
+  if (codebooks.size() != m_ * kNumCodes * dsub_) {
+    throw std::invalid_argument("PQ codebooks size mismatch");
+  }
+  codebooks_.assign(codebooks.begin(), codebooks.end());
+}
+
+IvfPqIndex::IvfPqIndex(std::string field_name, size_t dim, size_t nlist,
+                       size_t pq_m, Metric metric)
+    : field_name_(std::move(field_name)),
+      dim_(dim),
+      nlist_(nlist),
+      metric_(metric),
+      pq_(dim, pq_m) {
+  centroids_.resize(nlist_ * dim_);
+  lists_.assign(nlist_, CodeList(pq_m));
+  pending_lists_.assign(nlist_, IvfList(dim_));
+}
+
+auto IvfPqIndex::Put(const Key& key, const Vector& v) -> void {
+  PutInList(AssignCentroid(v, centroids_.data(), nlist_, dim_, metric_), key,
+            v);
+}
+
+auto IvfPqIndex::PutBatch(std::span<const Key> keys, const Float* data)
+    -> void {
+  std::vector<CentroidId> assignments(keys.size());
+  AssignCentroids(data, keys.size(), centroids_.data(), nlist_, dim_, metric_,
+                  assignments.data());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    PutInList(assignments[i], keys[i], {data + (i * dim_), dim_});
+  }
+}
+
+auto IvfPqIndex::PutInList(CentroidId list, Key key, std::span<const Float> v)
+    -> void {
+  if (!IsTrained()) {
+    pending_lists_[list].Append(key, v);
+    if (++num_pending_ >= kTrainSize) {
+      Train();
+    }
+    return;
+  }
+
+  std::vector<uint8_t> code(pq_.GetCodeSize());
+  Encode(list, v, code.data());
+  lists_[list].Append(key, code.data());
+}
+
+auto IvfPqIndex::Delete(const Key& key) -> void {
+  for (auto& list : lists_) {
+    list.Remove(key);
+  }
+  for (auto& list : pending_lists_) {
+    const size_t size = list.Size();
+    list.Remove(key);
+    num_pending_ -= size - list.Size();
+  }
+}
+
+auto IvfPqIndex::Update(const Key& key, std::span<const Float> old_v,
+                        const Vector& v) -> void {
+  const auto list =
+      AssignCentroid(old_v, centroids_.data(), nlist_, dim_, metric_);
+  if (!RemoveFromList(list, key)) {
+    Delete(key);
+  }
+  Put(key, v);
+}
+
+auto IvfPqIndex::RemoveFromList(CentroidId list, Key key) -> bool {
+  const size_t size = lists_[list].Size();
+  const size_t pending_size = pending_lists_[list].Size();
+  lists_[list].Remove(key);
+  pending_lists_[list].Remove(key);
+  num_pending_ -= pending_size - pending_lists_[list].Size();
+  return lists_[list].Size() + pending_lists_[list].Size() !=
+         size + pending_size;
+}
+
+auto IvfPqIndex::NewIterator(const Vector& query, size_t nprobe) const
+    -> std::unique_ptr<VectorIterator> {
+  return std::make_unique<IvfPqIterator>(*this, query, nprobe);
+}
+
+auto IvfPqIndex::SetCentroids(const std::vector<Vector>& centroids) -> void {
+  assert(centroids.size() == nlist_);
+  if (std::ranges::any_of(lists_, [](const auto& l) { return !l.Empty(); })) {
+    throw std::runtime_error(
+        "Centroids of a non-empty trained IVF-PQ index cannot be changed");
+  }
+  for (size_t i = 0; i < nlist_; ++i) {
+    assert(centroids[i].size() == dim_);
+    std::ranges::copy(centroids[i], centroids_.begin() + (i * dim_));
+  }
+}
+
+auto IvfPqIndex::Train() -> void {
+  if (num_pending_ < ProductQuantizer::kNumCodes) {
+    throw std::runtime_error("Not enough vectors to train the PQ codebooks");
+  }
+
+  // Gather residuals to the list centroids
+  AlignedVector residuals;
+  residuals.reserve(num_pending_ * dim_);
+  for (CentroidId c = 0; c < nlist_; ++c) {
+    const auto& pending = pending_lists_[c];
+    const auto centroid = GetCentroid(c);
+    for (size_t i = 0; i < pending.Size(); ++i) {
+      const auto v = pending.GetVector(i);
+      for (size_t d = 0; d < dim_; ++d) {
+        residuals.push_back(v[d] - centroid[d]);
+      }
+    }
+  }
+  pq_.Train(residuals.data(), num_pending_);
+
+  // Move pending vectors into the coded lists
+  std::vector<uint8_t> code(pq_.GetCodeSize());
+  for (CentroidId c = 0; c < nlist_; ++c) {
+    auto& pending = pending_lists_[c];
+    lists_[c].Reserve(lists_[c].Size() + pending.Size());
+    for (size_t i = 0; i < pending.Size(); ++i) {
+      Encode(c, pending.GetVector(i), code.data());
+      lists_[c].Append(pending.GetKey(i), code.data());
+    }
+    pending = IvfList(dim_);
+  }
+  num_pending_ = 0;
+}
+
+auto IvfPqIndex::Encode(CentroidId list, std::span<const Float> v,
+                        uint8_t* code) const -> void {
+  const auto centroid = GetCentroid(list);
+  Vector residual(dim_);
+  for (size_t d = 0; d < dim_; ++d) {
+    residual[d] = v[d] - centroid[d];
+  }
+  pq_.Encode(residual, code);
+}
+
+auto IvfPqIterator::FindProbeLists() -> void {
+  probe_lists_ =
+      FindNearestCentroids(query_, index_.centroids_.data(), index_.nlist_,
+                           index_.dim_, nprobe_, index_.metric_);
+  current_prob_ = 0;
+
+  // Dot product tables do not depend on the list, build them once
+  const auto metric = index_.metric_;
+  if (index_.IsTrained() &&
+      (metric == Metric::kInnerProduct || metric == Metric::kCosine)) {
+    table_.resize(index_.pq_.GetCodeSize() * ProductQuantizer::kNumCodes);
+    index_.pq_.ComputeTable(query_, Metric::kInnerProduct, table_.data());
+  }
+}
+
+auto IvfPqIterator::ScanList() -> void {
+  const auto list_idx = probe_lists_[current_prob_];
+  const auto& pending = index_.pending_lists_[list_idx];
+  const auto& list = index_.lists_[list_idx];
+  const auto metric = index_.metric_;
+
+  cluster_keys_.assign(pending.GetKeys().begin(), pending.GetKeys().end());
+  cluster_keys_.insert(cluster_keys_.end(), list.GetKeys().begin(),
+                       list.GetKeys().end());
+  cluster_distances_.resize(cluster_keys_.size());
+
+  // Pending vectors are scored exactly
+  GetDistances(metric, query_, pending.GetData(), pending.Size(),
+               cluster_distances_.data());
+  if (list.Empty()) {
+    return;
+  }
+
+  // Codes hold residuals r = v - c. L2 and L1 distances of v from q equal
+  // those of r from q - c, while for dot products dot(q, v) = dot(q, c) +
+  // dot(q, r), so a per-list term is added to the shared table.
+  const auto centroid = index_.GetCentroid(list_idx);
+  Float base = 0.0F;
+  if (metric == Metric::kInnerProduct || metric == Metric::kCosine) {
+    base = rox::GetDistance(metric, query_, centroid);
+  } else {
+    Vector residual(index_.dim_);
+    for (size_t d = 0; d < index_.dim_; ++d) {
+      residual[d] = query_[d] - centroid[d];
+    }
+    table_.resize(index_.pq_.GetCodeSize() * ProductQuantizer::kNumCodes);
+    index_.pq_.ComputeTable(residual, metric, table_.data());
+  }
+
+  Float* distances = cluster_distances_.data() + pending.Size();
+  for (size_t i = 0; i < list.Size(); ++i) {
+    distances[i] =
+        base + index_.pq_.LookupDistance(table_.data(), list.GetCode(i));
+  }
+}
+
+auto IvfPqIterator::CollectCandidates() -> void {
+  ScanList();
+  std::vector<Candidate> candidates;
+  candidates.reserve(cluster_distances_.size());
+  for (size_t i = 0; i < cluster_distances_.size(); ++i) {
+    candidates.emplace_back(cluster_distances_[i], i);
+  }
+  // Heapify in O(n) instead of n pushes
+  candidates_ = decltype(candidates_)(std::greater<>(), std::move(candidates));
+}
+
+auto IvfPqIterator::Seek() -> void {
+  candidates_ = {};
+  FindProbeLists();
+  // Collect candidates from the first non-empty probe list
+  for (; current_prob_ < probe_lists_.size(); ++current_prob_) {
+    CollectCandidates();
+    if (!candidates_.empty()) {
+      break;
+    }
+  }
+}
+
+auto IvfPqIterator::Next() -> void {
+  candidates_.pop();
+  while (candidates_.empty()) {
+    ++current_prob_;
+    if (current_prob_ >= probe_lists_.size()) {
+      return;
+    }
+    CollectCandidates();
+  }
+}
+
+auto IvfPqIterator::Valid() const -> bool {
+  return current_prob_ < probe_lists_.size() && !candidates_.empty();
+}
+
+auto IvfPqIterator::GetKey() const noexcept -> Key {
+  return cluster_keys_[candidates_.top().second];
+}
+
+auto IvfPqIterator::GetVector() const noexcept -> std::span<const Float> {
+  const auto slot = candidates_.top().second;
+  const auto list_idx = probe_lists_[current_prob_];
+  const auto& pending = index_.pending_lists_[list_idx];
+  if (slot < pending.Size()) {
+    return pending.GetVector(slot);
+  }
+
+  const auto& list = index_.lists_[list_idx];
+  index_.pq_.Decode(list.GetCode(slot - pending.Size()),
+                    reconstructed_.data());
+  const auto centroid = index_.GetCentroid(list_idx);
+  for (size_t d = 0; d < index_.dim_; ++d) {
+    reconstructed_[d] += centroid[d];
+  }
+  return reconstructed_;
+}
+
+auto IvfPqIterator::GetDistance() const noexcept -> Float {
+  return candidates_.top().first;
+}
+
+auto IvfPqIterator::SeekCluster() -> void {
+  FindProbeLists();
+  if (HasNextCluster()) {
+    ScanList();
+  }
+}
+
+auto IvfPqIterator::NextCluster() -> void {
+  ++current_prob_;
+  if (HasNextCluster()) {
+    ScanList();
+  }
+}
+
+auto IvfPqIterator::HasNextCluster() const -> bool {
+  return current_prob_ < probe_lists_.size();
+}
+
+auto IvfPqIterator::GetClusterKeys() const -> std::span<const Key> {
+  return cluster_keys_;
+}
+
+auto IvfPqIterator::GetClusterDistances() const -> std::span<const Float> {
+  return cluster_distances_;
+}
+
+}  // namespace rox
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "roxdb/db.h"
+#include "vector.h"
+
+namespace rox {
+
+// Splits vectors into m subspaces and quantizes each to one of 256 codewords,
+// so a vector is stored as an m-byte code.
+class ProductQuantizer {
+ public:
+  constexpr static const size_t kNumCodes = 256;
+
+  ProductQuantizer(size_t dim, size_t m);
+
+  // Train the codebooks with k-means on n row-major vectors
+  auto Train(const Float *data, size_t n) -> void;
+  auto IsTrained() const noexcept -> bool { return !codebooks_.empty(); }
+
+  auto Encode(std::span<const Float> v, uint8_t *code) const -> void;
+  auto Decode(const uint8_t *code, Float *v) const -> void;
+
+  // Distance from each subvector of query to each codeword of its subspace,
+  // m x kNumCodes, for a metric that sums over dimensions (L2, L1, IP)
+  auto ComputeTable(std::span<const Float> query, Metric metric,
+                    Float *table) const -> void;
+  // Asymmetric distance of a code from the query the table was computed for
+  auto LookupDistance(const Float *table, const uint8_t *code) const noexcept
+      -> Float {
+    Float distance = 0.0F;
+    for (size_t i = 0; i < m_; ++i) {
+      distance += table[(i * kNumCodes) + code[i]];
+    }
+    return distance;
+  }
+
+  auto GetCodeSize() const noexcept -> size_t { return m_; }
+  // m x kNumCodes x (dim / m) codewords
+  auto GetCodebooks() const noexcept -> const AlignedVector & {
+    return codebooks_;
+  }
+  auto SetCodebooks(std::span<const Float> codebooks) -> void;
+
+ private:
+  const size_t dim_;
+  const size_t m_;
+  const size_t dsub_;
+  AlignedVector codebooks_;
+
+  auto GetCodebook(size_t i) const noexcept -> const Float * {
+    return codebooks_.data() + (i * kNumCodes * dsub_);
+  }
+};  // class ProductQuantizer
+
+// IVF index storing PQ codes of the residuals to the list centroid instead of
+// full vectors. Until enough vectors are seen to train the quantizer they are
+// kept as full vectors in pending lists, which are searched exactly.
+class IvfPqIndex : public VectorIndex {
+ public:
+  // Vectors buffered before the quantizer is trained on their residuals
+  constexpr static const size_t kTrainSize = 39 * ProductQuantizer::kNumCodes;
+
+  IvfPqIndex(std::string field_name, size_t dim, size_t nlist, size_t pq_m,
+             Metric metric = Metric::kL2);
+
+  auto Put(const Key &key, const Vector &v) -> void override;
+  auto PutBatch(std::span<const Key> keys, const Float *data) -> void override;
+  auto Delete(const Key &key) -> void override;
+  // Removes key from the list of old_v only, unless the centroids changed
+  auto Update(const Key &key, std::span<const Float> old_v, const Vector &v)
+      -> void override;
+
+  auto NewIterator(const Vector &query, size_t nprobe) const
+      -> std::unique_ptr<VectorIterator> override;
+
+  auto GetType() const noexcept -> IndexType override {
+    return IndexType::kIvfPq;
+  }
+  auto GetName() const noexcept -> const std::string & override {
+    return field_name_;
+  }
+  auto GetMetric() const noexcept -> Metric override { return metric_; }
+  auto GetDim() const noexcept -> size_t override { return dim_; }
+
+  // Centroids can only be changed while the quantizer is untrained, as codes
+  // are relative to them
+  auto SetCentroids(const std::vector<Vector> &centroids) -> void;
+  // Train the quantizer on the pending vectors and encode them
+  auto Train() -> void;
+  auto IsTrained() const noexcept -> bool { return pq_.IsTrained(); }
+  auto GetNumPending() const noexcept -> size_t { return num_pending_; }
+
+  auto GetNumCentroids() const noexcept -> size_t { return nlist_; }
+  auto GetCentroid(CentroidId i) const noexcept -> std::span<const Float> {
+    return {centroids_.data() + (i * dim_), dim_};
+  }
+
+ private:
+  friend class IvfPqIterator;
+  friend class RdbStorage;
+  const std::string field_name_;
+  const size_t dim_;
+  const size_t nlist_;
+  const Metric metric_;
+
+  AlignedVector centroids_;  // nlist_ x dim_, row-major
+  ProductQuantizer pq_;
+  std::vector<CodeList> lists_;
+  std::vector<IvfList> pending_lists_;
+  size_t num_pending_ = 0;
+
+  // Add v to the given list, training first once enough vectors are pending
+  auto PutInList(CentroidId list, Key key, std::span<const Float> v) -> void;
+  // Whether key was found and removed from the given list
+  auto RemoveFromList(CentroidId list, Key key) -> bool;
+
+  auto Encode(CentroidId list, std::span<const Float> v, uint8_t *code) const
+      -> void;
+};  // class IvfPqIndex
+
+// Probes the nprobe nearest lists. Per probed list a distance table is built
+// once, and codes are scored by table lookups (asymmetric distance).
+class IvfPqIterator : public VectorIterator {
+ public:
+  IvfPqIterator(const IvfPqIndex &index, const Vector &query, size_t nprobe)
+      : index_(index),
+        query_(query),
+        nprobe_(nprobe),
+        reconstructed_(index.dim_) {}
+
+  auto Seek() -> void override;
+  auto Next() -> void override;
+  auto Valid() const -> bool override;
+
+  auto GetKey() const noexcept -> Key override;
+  // Reconstruction from the code, exact only for untrained entries
+  auto GetVector() const noexcept -> std::span<const Float> override;
+  auto GetDistance() const noexcept -> Float override;
+
+  auto SeekCluster() -> void override;
+  auto NextCluster() -> void override;
+  auto HasNextCluster() const -> bool override;
+  auto GetClusterKeys() const -> std::span<const Key> override;
+  auto GetClusterDistances() const -> std::span<const Float> override;
+
+ private:
+  using Candidate = std::pair<Float, size_t>;  // distance, slot in cluster
+  const IvfPqIndex &index_;
+  const Vector &query_;
+  const size_t nprobe_;
+
+  std::vector<CentroidId> probe_lists_;
+  size_t current_prob_ = 0;
+  AlignedVector table_;  // m x kNumCodes
+  // Current list, pending entries first then coded entries
+  std::vector<Key> cluster_keys_;
+  std::vector<Float> cluster_distances_;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>>
+      candidates_;
+  mutable Vector reconstructed_;
+
+  auto FindProbeLists() -> void;
+  auto ScanList() -> void;
+  auto CollectCandidates() -> void;
+};  // class IvfPqIterator
+
+}  // namespace rox
@@ -0,0 +1,324 @@
+#include "ivf_sq.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "roxdb/db.h"
+
+namespace rox {
+
+namespace {
+
+constexpr const Float kSq8Levels = 255.0F;
+
+}  // namespace
+
+ScalarQuantizer::ScalarQuantizer(size_t dim, Quantization type)
+    : dim_(dim), type_(type) {
+  if (type == Quantization::kNone) {
+    throw std::invalid_argument("Scalar quantizer needs a quantization type");
+  }
+}
+
+auto ScalarQuantizer::Train(const Float* data, size_t n) -> void {
+  if (type_ != Quantization::kSq8) {
+    return;
+  }
+  if (n == 0) {
+    throw std::runtime_error("No vectors to train the scalar quantizer on");
+  }
+  AlignedVector vmin(dim_, std::numeric_limits<Float>::max());
+  AlignedVector vmax(dim_, std::numeric_limits<Float>::lowest());
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t d = 0; d < dim_; ++d) {
+      vmin[d] = std::min(vmin[d], data[(i * dim_) + d]);
+      vmax[d] = std::max(vmax[d], data[(i * dim_) + d]);
+    }
+  }
+  AlignedVector scale(dim_);
+  for (size_t d = 0; d < dim_; ++d) {
+    scale[d] = (vmax[d] - vmin[d]) / kSq8Levels;
+  }
+  vmin_ = std::move(vmin);
+  scale_ = std::move(scale);
+}
+
+auto ScalarQuantizer::Encode(std::span<const Float> v, uint8_t* code) const
+    -> void {
+  assert(v.size() == dim_);
+  if (type_ == Quantization::kFp16) {
+    auto* halves = reinterpret_cast<uint16_t*>(code);
+    for (size_t d = 0; d < dim_; ++d) {
+      halves[d] = FloatToHalf(v[d]);
+    }
+    return;
+  }
+  for (size_t d = 0; d < dim_; ++d) {
+    const Float level =
+        scale_[d] > 0.0F ? std::round((v[d] - vmin_[d]) / scale_[d]) : 0.0F;
+    code[d] = static_cast<uint8_t>(std::clamp(level, 0.0F, kSq8Levels));
+  }
+}
+
+auto ScalarQuantizer::Decode(const uint8_t* code, Float* v) const -> void {
+  if (type_ == Quantization::kFp16) {
+    const auto* halves = reinterpret_cast<const uint16_t*>(code);
+    for (size_t d = 0; d < dim_; ++d) {
+      v[d] = HalfToFloat(halves[d]);
+    }
+    return;
+  }
+  for (size_t d = 0; d < dim_; ++d) {
+    v[d] = vmin_[d] + (code[d] * scale_[d]);
+  }
+}
+
+auto ScalarQuantizer::GetDistances(Metric metric, std::span<const Float> query,
+                                   const uint8_t* codes, size_t n,
+                                   Float* distances) const -> void {
+  assert(query.size() == dim_);
+  if (type_ == Quantization::kFp16) {
+    GetDistancesFp16(metric, query, reinterpret_cast<const uint16_t*>(codes),
+                     n, distances);
+  } else {
+    GetDistancesSq8(metric, query, codes, n, vmin_.data(), scale_.data(),
+                    distances);
+  }
+}
+
+auto ScalarQuantizer::SetRange(std::span<const Float> vmin,
+                               std::span<const Float> scale) -> void {
+  if (vmin.size() != dim_ || scale.size() != dim_) {
+    throw std::invalid_argument("SQ8 range size mismatch");
+  }
+  vmin_.assign(vmin.begin(), vmin.end());
+  scale_.assign(scale.begin(), scale.end());
+}
+
+IvfSqIndex::IvfSqIndex(std::string field_name, size_t dim, size_t nlist,
+                       Quantization quantization, Metric metric)
+    : field_name_(std::move(field_name)),
+      dim_(dim),
+      nlist_(nlist),
+      metric_(metric),
+      sq_(dim, quantization) {
+  centroids_.resize(nlist_ * dim_);
+  lists_.assign(nlist_, CodeList(sq_.GetCodeSize()));
+  pending_lists_.assign(nlist_, IvfList(dim_));
+}
+
+auto IvfSqIndex::Put(const Key& key, const Vector& v) -> void {
+  PutInList(AssignCentroid(v, centroids_.data(), nlist_, dim_, metric_), key,
+            v);
+}
+
+auto IvfSqIndex::PutBatch(std::span<const Key> keys, const Float* data)
+    -> void {
+  std::vector<CentroidId> assignments(keys.size());
+  AssignCentroids(data, keys.size(), centroids_.data(), nlist_, dim_, metric_,
+                  assignments.data());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    PutInList(assignments[i], keys[i], {data + (i * dim_), dim_});
+  }
+}
+
+auto IvfSqIndex::PutInList(CentroidId list, Key key, std::span<const Float> v)
+    -> void {
+  if (!IsTrained()) {
+    pending_lists_[list].Append(key, v);
+    if (++num_pending_ >= kTrainSize) {
+      Train();
+    }
+    return;
+  }
+
+  std::vector<uint8_t> code(sq_.GetCodeSize());
+  sq_.Encode(v, code.data());
+  lists_[list].Append(key, code.data());
+}
+
+auto IvfSqIndex::Delete(const Key& key) -> void {
+  for (auto& list : lists_) {
+    list.Remove(key);
+  }
+  for (auto& list : pending_lists_) {
+    const size_t size = list.Size();
+    list.Remove(key);
+    num_pending_ -= size - list.Size();
+  }
+}
+
+auto IvfSqIndex::Update(const Key& key, std::span<const Float> old_v,
+                        const Vector& v) -> void {
+  const auto list =
+      AssignCentroid(old_v, centroids_.data(), nlist_, dim_, metric_);
+  if (!RemoveFromList(list, key)) {
+    Delete(key);
+  }
+  Put(key, v);
+}
+
+auto IvfSqIndex::RemoveFromList(CentroidId list, Key key) -> bool {
+  const size_t size = lists_[list].Size();
+  const size_t pending_size = pending_lists_[list].Size();
+  lists_[list].Remove(key);
+  pending_lists_[list].Remove(key);
+  num_pending_ -= pending_size - pending_lists_[list].Size();
+  return lists_[list].Size() + pending_lists_[list].Size() !=
+         size + pending_size;
+}
+
+auto IvfSqIndex::NewIterator(const Vector& query, size_t nprobe) const
+    -> std::unique_ptr<VectorIterator> {
+  return std::make_unique<IvfSqIterator>(*this, query, nprobe);
+}
+
+auto IvfSqIndex::SetCentroids(const std::vector<Vector>& centroids) -> void {
+  assert(centroids.size() == nlist_);
+  for (size_t i = 0; i < nlist_; ++i) {
+    assert(centroids[i].size() == dim_);
+    std::ranges::copy(centroids[i], centroids_.begin() + (i * dim_));
+  }
+}
+
+auto IvfSqIndex::Train() -> void {
+  AlignedVector samples;
+  samples.reserve(num_pending_ * dim_);
+  for (const auto& pending : pending_lists_) {
+    samples.insert(samples.end(), pending.GetData(),
+                   pending.GetData() + (pending.Size() * dim_));
+  }
+  sq_.Train(samples.data(), num_pending_);
+
+  // Move pending vectors into the coded lists
+  std::vector<uint8_t> code(sq_.GetCodeSize());
+  for (CentroidId c = 0; c < nlist_; ++c) {
+    auto& pending = pending_lists_[c];
+    lists_[c].Reserve(lists_[c].Size() + pending.Size());
+    for (size_t i = 0; i < pending.Size(); ++i) {
+      sq_.Encode(pending.GetVector(i), code.data());
+      lists_[c].Append(pending.GetKey(i), code.data());
+    }
+    pending = IvfList(dim_);
+  }
+  num_pending_ = 0;
+}
+
+auto IvfSqIterator::FindProbeLists() -> void {
+  probe_lists_ =
+      FindNearestCentroids(query_, index_.centroids_.data(), index_.nlist_,
+                           index_.dim_, nprobe_, index_.metric_);
+  current_prob_ = 0;
+}
+
+auto IvfSqIterator::ScanList() -> void {
+  const auto list_idx = probe_lists_[current_prob_];
+  const auto& pending = index_.pending_lists_[list_idx];
+  const auto& list = index_.lists_[list_idx];
+
+  cluster_keys_.assign(pending.GetKeys().begin(), pending.GetKeys().end());
+  cluster_keys_.insert(cluster_keys_.end(), list.GetKeys().begin(),
+                       list.GetKeys().end());
+  cluster_distances_.resize(cluster_keys_.size());
+
+  // Pending vectors are scored exactly
+  GetDistances(index_.metric_, query_, pending.GetData(), pending.Size(),
+               cluster_distances_.data());
+  if (!list.Empty()) {
+    index_.sq_.GetDistances(index_.metric_, query_, list.GetCodes(),
+                            list.Size(),
+                            cluster_distances_.data() + pending.Size());
+  }
+}
+
+auto IvfSqIterator::CollectCandidates() -> void {
+  ScanList();
+  std::vector<Candidate> candidates;
+  candidates.reserve(cluster_distances_.size());
+  for (size_t i = 0; i < cluster_distances_.size(); ++i) {
+    candidates.emplace_back(cluster_distances_[i], i);
+  }
+  // Heapify in O(n) instead of n pushes
+  candidates_ = decltype(candidates_)(std::greater<>(), std::move(candidates));
+}
+
+auto IvfSqIterator::Seek() -> void {
+  candidates_ = {};
+  FindProbeLists();
+  // Collect candidates from the first non-empty probe list
+  for (; current_prob_ < probe_lists_.size(); ++current_prob_) {
+    CollectCandidates();
+    if (!candidates_.empty()) {
+      break;
+    }
+  }
+}
+
+auto IvfSqIterator::Next() -> void {
+  candidates_.pop();
+  while (candidates_.empty()) {
+    ++current_prob_;
+    if (current_prob_ >= probe_lists_.size()) {
+      return;
+    }
+    CollectCandidates();
+  }
+}
+
+auto IvfSqIterator::Valid() const -> bool {
+  return current_prob_ < probe_lists_.size() && !candidates_.empty();
+}
+
+auto IvfSqIterator::GetKey() const noexcept -> Key {
+  return cluster_keys_[candidates_.top().second];
+}
+
+auto IvfSqIterator::GetVector() const noexcept -> std::span<const Float> {
+  const auto slot = candidates_.top().second;
+  const auto list_idx = probe_lists_[current_prob_];
+  const auto& pending = index_.pending_lists_[list_idx];
+  if (slot < pending.Size()) {
+    return pending.GetVector(slot);
+  }
+
+  const auto& list = index_.lists_[list_idx];
+  index_.sq_.Decode(list.GetCode(slot - pending.Size()),
+                    reconstructed_.data());
+  return reconstructed_;
+}
+
+auto IvfSqIterator::GetDistance() const noexcept -> Float {
+  return candidates_.top().first;
+}
+
+auto IvfSqIterator::SeekCluster() -> void {
+  FindProbeLists();
+  if (HasNextCluster()) {
+    ScanList();
+  }
+}
+
+auto IvfSqIterator::NextCluster() -> void {
+  ++current_prob_;
+  if (HasNextCluster()) {
+    ScanList();
+  }
+}
+
+auto IvfSqIterator::HasNextCluster() const -> bool {
+  return current_prob_ < probe_lists_.size();
+}
+
+auto IvfSqIterator::GetClusterKeys() const -> std::span<const Key> {
+  return cluster_keys_;
+}
+
+auto IvfSqIterator::GetClusterDistances() const -> std::span<const Float> {
+  return cluster_distances_;
+}
+
+}  // namespace rox
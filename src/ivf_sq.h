@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "roxdb/db.h"
+#include "vector.h"
+
+namespace rox {
+
+using Quantization = VectorField::Quantization;
+
+// Quantizes each dimension on its own: SQ8 maps [min, max] of a dimension
+// linearly onto 0..255, FP16 stores IEEE half floats.
+class ScalarQuantizer {
+ public:
+  ScalarQuantizer(size_t dim, Quantization type);
+
+  // Learn the per-dimension ranges from n row-major vectors (SQ8 only)
+  auto Train(const Float *data, size_t n) -> void;
+  auto IsTrained() const noexcept -> bool {
+    return type_ == Quantization::kFp16 || !vmin_.empty();
+  }
+
+  // Values outside the trained range are clamped
+  auto Encode(std::span<const Float> v, uint8_t *code) const -> void;
+  auto Decode(const uint8_t *code, Float *v) const -> void;
+
+  // Distances from query to n contiguous codes, decoded on the fly
+  auto GetDistances(Metric metric, std::span<const Float> query,
+                    const uint8_t *codes, size_t n, Float *distances) const
+      -> void;
+
+  auto GetType() const noexcept -> Quantization { return type_; }
+  auto GetCodeSize() const noexcept -> size_t {
+    return type_ == Quantization::kFp16 ? dim_ * sizeof(uint16_t) : dim_;
+  }
+  auto GetMin() const noexcept -> const AlignedVector & { return vmin_; }
+  auto GetScale() const noexcept -> const AlignedVector & { return scale_; }
+  auto SetRange(std::span<const Float> vmin, std::span<const Float> scale)
+      -> void;
+
+ private:
+  const size_t dim_;
+  const Quantization type_;
+  AlignedVector vmin_;   // SQ8 only
+  AlignedVector scale_;  // SQ8 only, (max - min) / 255
+};  // class ScalarQuantizer
+
+// IVF index storing scalar-quantized vectors in its inverted lists, 4x (SQ8)
+// or 2x (FP16) smaller than IvfFlatIndex. SQ8 ranges are learnt from the first
+// kTrainSize vectors, which are kept as full vectors in pending lists and
+// searched exactly until then.
+class IvfSqIndex : public VectorIndex {
+ public:
+  constexpr static const size_t kTrainSize = 1024;
+
+  IvfSqIndex(std::string field_name, size_t dim, size_t nlist,
+             Quantization quantization, Metric metric = Metric::kL2);
+
+  auto Put(const Key &key, const Vector &v) -> void override;
+  auto PutBatch(std::span<const Key> keys, const Float *data) -> void override;
+  auto Delete(const Key &key) -> void override;
+  // Removes key from the list of old_v only, unless the centroids changed
+  auto Update(const Key &key, std::span<const Float> old_v, const Vector &v)
+      -> void override;
+
+  auto NewIterator(const Vector &query, size_t nprobe) const
+      -> std::unique_ptr<VectorIterator> override;
+
+  // A storage mode of IVF-Flat fields, see VectorField::quantization
+  auto GetType() const noexcept -> IndexType override {
+    return IndexType::kIvfFlat;
+  }
+  auto GetName() const noexcept -> const std::string & override {
+    return field_name_;
+  }
+  auto GetMetric() const noexcept -> Metric override { return metric_; }
+  auto GetDim() const noexcept -> size_t override { return dim_; }
+
+  auto SetCentroids(const std::vector<Vector> &centroids) -> void;
+  // Train the quantizer on the pending vectors and encode them
+  auto Train() -> void;
+  auto IsTrained() const noexcept -> bool { return sq_.IsTrained(); }
+  auto GetNumPending() const noexcept -> size_t { return num_pending_; }
+
+  auto GetQuantization() const noexcept -> Quantization {
+    return sq_.GetType();
+  }
+  auto GetNumCentroids() const noexcept -> size_t { return nlist_; }
+  auto GetCentroid(CentroidId i) const noexcept -> std::span<const Float> {
+    return {centroids_.data() + (i * dim_), dim_};
+  }
+
+ private:
+  friend class IvfSqIterator;
+  friend class RdbStorage;
+  const std::string field_name_;
+  const size_t dim_;
+  const size_t nlist_;
+  const Metric metric_;
+
+  AlignedVector centroids_;  // nlist_ x dim_, row-major
+  ScalarQuantizer sq_;
+  std::vector<CodeList> lists_;
+  std::vector<IvfList> pending_lists_;
+  size_t num_pending_ = 0;
+
+  // Add v to the given list, training first once enough vectors are pending
+  auto PutInList(CentroidId list, Key key, std::span<const Float> v) -> void;
+  // Whether key was found and removed from the given list
+  auto RemoveFromList(CentroidId list, Key key) -> bool;
+};  // class IvfSqIndex
+
+// Probes the nprobe nearest lists, scoring each with one pass of the
+// quantized distance kernels over its code block.
+class IvfSqIterator : public VectorIterator {
+ public:
+  IvfSqIterator(const IvfSqIndex &index, const Vector &query, size_t nprobe)
+      : index_(index),
+        query_(query),
+        nprobe_(nprobe),
+        reconstructed_(index.dim_) {}
+
+  auto Seek() -> void override;
+  auto Next() -> void override;
+  auto Valid() const -> bool override;
+
+  auto GetKey() const noexcept -> Key override;
+  // Decoded vector, exact only for untrained entries
+  auto GetVector() const noexcept -> std::span<const Float> override;
+  auto GetDistance() const noexcept -> Float override;
+
+  auto SeekCluster() -> void override;
+  auto NextCluster() -> void override;
+  auto HasNextCluster() const -> bool override;
+  auto GetClusterKeys() const -> std::span<const Key> override;
+  auto GetClusterDistances() const -> std::span<const Float> override;
+
+ private:
+  using Candidate = std::pair<Float, size_t>;  // distance, slot in cluster
+  const IvfSqIndex &index_;
+  const Vector &query_;
+  const size_t nprobe_;
+
+  std::vector<CentroidId> probe_lists_;
+  size_t current_prob_ = 0;
+  // Current list, pending entries first then coded entries
+  std::vector<Key> cluster_keys_;
+  std::vector<Float> cluster_distances_;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>>
+      candidates_;
+  mutable Vector reconstructed_;
+
+  auto FindProbeLists() -> void;
+  auto ScanList() -> void;
+  auto CollectCandidates() -> void;
+};  // class IvfSqIterator
+
+}  // namespace rox
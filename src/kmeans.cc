@@ -0,0 +1,144 @@
+#include "kmeans.h"
+
+#include <algorithm>
+#include <cassert>
+#include <execution>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace rox {
+
+namespace {
+
+constexpr const size_t kBlockSize = 256;
+
+// Run fn(begin, end) over [0, n) in parallel blocks
+template <typename Fn>
+auto ForEachBlock(size_t n, Fn&& fn) -> void {
+  std::vector<size_t> blocks((n + kBlockSize - 1) / kBlockSize);
+  std::iota(blocks.begin(), blocks.end(), 0);
+  std::for_each(std::execution::par, blocks.begin(), blocks.end(),
+                [&](size_t block) {
+                  const size_t begin = block * kBlockSize;
+                  fn(begin, std::min(n, begin + kBlockSize));
+                });
+}
+
+// k-means++: each next seed is sampled with probability proportional to its
+// distance from the nearest seed so far
+auto SeedPlusPlus(const Float* data, size_t n, size_t dim, size_t k,
+                  Metric metric, std::mt19937& gen, Float* centroids) -> void {
+  std::uniform_int_distribution<size_t> pick(0, n - 1);
+  std::copy_n(data + (pick(gen) * dim), dim, centroids);
+
+  std::vector<Float> min_distances(n);
+  for (size_t c = 1; c < k; ++c) {
+    const std::span<const Float> last(centroids + ((c - 1) * dim), dim);
+    ForEachBlock(n, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const Float distance =
+            std::max(0.0F, GetDistance(metric, last, {data + (i * dim), dim}));
+        min_distances[i] =
+            c == 1 ? distance : std::min(min_distances[i], distance);
+      }
+    });
+
+    const double total = std::reduce(std::execution::par,
+                                     min_distances.begin(),
+                                     min_distances.end(), 0.0);
+    size_t next = pick(gen);
+    if (total > 0.0) {
+      double target = std::uniform_real_distribution<double>(0.0, total)(gen);
+      for (next = 0; next + 1 < n; ++next) {
+        target -= min_distances[next];
+        if (target < 0.0) {
+          break;
+        }
+      }
+    }
+    std::copy_n(data + (next * dim), dim, centroids + (c * dim));
+  }
+}
+
+}  // namespace
+
+auto KMeans(const Float* data, size_t n, size_t dim, size_t k,
+            const KMeansOptions& options) -> AlignedVector {
+  if (k == 0 || n < k) {
+    throw std::invalid_argument("k-means needs at least k training vectors");
+  }
+  const Metric metric = options.spherical ? Metric::kCosine : Metric::kL2;
+  std::mt19937 gen(options.seed);
+  std::uniform_int_distribution<size_t> pick(0, n - 1);
+
+  AlignedVector centroids(k * dim);
+  if (options.plus_plus_init) {
+    SeedPlusPlus(data, n, dim, k, metric, gen, centroids.data());
+  } else {
+    // Seed with k distinct samples
+    std::vector<size_t> samples(n);
+    std::iota(samples.begin(), samples.end(), 0);
+    std::ranges::shuffle(samples, gen);
+    for (size_t c = 0; c < k; ++c) {
+      std::copy_n(data + (samples[c] * dim), dim,
+                  centroids.begin() + (c * dim));
+    }
+  }
+
+  std::vector<CentroidId> assignments(n);
+  std::vector<size_t> offsets(k + 1);
+  std::vector<size_t> members(n);
+  std::vector<CentroidId> clusters(k);
+  std::iota(clusters.begin(), clusters.end(), 0);
+  for (size_t iter = 0; iter < options.iters; ++iter) {
+    AssignCentroids(data, n, centroids.data(), k, dim, metric,
+                    assignments.data());
+
+    // Group vector ids by cluster (counting sort)
+    std::ranges::fill(offsets, 0);
+    for (const auto c : assignments) {
+      ++offsets[c + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+      members[next[assignments[i]]++] = i;
+    }
+
+    // Move each centroid to the mean of its vectors
+    std::for_each(
+        std::execution::par, clusters.begin(), clusters.end(),
+        [&](CentroidId c) {
+          Float* centroid = centroids.data() + (c * dim);
+          const size_t count = offsets[c + 1] - offsets[c];
+          if (count == 0) {
+            return;
+          }
+          std::fill_n(centroid, dim, 0.0F);
+          for (size_t m = offsets[c]; m < offsets[c + 1]; ++m) {
+            const Float* v = data + (members[m] * dim);
+            for (size_t d = 0; d < dim; ++d) {
+              centroid[d] += v[d];
+            }
+          }
+          const Float scale = 1.0F / static_cast<Float>(count);
+          for (size_t d = 0; d < dim; ++d) {
+            centroid[d] *= scale;
+          }
+          if (options.spherical) {
+            NormalizeVector({centroid, dim});
+          }
+        });
+    for (size_t c = 0; c < k; ++c) {
+      if (offsets[c + 1] == offsets[c]) {
+        std::copy_n(data + (pick(gen) * dim), dim,
+                    centroids.begin() + (c * dim));
+      }
+    }
+  }
+  return centroids;
+}
+
+}  // namespace rox
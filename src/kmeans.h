@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "roxdb/db.h"
+#include "vector.h"
+
+namespace rox {
+
+struct KMeansOptions {
+  size_t iters = 25;
+  // Seed with k-means++ instead of distinct random samples
+  bool plus_plus_init = true;
+  // Assign by cosine distance and keep centroids unit length, for normalized
+  // data. Otherwise vectors are clustered under squared L2.
+  bool spherical = false;
+  uint32_t seed = 42;
+};  // struct KMeansOptions
+
+// Lloyd's k-means over n row-major vectors of dim floats. Assignment runs in
+// parallel blocks with the batched distance kernels, and clusters left empty
+// are re-seeded from random samples. Returns the k x dim centroid matrix.
+auto KMeans(const Float *data, size_t n, size_t dim, size_t k,
+            const KMeansOptions &options = {}) -> AlignedVector;
+
+}  // namespace rox
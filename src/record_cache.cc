@@ -0,0 +1,123 @@
+#include "record_cache.h"
+
+#include <cassert>
+#include <string>
+#include <utility>
+#include <variant>
+
+namespace rox {
+
+auto GetRecordBytes(const Record& record) noexcept -> size_t {
+  size_t bytes = sizeof(Record) + (record.scalars.size() * sizeof(Scalar)) +
+                 (record.vectors.size() * sizeof(Vector));
+  for (const auto& scalar : record.scalars) {
+    if (const auto* str = std::get_if<std::string>(&scalar)) {
+      bytes += str->capacity();
+    }
+  }
+  for (const auto& vector : record.vectors) {
+    bytes += vector.capacity() * sizeof(Float);
+  }
+  return bytes;
+}
+
+RecordCache::RecordCache(size_t capacity_bytes)
+    : shard_capacity_(capacity_bytes / kNumShards) {}
+
+auto RecordCache::GetShard(Key key) noexcept -> Shard& {
+  // Mix the bits, sequential keys would otherwise share low bit patterns
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return shards_[key % kNumShards];
+}
+
+auto RecordCache::Get(Key key) -> std::shared_ptr<const Record> {
+  auto& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.slots.find(key);
+  if (it == shard.slots.end()) {
+    ++misses_;
+    return nullptr;
+  }
+  ++hits_;
+  auto& entry = shard.entries[it->second];
+  entry.referenced = true;
+  return entry.record;
+}
+
+auto RecordCache::Put(Key key, std::shared_ptr<const Record> record) -> void {
+  const size_t bytes = GetRecordBytes(*record);
+  auto& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (auto it = shard.slots.find(key); it != shard.slots.end()) {
+    shard.Remove(it->second);
+  }
+  if (bytes > shard_capacity_) {
+    return;
+  }
+  while (shard.bytes + bytes > shard_capacity_) {
+    Evict(shard);
+  }
+  shard.slots[key] = shard.entries.size();
+  shard.entries.push_back({key, std::move(record), bytes, false});
+  shard.bytes += bytes;
+}
+
+auto RecordCache::Erase(Key key) -> void {
+  auto& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (auto it = shard.slots.find(key); it != shard.slots.end()) {
+    shard.Remove(it->second);
+  }
+}
+
+auto RecordCache::Clear() -> void {
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.slots.clear();
+    shard.entries.clear();
+    shard.hand = 0;
+    shard.bytes = 0;
+  }
+}
+
+auto RecordCache::HasRoom(size_t bytes) const noexcept -> bool {
+  return GetBytes() + bytes <= shard_capacity_ * kNumShards;
+}
+
+auto RecordCache::GetBytes() const noexcept -> size_t {
+  size_t bytes = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    bytes += shard.bytes;
+  }
+  return bytes;
+}
+
+auto RecordCache::Shard::Remove(size_t slot) -> void {
+  // Move the last entry into the hole
+  bytes -= entries[slot].bytes;
+  slots.erase(entries[slot].key);
+  if (slot + 1 != entries.size()) {
+    entries[slot] = std::move(entries.back());
+    slots[entries[slot].key] = slot;
+  }
+  entries.pop_back();
+  if (hand >= entries.size()) {
+    hand = 0;
+  }
+}
+
+auto RecordCache::Evict(Shard& shard) -> void {
+  assert(!shard.entries.empty());
+  // Second chance: clear reference bits until an unreferenced entry
+  while (shard.entries[shard.hand].referenced) {
+    shard.entries[shard.hand].referenced = false;
+    shard.hand = (shard.hand + 1) % shard.entries.size();
+  }
+  shard.Remove(shard.hand);
+  ++evictions_;
+}
+
+}  // namespace rox
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "roxdb/db.h"
+
+namespace rox {
+
+// Approximate memory held by a record
+auto GetRecordBytes(const Record &record) noexcept -> size_t;
+
+// Cache of clean records bounded by a byte budget. Keys are spread over
+// kNumShards shards, each with its own lock and CLOCK eviction: a hit sets the
+// entry's reference bit, and the hand evicts the first entry found with the
+// bit cleared, clearing bits as it passes. Records are shared, so an evicted
+// record stays valid for readers still holding it.
+class RecordCache {
+ public:
+  constexpr static const size_t kNumShards = 16;
+
+  explicit RecordCache(size_t capacity_bytes);
+
+  // nullptr on a miss
+  auto Get(Key key) -> std::shared_ptr<const Record>;
+  // Insert or replace, evicting as needed. Records larger than a shard's
+  // budget are not cached.
+  auto Put(Key key, std::shared_ptr<const Record> record) -> void;
+  auto Erase(Key key) -> void;
+  auto Clear() -> void;
+
+  // Whether another record of the given size fits without evictions
+  auto HasRoom(size_t bytes) const noexcept -> bool;
+  // False with a zero budget, then nothing is cached
+  auto IsEnabled() const noexcept -> bool { return shard_capacity_ > 0; }
+
+  auto GetHits() const noexcept -> size_t { return hits_; }
+  auto GetMisses() const noexcept -> size_t { return misses_; }
+  auto GetEvictions() const noexcept -> size_t { return evictions_; }
+  auto GetBytes() const noexcept -> size_t;
+
+ private:
+  struct Entry {
+    Key key;
+    std::shared_ptr<const Record> record;
+    size_t bytes;
+    bool referenced;
+  };  // struct Entry
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<Key, size_t> slots;  // key -> index in entries
+    std::vector<Entry> entries;
+    size_t hand = 0;
+    size_t bytes = 0;
+
+    auto Remove(size_t slot) -> void;
+  };  // struct Shard
+
+  const size_t shard_capacity_;
+  std::array<Shard, kNumShards> shards_;
+  std::atomic<size_t> hits_ = 0;
+  std::atomic<size_t> misses_ = 0;
+  std::atomic<size_t> evictions_ = 0;
+
+  auto GetShard(Key key) noexcept -> Shard &;
+  auto Evict(Shard &shard) -> void;
+};  // class RecordCache
+
+}  // namespace rox
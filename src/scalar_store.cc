@@ -0,0 +1,299 @@
+#include "scalar_store.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <variant>
+
+namespace rox {
+
+namespace {
+
+static_assert(sizeof(int) == sizeof(int32_t), "Int scalars must be 32-bit");
+
+template <typename T, typename Compare>
+auto FilterValues(const T* values, size_t n, T value, uint64_t* bits) -> void {
+  const Compare compare;
+  for (size_t begin = 0; begin < n; begin += Bitmap::kWordBits) {
+    const size_t end = std::min(n, begin + Bitmap::kWordBits);
+    uint64_t word = 0;
+    for (size_t i = begin; i < end; ++i) {
+      word |= static_cast<uint64_t>(compare(values[i], value)) << (i - begin);
+    }
+    bits[begin / Bitmap::kWordBits] &= word;
+  }
+}
+
+template <typename T>
+auto FilterScalar(const T* values, size_t n, ScalarFilter::Op op, T value,
+                  uint64_t* bits) -> void {
+  switch (op) {
+    case ScalarFilter::Op::kEq:
+      return FilterValues<T, std::equal_to<>>(values, n, value, bits);
+    case ScalarFilter::Op::kNe:
+      return FilterValues<T, std::not_equal_to<>>(values, n, value, bits);
+    case ScalarFilter::Op::kGt:
+      return FilterValues<T, std::greater<>>(values, n, value, bits);
+    case ScalarFilter::Op::kGe:
+      return FilterValues<T, std::greater_equal<>>(values, n, value, bits);
+    case ScalarFilter::Op::kLt:
+      return FilterValues<T, std::less<>>(values, n, value, bits);
+    case ScalarFilter::Op::kLe:
+      return FilterValues<T, std::less_equal<>>(values, n, value, bits);
+  }
+}
+
+auto SelectFilterKernels() noexcept -> const FilterKernels& {
+  __builtin_cpu_init();
+#ifdef ROX_WITH_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return kAvx2FilterKernels;
+  }
+#endif
+  return kScalarFilterKernels;
+}
+
+// Stands for the values of a column in comparisons with another type, which
+// std::variant orders by type alone
+auto GetPlaceholder(ScalarField::Type type) -> Scalar {
+  switch (type) {
+    case ScalarField::Type::kDouble:
+      return 0.0;
+    case ScalarField::Type::kInt:
+      return 0;
+    case ScalarField::Type::kString:
+      return std::string();
+  }
+  throw std::invalid_argument("Unknown scalar type");
+}
+
+}  // namespace
+
+const FilterKernels kScalarFilterKernels = {
+    .name = "scalar",
+    .int32_filter = FilterScalar<int32_t>,
+    .double_filter = FilterScalar<double>,
+};
+
+auto GetFilterKernels() noexcept -> const FilterKernels& {
+  static const FilterKernels& kernels = SelectFilterKernels();
+  return kernels;
+}
+
+ScalarStore::ScalarStore(const Schema& schema) {
+  for (const auto& field : schema.scalar_fields) {
+    column_idx_[field.name] = columns_.size();
+    columns_.emplace_back().type = field.type;
+  }
+}
+
+auto ScalarStore::Put(Key key, const std::vector<Scalar>& scalars) -> void {
+  std::unique_lock lock(mutex_);
+  auto [it, inserted] = rows_.try_emplace(key, 0);
+  if (inserted) {
+    if (!free_rows_.empty()) {
+      it->second = free_rows_.back();
+      free_rows_.pop_back();
+      keys_[it->second] = key;
+    } else {
+      it->second = static_cast<uint32_t>(keys_.size());
+      keys_.push_back(key);
+      live_.Resize(keys_.size());
+      for (auto& column : columns_) {
+        column.ints.resize(
+            column.type == ScalarField::Type::kInt ? keys_.size() : 0);
+        column.doubles.resize(
+            column.type == ScalarField::Type::kDouble ? keys_.size() : 0);
+        column.codes.resize(
+            column.type == ScalarField::Type::kString ? keys_.size() : 0);
+      }
+    }
+    live_.Set(it->second);
+  }
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    SetValue(columns_[i], it->second,
+             i < scalars.size() ? &scalars[i] : nullptr);
+  }
+}
+
+auto ScalarStore::Delete(Key key) -> void {
+  std::unique_lock lock(mutex_);
+  auto it = rows_.find(key);
+  if (it == rows_.end()) {
+    return;
+  }
+  const uint32_t row = it->second;
+  live_.Set(row, false);
+  free_rows_.push_back(row);
+  rows_.erase(it);
+  for (auto& column : columns_) {
+    column.others.erase(row);
+  }
+}
+
+auto ScalarStore::GetRow(Key key) const -> std::optional<uint32_t> {
+  std::shared_lock lock(mutex_);
+  return FindRow(key);
+}
+
+auto ScalarStore::GetKey(uint32_t row) const -> Key {
+  std::shared_lock lock(mutex_);
+  return keys_[row];
+}
+
+auto ScalarStore::GetNumRows() const -> size_t {
+  std::shared_lock lock(mutex_);
+  return keys_.size();
+}
+
+auto ScalarStore::GetNumRecords() const -> size_t {
+  std::shared_lock lock(mutex_);
+  return rows_.size();
+}
+
+auto ScalarStore::FindRow(Key key) const -> std::optional<uint32_t> {
+  auto it = rows_.find(key);
+  if (it == rows_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+auto ScalarStore::Summarize(std::span<const Key> keys,
+                            ZoneMap& zone_map) const -> void {
+  std::shared_lock lock(mutex_);
+  std::vector<uint32_t> rows;
+  rows.reserve(keys.size());
+  for (const auto key : keys) {
+    if (const auto row = FindRow(key)) {
+      rows.push_back(*row);
+    }
+  }
+  std::vector<uint32_t> codes;
+  for (size_t field = 0; field < columns_.size(); ++field) {
+    const auto& column = columns_[field];
+    codes.clear();
+    for (const auto row : rows) {
+      if (auto it = column.others.find(row); it != column.others.end()) {
+        if (it->second) {
+          zone_map.Add(field, *it->second);
+        }
+      } else if (column.type == ScalarField::Type::kInt) {
+        zone_map.Add(field, column.ints[row]);
+      } else if (column.type == ScalarField::Type::kDouble) {
+        zone_map.Add(field, column.doubles[row]);
+      } else {
+        codes.push_back(column.codes[row]);
+      }
+    }
+    // Each distinct string is added once
+    std::ranges::sort(codes);
+    const auto [first, last] = std::ranges::unique(codes);
+    codes.erase(first, last);
+    for (const auto code : codes) {
+      zone_map.Add(field, column.dictionary[code]);
+    }
+  }
+}
+
+auto ScalarStore::SetValue(Column& column, uint32_t row, const Scalar* scalar)
+    -> void {
+  const bool typed = scalar != nullptr &&
+                     scalar->index() == GetPlaceholder(column.type).index();
+  if (typed) {
+    column.others.erase(row);
+  } else {
+    column.others[row] =
+        scalar != nullptr ? std::optional<Scalar>(*scalar) : std::nullopt;
+  }
+  switch (column.type) {
+    case ScalarField::Type::kInt:
+      column.ints[row] = typed ? std::get<int>(*scalar) : 0;
+      break;
+    case ScalarField::Type::kDouble:
+      column.doubles[row] = typed ? std::get<double>(*scalar) : 0.0;
+      break;
+    case ScalarField::Type::kString: {
+      if (!typed) {
+        column.codes[row] = 0;
+        break;
+      }
+      const auto& value = std::get<std::string>(*scalar);
+      auto [it, inserted] = column.dictionary_codes.try_emplace(
+          value, static_cast<uint32_t>(column.dictionary.size()));
+      if (inserted) {
+        column.dictionary.push_back(value);
+      }
+      column.codes[row] = it->second;
+      break;
+    }
+  }
+}
+
+auto ScalarStore::Filter(std::span<const ScalarFilter> filters) const
+    -> Bitmap {
+  std::shared_lock lock(mutex_);
+  Bitmap bits = live_;
+  for (const auto& filter : filters) {
+    ApplyFilter(columns_[column_idx_.at(filter.field)], filter, bits);
+  }
+  return bits;
+}
+
+auto ScalarStore::ApplyFilter(const Column& column, const ScalarFilter& filter,
+                              Bitmap& bits) const -> void {
+  using Op = ScalarFilter::Op;
+  const auto& kernels = GetFilterKernels();
+  const size_t n = keys_.size();
+  uint64_t* words = bits.GetWords();
+
+  // Rows kept aside are matched after the pass over the typed array
+  std::vector<std::pair<uint32_t, bool>> others;
+  others.reserve(column.others.size());
+  for (const auto& [row, scalar] : column.others) {
+    others.emplace_back(row, bits.Test(row) && scalar.has_value() &&
+                                 MatchFilter(*scalar, filter));
+  }
+
+  const Scalar placeholder = GetPlaceholder(column.type);
+  if (filter.value.index() != placeholder.index()) {
+    if (!MatchFilter(placeholder, filter)) {
+      bits = Bitmap(n);
+    }
+  } else if (column.type == ScalarField::Type::kInt) {
+    kernels.int32_filter(column.ints.data(), n, filter.op,
+                         std::get<int>(filter.value), words);
+  } else if (column.type == ScalarField::Type::kDouble) {
+    kernels.double_filter(column.doubles.data(), n, filter.op,
+                          std::get<double>(filter.value), words);
+  } else if (filter.op == Op::kEq || filter.op == Op::kNe) {
+    // Equality compares codes, dictionaries stay far below 2^31 entries
+    auto it = column.dictionary_codes.find(std::get<std::string>(filter.value));
+    if (it != column.dictionary_codes.end()) {
+      const auto* codes =
+          reinterpret_cast<const int32_t*>(column.codes.data());
+      kernels.int32_filter(codes, n, filter.op,
+                           static_cast<int32_t>(it->second), words);
+    } else if (filter.op == Op::kEq) {
+      bits = Bitmap(n);
+    }
+  } else {
+    // Ordered comparisons are decided once per dictionary entry
+    std::vector<bool> matches(column.dictionary.size());
+    for (size_t code = 0; code < matches.size(); ++code) {
+      matches[code] = MatchFilter(column.dictionary[code], filter);
+    }
+    for (size_t row = 0; row < n; ++row) {
+      if (!matches.empty() && !matches[column.codes[row]]) {
+        bits.Set(row, false);
+      }
+    }
+  }
+
+  for (const auto& [row, match] : others) {
+    bits.Set(row, match);
+  }
+}
+
+}  // namespace rox
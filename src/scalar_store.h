@@ -0,0 +1,151 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "roxdb/db.h"
+#include "zone_map.h"
+
+namespace rox {
+
+// Set of row ids, bit i of word i / 64 for row i
+class Bitmap {
+ public:
+  constexpr static const size_t kWordBits = 64;
+
+  Bitmap() = default;
+  explicit Bitmap(size_t n, bool value = false)
+      : words_((n + kWordBits - 1) / kWordBits, value ? ~uint64_t{0} : 0),
+        size_(n) {
+    ClearTail();
+  }
+
+  auto Test(size_t i) const noexcept -> bool {
+    return i < size_ && ((words_[i / kWordBits] >> (i % kWordBits)) & 1) != 0;
+  }
+  auto Set(size_t i, bool value = true) noexcept -> void {
+    const uint64_t bit = uint64_t{1} << (i % kWordBits);
+    words_[i / kWordBits] =
+        value ? (words_[i / kWordBits] | bit) : (words_[i / kWordBits] & ~bit);
+  }
+  auto Resize(size_t n) -> void {
+    words_.resize((n + kWordBits - 1) / kWordBits, 0);
+    size_ = n;
+    ClearTail();
+  }
+  // Call fn(i) for each set bit i, in ascending order
+  template <typename Fn>
+  auto ForEach(Fn &&fn) const -> void {
+    for (size_t w = 0; w < words_.size(); ++w) {
+      for (uint64_t word = words_[w]; word != 0; word &= word - 1) {
+        fn((w * kWordBits) + std::countr_zero(word));
+      }
+    }
+  }
+  auto Count() const noexcept -> size_t {
+    size_t count = 0;
+    for (const auto word : words_) {
+      count += std::popcount(word);
+    }
+    return count;
+  }
+
+  auto Size() const noexcept -> size_t { return size_; }
+  auto GetWords() noexcept -> uint64_t * { return words_.data(); }
+  auto GetWords() const noexcept -> const uint64_t * { return words_.data(); }
+
+ private:
+  std::vector<uint64_t> words_;
+  size_t size_ = 0;
+
+  // Bits past the size stay cleared
+  auto ClearTail() noexcept -> void {
+    if (size_ % kWordBits != 0) {
+      words_.back() &= (uint64_t{1} << (size_ % kWordBits)) - 1;
+    }
+  }
+};  // class Bitmap
+
+// Kernels comparing n contiguous values to a constant. Bit i of bits is
+// cleared unless values[i] op value holds, so that filters of a conjunction
+// are applied one after another to the same bitmap.
+struct FilterKernels {
+  using Int32FilterFn = auto (*)(const int32_t *values, size_t n,
+                                 ScalarFilter::Op op, int32_t value,
+                                 uint64_t *bits) -> void;
+  using DoubleFilterFn = auto (*)(const double *values, size_t n,
+                                  ScalarFilter::Op op, double value,
+                                  uint64_t *bits) -> void;
+
+  const char *name;
+  Int32FilterFn int32_filter;
+  DoubleFilterFn double_filter;
+};  // struct FilterKernels
+
+extern const FilterKernels kScalarFilterKernels;
+#ifdef ROX_WITH_AVX2
+extern const FilterKernels kAvx2FilterKernels;
+#endif
+
+// Kernels for the host CPU, selected via cpuid on first use
+auto GetFilterKernels() noexcept -> const FilterKernels &;
+
+// In-memory columnar copy of the scalar fields of all records, indexed by
+// a dense row id per key. Ints and doubles are stored in typed arrays and
+// strings as codes into a per-field dictionary, so a filter is evaluated for
+// all rows with one pass of the comparison kernels. Safe for concurrent
+// readers, e.g. the warm-up thread summarizing lists while records are put.
+class ScalarStore {
+ public:
+  explicit ScalarStore(const Schema &schema);
+
+  // Insert or replace the scalars of key
+  auto Put(Key key, const std::vector<Scalar> &scalars) -> void;
+  auto Delete(Key key) -> void;
+
+  // Rows of live records matching all filters
+  auto Filter(std::span<const ScalarFilter> filters) const -> Bitmap;
+  // Row of key, std::nullopt if there is no record with the key
+  auto GetRow(Key key) const -> std::optional<uint32_t>;
+  auto GetKey(uint32_t row) const -> Key;
+  auto GetNumRows() const -> size_t;
+  auto GetNumRecords() const -> size_t;
+  // Add the scalars of the records of keys to zone_map
+  auto Summarize(std::span<const Key> keys, ZoneMap &zone_map) const -> void;
+
+ private:
+  struct Column {
+    ScalarField::Type type;
+    std::vector<int32_t> ints;
+    std::vector<double> doubles;
+    std::vector<uint32_t> codes;  // strings, into dictionary
+    std::vector<std::string> dictionary;
+    std::unordered_map<std::string, uint32_t> dictionary_codes;
+    // Rows whose scalar is missing or not of the field type, matched one by
+    // one. The typed arrays hold a placeholder for them.
+    std::unordered_map<uint32_t, std::optional<Scalar>> others;
+  };  // struct Column
+
+  mutable std::shared_mutex mutex_;
+  std::vector<Column> columns_;  // parallel to Schema::scalar_fields
+  std::unordered_map<std::string, size_t> column_idx_;
+  std::unordered_map<Key, uint32_t> rows_;
+  std::vector<Key> keys_;
+  Bitmap live_;
+  std::vector<uint32_t> free_rows_;
+
+  auto FindRow(Key key) const -> std::optional<uint32_t>;
+  auto SetValue(Column &column, uint32_t row, const Scalar *scalar) -> void;
+  // Clear the bits of rows of column not matching filter
+  auto ApplyFilter(const Column &column, const ScalarFilter &filter,
+                   Bitmap &bits) const -> void;
+};  // class ScalarStore
+
+}  // namespace rox
@@ -0,0 +1,118 @@
+#ifdef ROX_WITH_AVX2
+
+#include <immintrin.h>
+
+#include "scalar_store.h"
+
+namespace rox {
+
+namespace {
+
+constexpr const size_t kInt32sPerAvx2 = 8;
+constexpr const size_t kDoublesPerAvx2 = 4;
+
+using Op = ScalarFilter::Op;
+
+// Mask of the lanes of v for which v op x holds
+template <Op kOp>
+auto CompareInt32(__m256i v, __m256i x) -> uint64_t {
+  __m256i cmp;
+  if constexpr (kOp == Op::kEq || kOp == Op::kNe) {
+    cmp = _mm256_cmpeq_epi32(v, x);
+  } else if constexpr (kOp == Op::kGt || kOp == Op::kLe) {
+    cmp = _mm256_cmpgt_epi32(v, x);
+  } else {
+    cmp = _mm256_cmpgt_epi32(x, v);
+  }
+  const auto mask = static_cast<uint64_t>(
+      _mm256_movemask_ps(_mm256_castsi256_ps(cmp)));
+  constexpr const bool kNegate =
+      kOp == Op::kNe || kOp == Op::kLe || kOp == Op::kGe;
+  return kNegate ? (~mask & 0xFF) : mask;
+}
+
+template <Op kOp>
+auto FilterInt32Avx2(const int32_t* values, size_t n, int32_t value,
+                     uint64_t* bits) -> void {
+  const __m256i x = _mm256_set1_epi32(value);
+  const size_t full = n / Bitmap::kWordBits * Bitmap::kWordBits;
+  for (size_t begin = 0; begin < full; begin += Bitmap::kWordBits) {
+    uint64_t word = 0;
+    for (size_t j = 0; j < Bitmap::kWordBits; j += kInt32sPerAvx2) {
+      const __m256i v = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + begin + j));
+      word |= CompareInt32<kOp>(v, x) << j;
+    }
+    bits[begin / Bitmap::kWordBits] &= word;
+  }
+  kScalarFilterKernels.int32_filter(values + full, n - full, kOp, value,
+                                    bits + (full / Bitmap::kWordBits));
+}
+
+// Ordered predicates are false for NaN, kNe is true, as with operator!=
+template <Op kOp, int kPredicate>
+auto FilterDoubleAvx2(const double* values, size_t n, double value,
+                      uint64_t* bits) -> void {
+  const __m256d x = _mm256_set1_pd(value);
+  const size_t full = n / Bitmap::kWordBits * Bitmap::kWordBits;
+  for (size_t begin = 0; begin < full; begin += Bitmap::kWordBits) {
+    uint64_t word = 0;
+    for (size_t j = 0; j < Bitmap::kWordBits; j += kDoublesPerAvx2) {
+      const __m256d v = _mm256_loadu_pd(values + begin + j);
+      word |= static_cast<uint64_t>(
+                  _mm256_movemask_pd(_mm256_cmp_pd(v, x, kPredicate)))
+              << j;
+    }
+    bits[begin / Bitmap::kWordBits] &= word;
+  }
+  kScalarFilterKernels.double_filter(values + full, n - full, kOp, value,
+                                     bits + (full / Bitmap::kWordBits));
+}
+
+auto FilterInt32(const int32_t* values, size_t n, Op op, int32_t value,
+                 uint64_t* bits) -> void {
+  switch (op) {
+    case Op::kEq:
+      return FilterInt32Avx2<Op::kEq>(values, n, value, bits);
+    case Op::kNe:
+      return FilterInt32Avx2<Op::kNe>(values, n, value, bits);
+    case Op::kGt:
+      return FilterInt32Avx2<Op::kGt>(values, n, value, bits);
+    case Op::kGe:
+      return FilterInt32Avx2<Op::kGe>(values, n, value, bits);
+    case Op::kLt:
+      return FilterInt32Avx2<Op::kLt>(values, n, value, bits);
+    case Op::kLe:
+      return FilterInt32Avx2<Op::kLe>(values, n, value, bits);
+  }
+}
+
+auto FilterDouble(const double* values, size_t n, Op op, double value,
+                  uint64_t* bits) -> void {
+  switch (op) {
+    case Op::kEq:
+      return FilterDoubleAvx2<Op::kEq, _CMP_EQ_OQ>(values, n, value, bits);
+    case Op::kNe:
+      return FilterDoubleAvx2<Op::kNe, _CMP_NEQ_UQ>(values, n, value, bits);
+    case Op::kGt:
+      return FilterDoubleAvx2<Op::kGt, _CMP_GT_OQ>(values, n, value, bits);
+    case Op::kGe:
+      return FilterDoubleAvx2<Op::kGe, _CMP_GE_OQ>(values, n, value, bits);
+    case Op::kLt:
+      return FilterDoubleAvx2<Op::kLt, _CMP_LT_OQ>(values, n, value, bits);
+    case Op::kLe:
+      return FilterDoubleAvx2<Op::kLe, _CMP_LE_OQ>(values, n, value, bits);
+  }
+}
+
+}  // namespace
+
+const FilterKernels kAvx2FilterKernels = {
+    .name = "avx2",
+    .int32_filter = FilterInt32,
+    .double_filter = FilterDouble,
+};
+
+}  // namespace rox
+
+#endif  // ROX_WITH_AVX2
@@ -0,0 +1,208 @@
+#include "segment.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace rox {
+
+namespace {
+
+auto AlignUp(uint64_t offset) -> uint64_t {
+  constexpr const uint64_t kAlignment = IvfSegment::kAlignment;
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+auto Pad(std::ofstream& out, uint64_t offset) -> void {
+  static const char kZeros[IvfSegment::kAlignment] = {};
+  const auto pos = static_cast<uint64_t>(out.tellp());
+  out.write(kZeros, static_cast<std::streamsize>(offset - pos));
+}
+
+template <typename T>
+auto WriteArray(std::ofstream& out, const T* data, size_t n) -> void {
+  out.write(reinterpret_cast<const char*>(data),
+            static_cast<std::streamsize>(n * sizeof(T)));
+}
+
+auto SyncFile(const std::string& path) -> void {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0 || ::fsync(fd) != 0) {
+    const int error = errno;
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    throw std::runtime_error("Failed to sync index segment " + path + ": " +
+                             std::strerror(error));
+  }
+  ::close(fd);
+}
+
+}  // namespace
+
+auto IvfSegment::Write(const std::string& path, const IvfFlatIndex& index)
+    -> void {
+  const size_t dim = index.GetDim();
+  const size_t nlist = index.GetNumCentroids();
+  const auto& lists = index.GetInvertedLists();
+
+  std::vector<uint64_t> list_offsets(nlist + 1);
+  for (size_t c = 0; c < nlist; ++c) {
+    list_offsets[c + 1] = list_offsets[c] + lists[c].Size();
+  }
+  const uint64_t num_vectors = list_offsets.back();
+
+  Header header{};
+  std::copy_n(kMagic, sizeof(kMagic), header.magic);
+  header.version = kVersion;
+  header.metric = static_cast<uint32_t>(index.GetMetric());
+  header.dim = dim;
+  header.nlist = nlist;
+  header.num_vectors = num_vectors;
+  header.centroids_offset = AlignUp(sizeof(Header));
+  header.list_offsets_offset =
+      AlignUp(header.centroids_offset + (nlist * dim * sizeof(Float)));
+  header.keys_offset = AlignUp(header.list_offsets_offset +
+                               ((nlist + 1) * sizeof(uint64_t)));
+  header.vectors_offset =
+      AlignUp(header.keys_offset + (num_vectors * sizeof(Key)));
+  header.file_size =
+      header.vectors_offset + (num_vectors * dim * sizeof(Float));
+
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw std::runtime_error("Failed to create index segment " + tmp_path);
+    }
+    WriteArray(out, &header, 1);
+    Pad(out, header.centroids_offset);
+    WriteArray(out, index.GetCentroidData(), nlist * dim);
+    Pad(out, header.list_offsets_offset);
+    WriteArray(out, list_offsets.data(), list_offsets.size());
+    Pad(out, header.keys_offset);
+    for (const auto& list : lists) {
+      WriteArray(out, list.GetKeys().data(), list.Size());
+    }
+    Pad(out, header.vectors_offset);
+    for (const auto& list : lists) {
+      WriteArray(out, list.GetData(), list.Size() * dim);
+    }
+    if (!out.flush()) {
+      throw std::runtime_error("Failed to write index segment " + tmp_path);
+    }
+  }
+  SyncFile(tmp_path);
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    throw std::runtime_error("Failed to rename index segment " + tmp_path +
+                             ": " + std::strerror(errno));
+  }
+}
+
+auto IvfSegment::Open(const std::string& path)
+    -> std::shared_ptr<const IvfSegment> {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return nullptr;
+    }
+    throw std::runtime_error("Failed to open index segment " + path + ": " +
+                             std::strerror(errno));
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    ::close(fd);
+    throw std::runtime_error("Invalid index segment " + path);
+  }
+  const auto size = static_cast<size_t>(st.st_size);
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);  // the mapping keeps the file open
+  if (addr == MAP_FAILED) {
+    throw std::runtime_error("Failed to map index segment " + path + ": " +
+                             std::strerror(errno));
+  }
+  // The mapping is owned from here on, and released on a failed check
+  std::shared_ptr<const IvfSegment> segment(new IvfSegment(addr, size));
+
+  const Header& header = *segment->header_;
+  const uint64_t dim = header.dim;
+  const uint64_t nlist = header.nlist;
+  if (!std::equal(kMagic, kMagic + sizeof(kMagic), header.magic) ||
+      header.version != kVersion || header.file_size != size ||
+      header.centroids_offset + (nlist * dim * sizeof(Float)) > size ||
+      header.list_offsets_offset + ((nlist + 1) * sizeof(uint64_t)) > size ||
+      header.keys_offset + (header.num_vectors * sizeof(Key)) > size ||
+      header.vectors_offset + (header.num_vectors * dim * sizeof(Float)) >
+          size) {
+    throw std::runtime_error("Invalid index segment " + path);
+  }
+  const uint64_t* list_offsets = segment->GetListOffsets();
+  if (list_offsets[0] != 0 || list_offsets[nlist] != header.num_vectors ||
+      !std::is_sorted(list_offsets, list_offsets + nlist + 1)) {
+    throw std::runtime_error("Invalid index segment " + path);
+  }
+  // Probes touch few lists, do not read around faults
+  ::madvise(addr, size, MADV_RANDOM);
+  return segment;
+}
+
+IvfSegment::IvfSegment(void* addr, size_t size)
+    : addr_(addr), size_(size), header_(static_cast<const Header*>(addr)) {}
+
+IvfSegment::~IvfSegment() { ::munmap(addr_, size_); }
+
+auto IvfSegment::GetSection(uint64_t offset) const noexcept -> const char* {
+  return static_cast<const char*>(addr_) + offset;
+}
+
+auto IvfSegment::GetListOffsets() const noexcept -> const uint64_t* {
+  return reinterpret_cast<const uint64_t*>(
+      GetSection(header_->list_offsets_offset));
+}
+
+auto IvfSegment::GetCentroids() const noexcept -> const Float* {
+  return reinterpret_cast<const Float*>(
+      GetSection(header_->centroids_offset));
+}
+
+auto IvfSegment::GetList(CentroidId c) const noexcept -> IvfList {
+  const uint64_t begin = GetListOffsets()[c];
+  const uint64_t end = GetListOffsets()[c + 1];
+  const auto* keys =
+      reinterpret_cast<const Key*>(GetSection(header_->keys_offset));
+  const auto* vectors =
+      reinterpret_cast<const Float*>(GetSection(header_->vectors_offset));
+  return IvfList::View(header_->dim, keys + begin,
+                       vectors + (begin * header_->dim), end - begin);
+}
+
+auto IvfSegment::WillNeed(CentroidId c) const noexcept -> void {
+  const uint64_t begin = GetListOffsets()[c];
+  const uint64_t end = GetListOffsets()[c + 1];
+  if (begin == end) {
+    return;
+  }
+  const auto page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+  auto advise = [&](uint64_t from, uint64_t to) {
+    const uint64_t aligned = from / page * page;
+    ::madvise(const_cast<char*>(GetSection(aligned)), to - aligned,
+              MADV_WILLNEED);
+  };
+  const size_t vector_size = header_->dim * sizeof(Float);
+  advise(header_->keys_offset + (begin * sizeof(Key)),
+         header_->keys_offset + (end * sizeof(Key)));
+  advise(header_->vectors_offset + (begin * vector_size),
+         header_->vectors_offset + (end * vector_size));
+}
+
+}  // namespace rox
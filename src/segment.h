@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "roxdb/db.h"
+#include "vector.h"
+
+namespace rox {
+
+// Immutable IVF-Flat index file laid out to be used in place through mmap:
+//
+//   header | centroids   nlist x dim floats
+//          | offsets     nlist + 1 entry indexes, list c is [off[c], off[c+1])
+//          | keys        num_vectors keys, grouped by list
+//          | vectors     num_vectors x dim floats, parallel to keys
+//
+// Sections start on kAlignment-byte boundaries. Opening maps the file and
+// reads nothing but the header, pages of the lists are faulted in as they
+// are scanned and shared through the page cache between processes.
+class IvfSegment {
+ public:
+  constexpr static const size_t kAlignment = 64;
+
+  // Written to a temporary file renamed over path, so readers see either the
+  // previous or the new segment
+  static auto Write(const std::string &path, const IvfFlatIndex &index)
+      -> void;
+  // nullptr if there is no segment at path
+  static auto Open(const std::string &path)
+      -> std::shared_ptr<const IvfSegment>;
+
+  ~IvfSegment();
+  IvfSegment(const IvfSegment &) = delete;
+  IvfSegment &operator=(const IvfSegment &) = delete;
+
+  auto GetDim() const noexcept -> size_t { return header_->dim; }
+  auto GetNumLists() const noexcept -> size_t { return header_->nlist; }
+  auto GetMetric() const noexcept -> Metric {
+    return static_cast<Metric>(header_->metric);
+  }
+  // Contiguous nlist x dim centroid matrix
+  auto GetCentroids() const noexcept -> const Float *;
+  // View of list c, valid while the segment is alive
+  auto GetList(CentroidId c) const noexcept -> IvfList;
+  // Hint that list c is about to be scanned
+  auto WillNeed(CentroidId c) const noexcept -> void;
+
+ private:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t metric;
+    uint64_t dim;
+    uint64_t nlist;
+    uint64_t num_vectors;
+    uint64_t centroids_offset;
+    uint64_t list_offsets_offset;
+    uint64_t keys_offset;
+    uint64_t vectors_offset;
+    uint64_t file_size;
+  };  // struct Header
+
+  constexpr static const char kMagic[8] = {'R', 'O', 'X', 'I',
+                                           'V', 'F', 'S', 'G'};
+  constexpr static const uint32_t kVersion = 1;
+
+  void *addr_;
+  size_t size_;
+  const Header *header_;
+
+  IvfSegment(void *addr, size_t size);
+
+  auto GetListOffsets() const noexcept -> const uint64_t *;
+  auto GetSection(uint64_t offset) const noexcept -> const char *;
+};  // class IvfSegment
+
+}  // namespace rox
@@ -1,20 +1,540 @@
 #include "storage.h"
 
+#include <algorithm>
+#include <bit>
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <shared_mutex>
+#include <span>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "flatbuffers/flatbuffer_builder.h"
 #include "flatbuffers_generated.h"
+#include "hnsw.h"
+#include "ivf_pq.h"
+#include "ivf_sq.h"
+#include "record_cache.h"
+#include "rocksdb/cache.h"
 #include "rocksdb/db.h"
+#include "rocksdb/filter_policy.h"
+#include "rocksdb/sst_file_writer.h"
+#include "rocksdb/table.h"
+#include "rocksdb/write_batch.h"
 #include "roxdb/db.h"
+#include "segment.h"
 #include "vector.h"
 
 namespace rox {
 
+namespace {
+
+auto ToFbMetric(VectorField::Metric metric) -> fb::VectorMetric {
+  switch (metric) {
+    case VectorField::Metric::kL2:
+      return fb::VectorMetric_kL2;
+    case VectorField::Metric::kInnerProduct:
+      return fb::VectorMetric_kInnerProduct;
+    case VectorField::Metric::kCosine:
+      return fb::VectorMetric_kCosine;
+    case VectorField::Metric::kL1:
+      return fb::VectorMetric_kL1;
+  }
+  throw std::invalid_argument("Unknown vector metric");
+}
+
+auto FromFbMetric(fb::VectorMetric metric) -> VectorField::Metric {
+  switch (metric) {
+    case fb::VectorMetric_kL2:
+      return VectorField::Metric::kL2;
+    case fb::VectorMetric_kInnerProduct:
+      return VectorField::Metric::kInnerProduct;
+    case fb::VectorMetric_kCosine:
+      return VectorField::Metric::kCosine;
+    case fb::VectorMetric_kL1:
+      return VectorField::Metric::kL1;
+    default:
+      throw std::runtime_error("Unknown vector metric in schema");
+  }
+}
+
+auto ToFbIndexType(VectorField::IndexType type) -> fb::VectorIndexType {
+  switch (type) {
+    case VectorField::IndexType::kIvfFlat:
+      return fb::VectorIndexType_kIvfFlat;
+    case VectorField::IndexType::kHnsw:
+      return fb::VectorIndexType_kHnsw;
+    case VectorField::IndexType::kIvfPq:
+      return fb::VectorIndexType_kIvfPq;
+  }
+  throw std::invalid_argument("Unknown vector index type");
+}
+
+auto FromFbIndexType(fb::VectorIndexType type) -> VectorField::IndexType {
+  switch (type) {
+    case fb::VectorIndexType_kIvfFlat:
+      return VectorField::IndexType::kIvfFlat;
+    case fb::VectorIndexType_kHnsw:
+      return VectorField::IndexType::kHnsw;
+    case fb::VectorIndexType_kIvfPq:
+      return VectorField::IndexType::kIvfPq;
+    default:
+      throw std::runtime_error("Unknown vector index type in schema");
+  }
+}
+
+auto ToFbQuantization(VectorField::Quantization quantization)
+    -> fb::VectorQuantization {
+  switch (quantization) {
+    case VectorField::Quantization::kNone:
+      return fb::VectorQuantization_kNone;
+    case VectorField::Quantization::kSq8:
+      return fb::VectorQuantization_kSq8;
+    case VectorField::Quantization::kFp16:
+      return fb::VectorQuantization_kFp16;
+  }
+  throw std::invalid_argument("Unknown vector quantization");
+}
+
+auto FromFbQuantization(fb::VectorQuantization quantization)
+    -> VectorField::Quantization {
+  switch (quantization) {
+    case fb::VectorQuantization_kNone:
+      return VectorField::Quantization::kNone;
+    case fb::VectorQuantization_kSq8:
+      return VectorField::Quantization::kSq8;
+    case fb::VectorQuantization_kFp16:
+      return VectorField::Quantization::kFp16;
+    default:
+      throw std::runtime_error("Unknown vector quantization in schema");
+  }
+}
+
+constexpr const size_t kPartitionBytes = 1 << 24;
+
+// Of a stored record, empty if there is none
+auto GetVectors(const std::optional<RecordView>& record)
+    -> std::vector<Vector> {
+  return record ? record->ToRecord().vectors : std::vector<Vector>();
+}
+
+auto GetListBytes(const IvfList& list) -> size_t {
+  return list.Size() * (sizeof(Key) + (list.GetDim() * sizeof(Float)));
+}
+
+// End of the partition of quantized lists starting at offset, filled with
+// lists up to a byte budget
+auto GetPartitionEnd(const std::vector<CodeList>& lists,
+                     const std::vector<IvfList>& pending_lists, size_t offset)
+    -> size_t {
+  size_t end = offset;
+  size_t bytes = 0;
+  while (end < lists.size() && (end == offset || bytes < kPartitionBytes)) {
+    bytes += lists[end].Size() * (sizeof(Key) + lists[end].GetCodeSize()) +
+             GetListBytes(pending_lists[end]);
+    ++end;
+  }
+  return end;
+}
+
+auto GetPartitionEnd(const std::vector<IvfList>& lists, size_t offset)
+    -> size_t {
+  size_t end = offset;
+  size_t bytes = 0;
+  while (end < lists.size() && (end == offset || bytes < kPartitionBytes)) {
+    bytes += GetListBytes(lists[end]);
+    ++end;
+  }
+  return end;
+}
+
+auto CreateCodeLists(flatbuffers::FlatBufferBuilder& builder,
+                     const std::vector<CodeList>& lists, size_t offset,
+                     size_t end) {
+  std::vector<flatbuffers::Offset<fb::CodeList>> fb_lists;
+  fb_lists.reserve(end - offset);
+  for (size_t i = offset; i < end; ++i) {
+    const auto& list = lists[i];
+    fb_lists.push_back(fb::CreateCodeList(
+        builder, builder.CreateVector(list.GetKeys()),
+        builder.CreateVector(list.GetCodes(),
+                             list.Size() * list.GetCodeSize())));
+  }
+  return builder.CreateVector(fb_lists);
+}
+
+auto CreateIvfLists(flatbuffers::FlatBufferBuilder& builder,
+                        const std::vector<IvfList>& lists, size_t offset,
+                        size_t end) {
+  std::vector<flatbuffers::Offset<fb::IvfList>> fb_lists;
+  fb_lists.reserve(end - offset);
+  for (size_t i = offset; i < end; ++i) {
+    const auto& list = lists[i];
+    std::vector<flatbuffers::Offset<fb::IvfListEntry>> entries;
+    entries.reserve(list.Size());
+    for (size_t j = 0; j < list.Size(); ++j) {
+      const auto vec = list.GetVector(j);
+      auto vector_fb = fb::CreateVector(
+          builder, builder.CreateVector(vec.data(), vec.size()));
+      entries.push_back(
+          fb::CreateIvfListEntry(builder, list.GetKey(j), vector_fb));
+    }
+    fb_lists.push_back(
+        fb::CreateIvfList(builder, builder.CreateVector(entries)));
+  }
+  return builder.CreateVector(fb_lists);
+}
+
+// Partition keys do not sort numerically, order them by offset
+template <typename FbIndex>
+auto SortPartitions(std::vector<std::string>& partitions) -> void {
+  std::ranges::sort(partitions, {}, [](const std::string& value) {
+    return flatbuffers::GetRoot<FbIndex>(value.data())->offset();
+  });
+}
+
+auto ReadCodeList(const fb::CodeList* fb_list, CodeList& list) -> void {
+  const size_t n = fb_list->keys()->size();
+  if (fb_list->codes()->size() != n * list.GetCodeSize()) {
+    throw std::runtime_error("Inconsistent index metadata");
+  }
+  list.Reserve(n);
+  for (size_t j = 0; j < n; ++j) {
+    list.Append(fb_list->keys()->Get(j),
+                fb_list->codes()->data() + (j * list.GetCodeSize()));
+  }
+}
+
+auto ReadIvfList(const fb::IvfList* fb_list, IvfList& list) -> void {
+  for (const auto* entry : *fb_list->entries()) {
+    const auto* values = entry->vector()->values();
+    list.Append(entry->key(), {values->data(), values->size()});
+  }
+}
+
+auto AppendBigEndian(std::string& out, uint64_t value) -> void {
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    out.push_back(static_cast<char>((value >> shift) & 0xFF));
+  }
+}
+
+auto ReadBigEndian(const char* data) -> uint64_t {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+    value = (value << 8) | static_cast<uint8_t>(data[i]);
+  }
+  return value;
+}
+
+// Order-preserving encoding of scalars in secondary index keys. The variant
+// index comes first, as std::variant orders values of different types by it.
+auto AppendScalar(std::string& out, const Scalar& scalar) -> void {
+  out.push_back(static_cast<char>(scalar.index()));
+  if (const auto* value = std::get_if<double>(&scalar)) {
+    // -0.0 compares equal to 0.0, so both get the same key. Negative values
+    // have their bits flipped to sort in reverse, below the positive ones.
+    auto bits = std::bit_cast<uint64_t>(*value == 0.0 ? 0.0 : *value);
+    bits = (bits >> 63) != 0 ? ~bits : bits | (uint64_t{1} << 63);
+    AppendBigEndian(out, bits);
+  } else if (const auto* value = std::get_if<int>(&scalar)) {
+    const auto bits = static_cast<uint32_t>(*value) ^ (uint32_t{1} << 31);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      out.push_back(static_cast<char>((bits >> shift) & 0xFF));
+    }
+  } else {
+    // Zero bytes are escaped as 0x00 0xFF and the string ends with 0x00 0x01,
+    // so a string sorts before the strings it is a prefix of
+    for (const char c : std::get<std::string>(scalar)) {
+      out.push_back(c);
+      if (c == '\0') {
+        out.push_back('\xFF');
+      }
+    }
+    out.append("\0\x01", 2);
+  }
+}
+
+// Inverse of AppendScalar, data being the whole encoding
+auto ReadScalar(std::string_view data) -> Scalar {
+  switch (data.at(0)) {
+    case 0: {
+      auto bits = ReadBigEndian(data.data() + 1);
+      bits = (bits >> 63) != 0 ? bits & ~(uint64_t{1} << 63) : ~bits;
+      return std::bit_cast<double>(bits);
+    }
+    case 1: {
+      uint32_t bits = 0;
+      for (size_t i = 1; i <= sizeof(uint32_t); ++i) {
+        bits = (bits << 8) | static_cast<uint8_t>(data[i]);
+      }
+      return static_cast<int>(bits ^ (uint32_t{1} << 31));
+    }
+    default: {
+      // Without the type and the terminator
+      const auto escaped = data.substr(1, data.size() - 3);
+      std::string value;
+      for (size_t i = 0; i < escaped.size(); ++i) {
+        value.push_back(escaped[i]);
+        if (escaped[i] == '\0') {
+          ++i;  // skip the escape
+        }
+      }
+      return value;
+    }
+  }
+}
+
+auto ToFbScalar(flatbuffers::FlatBufferBuilder& builder,
+                const Scalar& scalar) -> flatbuffers::Offset<fb::Scalar> {
+  flatbuffers::Offset<void> fb_value;
+  fb::ScalarValue value_type;
+
+  if (std::holds_alternative<double>(scalar)) {
+    value_type = fb::ScalarValue_DoubleValue;
+    fb_value = fb::CreateDoubleValue(builder, std::get<double>(scalar)).Union();
+  } else if (std::holds_alternative<int>(scalar)) {
+    value_type = fb::ScalarValue_IntValue;
+    fb_value = fb::CreateIntValue(builder, std::get<int>(scalar)).Union();
+  } else if (std::holds_alternative<std::string>(scalar)) {
+    value_type = fb::ScalarValue_StringValue;
+    fb_value = fb::CreateStringValue(
+                   builder, builder.CreateString(std::get<std::string>(scalar)))
+                   .Union();
+  } else {
+    throw std::runtime_error("Unknown scalar type");
+  }
+  return fb::CreateScalar(builder, value_type, fb_value);
+}
+
+auto FromFbScalar(const fb::Scalar* fb_scalar) -> Scalar {
+  switch (fb_scalar->value_type()) {
+    case fb::ScalarValue_DoubleValue:
+      return fb_scalar->value_as_DoubleValue()->value();
+    case fb::ScalarValue_IntValue:
+      return fb_scalar->value_as_IntValue()->value();
+    case fb::ScalarValue_StringValue:
+      return fb_scalar->value_as_StringValue()->value()->str();
+    default:
+      throw std::runtime_error("Unknown scalar type");
+  }
+}
+
+// Serialize record into builder, finished
+auto BuildRecord(flatbuffers::FlatBufferBuilder& builder, const Record& record)
+    -> void {
+  std::vector<flatbuffers::Offset<fb::Scalar>> fb_scalars;
+  fb_scalars.reserve(record.scalars.size());
+  for (const auto& scalar : record.scalars) {
+    fb_scalars.push_back(ToFbScalar(builder, scalar));
+  }
+
+  std::vector<flatbuffers::Offset<fb::Vector>> fb_vectors;
+  for (const auto& vector : record.vectors) {
+    auto fb_vector = fb::CreateVector(
+        builder, builder.CreateVector(vector.data(), vector.size()));
+    fb_vectors.push_back(fb_vector);
+  }
+
+  auto fb_record =
+      fb::CreateRecord(builder, record.id, builder.CreateVector(fb_scalars),
+                       builder.CreateVector(fb_vectors));
+
+  builder.Finish(fb_record);
+}
+
+auto CreateZoneMap(flatbuffers::FlatBufferBuilder& builder, CentroidId list,
+                   const ZoneMap& zone_map)
+    -> flatbuffers::Offset<fb::ListZoneMap> {
+  std::vector<flatbuffers::Offset<fb::ScalarZone>> zones;
+  zones.reserve(zone_map.GetZones().size());
+  for (const auto& zone : zone_map.GetZones()) {
+    const auto min = zone.min ? ToFbScalar(builder, *zone.min)
+                              : flatbuffers::Offset<fb::Scalar>();
+    const auto max = zone.max ? ToFbScalar(builder, *zone.max)
+                              : flatbuffers::Offset<fb::Scalar>();
+    const auto bloom =
+        builder.CreateVector(zone.bloom.data(), zone.bloom.size());
+    zones.push_back(
+        fb::CreateScalarZone(builder, min, max, zone.has_nan, bloom));
+  }
+  return fb::CreateListZoneMap(builder, static_cast<uint32_t>(list),
+                               builder.CreateVector(zones));
+}
+
+auto ReadZoneMap(const fb::ListZoneMap* fb_zone_map) -> ZoneMap {
+  std::vector<ZoneMap::Zone> zones;
+  if (fb_zone_map->zones()) {
+    zones.reserve(fb_zone_map->zones()->size());
+    for (const auto* fb_zone : *fb_zone_map->zones()) {
+      if (!fb_zone->bloom() ||
+          fb_zone->bloom()->size() != ZoneMap::kBloomWords) {
+        throw std::runtime_error("Inconsistent index metadata");
+      }
+      auto& zone = zones.emplace_back();
+      if (fb_zone->min()) {
+        zone.min = FromFbScalar(fb_zone->min());
+      }
+      if (fb_zone->max()) {
+        zone.max = FromFbScalar(fb_zone->max());
+      }
+      zone.has_nan = fb_zone->has_nan();
+      std::copy_n(fb_zone->bloom()->data(), ZoneMap::kBloomWords,
+                  zone.bloom.begin());
+    }
+  }
+  return ZoneMap(std::move(zones));
+}
+
+auto ToRdbCompression(DbOptions::Compression compression)
+    -> rocksdb::CompressionType {
+  switch (compression) {
+    case DbOptions::Compression::kNone:
+      return rocksdb::kNoCompression;
+    case DbOptions::Compression::kLz4:
+      return rocksdb::kLZ4Compression;
+    case DbOptions::Compression::kZstd:
+      return rocksdb::kZSTD;
+  }
+  throw std::invalid_argument("Unknown compression");
+}
+
+// DB-wide options and the column family options shared by all of them
+auto MakeRdbOptions(const DbOptions& options) -> rocksdb::Options {
+  rocksdb::Options db_options;
+  db_options.create_if_missing = options.create_if_missing;
+  db_options.create_missing_column_families = true;
+  db_options.max_background_jobs = options.max_background_jobs;
+  db_options.use_direct_io_for_flush_and_compaction =
+      options.direct_io_for_compaction;
+  // The first levels are soon rewritten, compressing them costs more writes
+  // than it saves space
+  constexpr const int kUncompressedLevels = 2;
+  db_options.compression_per_level.assign(
+      db_options.num_levels, ToRdbCompression(options.compression));
+  std::fill_n(db_options.compression_per_level.begin(), kUncompressedLevels,
+              rocksdb::kNoCompression);
+  db_options.bottommost_compression =
+      ToRdbCompression(options.bottommost_compression);
+  if (options.bulk_load) {
+    db_options.PrepareForBulkLoad();
+  }
+  return db_options;
+}
+
+auto MakeTableOptions(const std::shared_ptr<rocksdb::Cache>& cache)
+    -> rocksdb::BlockBasedTableOptions {
+  rocksdb::BlockBasedTableOptions table_options;
+  if (cache) {
+    table_options.block_cache = cache;
+    // Index and filter blocks count against the cache budget
+    table_options.cache_index_and_filter_blocks = true;
+    table_options.pin_l0_filter_and_index_blocks_in_cache = true;
+  } else {
+    table_options.no_block_cache = true;
+  }
+  return table_options;
+}
+
+}  // namespace
+
 Storage::Storage(std::string_view path, const DbOptions& options)
-    : rdb_storage_(std::make_unique<RdbStorage>(path, options)) {}
+    : cache_(options.record_cache_bytes),
+      write_buffer_capacity_(options.write_buffer_bytes),
+      durable_writes_(options.durable_writes && !options.bulk_load),
+      rdb_storage_(std::make_unique<RdbStorage>(path, options)) {}
+
+RecordView::RecordView(rocksdb::Slice value)
+    : fb_record_(flatbuffers::GetRoot<fb::Record>(value.data())) {}
+
+RecordView::RecordView(std::unique_ptr<rocksdb::PinnableSlice> pinned)
+    : fb_record_(flatbuffers::GetRoot<fb::Record>(pinned->data())),
+      pinned_(std::move(pinned)) {}
+
+RecordView::RecordView(std::shared_ptr<const Record> record)
+    : record_(std::move(record)) {}
+
+auto RecordView::GetId() const -> Key {
+  return record_ != nullptr ? record_->id : fb_record_->id();
+}
+
+auto RecordView::GetScalar(size_t i) const -> Scalar {
+  if (record_ != nullptr) {
+    return record_->scalars[i];
+  }
+  return FromFbScalar(fb_record_->scalars()->Get(i));
+}
+
+auto RecordView::GetVector(size_t i) const -> std::span<const Float> {
+  if (record_ != nullptr) {
+    return record_->vectors[i];
+  }
+  const auto* values = fb_record_->vectors()->Get(i)->values();
+  if (values == nullptr) {
+    return {};
+  }
+  // Stored values are only aligned within the value, which RocksDB may
+  // place at any offset
+  const auto* data = values->Data();
+  if (reinterpret_cast<uintptr_t>(data) % alignof(Float) == 0) {
+    return {reinterpret_cast<const Float*>(data), values->size()};
+  }
+  // Sized once, so spans of other vectors stay valid
+  if (unaligned_.empty()) {
+    unaligned_.resize(fb_record_->vectors()->size());
+  }
+  auto& copy = unaligned_[i];
+  copy.resize(values->size());
+  std::memcpy(copy.data(), data, copy.size() * sizeof(Float));
+  return copy;
+}
+
+auto RecordView::ApplyFilter(const Schema& schema,
+                             const ScalarFilter& filter) const -> bool {
+  return MatchFilter(GetScalar(schema.scalar_field_idx.at(filter.field)),
+                     filter);
+}
+
+auto RecordView::GetScalars() const -> std::vector<Scalar> {
+  if (record_ != nullptr) {
+    return record_->scalars;
+  }
+  std::vector<Scalar> scalars;
+  if (const auto* fb_scalars = fb_record_->scalars()) {
+    scalars.reserve(fb_scalars->size());
+    for (size_t i = 0; i < fb_scalars->size(); ++i) {
+      scalars.push_back(GetScalar(i));
+    }
+  }
+  return scalars;
+}
+
+auto RecordView::ToRecord() const -> Record {
+  if (record_ != nullptr) {
+    return *record_;
+  }
+  Record result;
+  result.id = fb_record_->id();
+  result.scalars = GetScalars();
+  if (const auto* fb_vectors = fb_record_->vectors()) {
+    result.vectors.reserve(fb_vectors->size());
+    for (size_t i = 0; i < fb_vectors->size(); ++i) {
+      const auto vector = GetVector(i);
+      result.vectors.emplace_back(vector.begin(), vector.end());
+    }
+  }
+  return result;
+}
 
 auto Storage::PutSchema(const Schema& schema) -> void {
   rdb_storage_->PutSchema(schema);
@@ -23,54 +543,171 @@ auto Storage::PutSchema(const Schema& schema) -> void {
 auto Storage::GetSchema() const -> Schema { return rdb_storage_->GetSchema(); }
 
 auto Storage::PutRecord(Key key, const Record& record) -> void {
-  records_cache_[key] = record;
-  dirty_records_.insert(key);
+  if (durable_writes_) {
+    // Nothing is buffered in this mode
+    rdb_storage_->PutRecord(key, record);
+    cache_.Erase(key);
+    return;
+  }
+  auto buffered = std::make_shared<const Record>(record);
+  const size_t bytes = GetRecordBytes(*buffered);
+  bool flush = false;
+  {
+    std::unique_lock lock(write_buffer_mutex_);
+    auto [it, inserted] = write_buffer_.try_emplace(key, buffered);
+    if (!inserted) {
+      write_buffer_bytes_ -= GetRecordBytes(*it->second);
+      it->second = std::move(buffered);
+    }
+    write_buffer_bytes_ += bytes;
+    flush = write_buffer_bytes_ >= write_buffer_capacity_;
+  }
+  cache_.Erase(key);
+  if (flush) {
+    FlushWriteBuffer();
+  }
+}
+
+auto Storage::GetBuffered(Key key) const -> std::shared_ptr<const Record> {
+  std::shared_lock lock(write_buffer_mutex_);
+  auto it = write_buffer_.find(key);
+  return it != write_buffer_.end() ? it->second : nullptr;
 }
 
 auto Storage::GetRecord(Key key) -> Record {
-  auto it = records_cache_.find(key);
-  if (it != records_cache_.end()) {
-    cache_hit_++;
-    return it->second;
+  if (auto record = GetBuffered(key)) {
+    return *record;
+  }
+  if (auto record = cache_.Get(key)) {
+    return *record;
+  }
+  auto record = std::make_shared<const Record>(rdb_storage_->GetRecord(key));
+  cache_.Put(key, record);
+  return *record;
+}
+
+auto Storage::GetRecordView(Key key) -> RecordView {
+  if (auto record = GetBuffered(key)) {
+    return RecordView(std::move(record));
+  }
+  if (auto record = cache_.Get(key)) {
+    return RecordView(std::move(record));
   }
-  cache_miss_++;
-  return rdb_storage_->GetRecord(key);
+  auto view = rdb_storage_->GetRecordView(key);
+  if (!cache_.IsEnabled()) {
+    // Pinned by RocksDB, whose block cache holds the serialized record
+    return view;
+  }
+  // Queries read records through views, so they fill the cache
+  auto record = std::make_shared<const Record>(view.ToRecord());
+  cache_.Put(key, record);
+  return RecordView(std::move(record));
+}
+
+auto Storage::FindRecordView(Key key) -> std::optional<RecordView> {
+  if (auto record = GetBuffered(key)) {
+    return RecordView(std::move(record));
+  }
+  if (auto record = cache_.Get(key)) {
+    return RecordView(std::move(record));
+  }
+  return rdb_storage_->FindRecordView(key);
+}
+
+auto Storage::GetRecordView(Key key, rocksdb::Slice value) -> RecordView {
+  if (auto record = GetBuffered(key)) {
+    return RecordView(std::move(record));
+  }
+  return RecordView(value);
+}
+
+auto Storage::PutRecords(std::span<const Record> records) -> void {
+  // Written through, so drop any buffered or cached copies
+  std::vector<Key> keys;
+  keys.reserve(records.size());
+  {
+    std::unique_lock lock(write_buffer_mutex_);
+    for (const auto& record : records) {
+      keys.push_back(record.id);
+      if (auto it = write_buffer_.find(record.id); it != write_buffer_.end()) {
+        write_buffer_bytes_ -= GetRecordBytes(*it->second);
+        write_buffer_.erase(it);
+      }
+      cache_.Erase(record.id);
+    }
+  }
+  rdb_storage_->PutRecords(keys, records);
 }
 
 auto Storage::DeleteRecord(Key key) -> void {
-  records_cache_.erase(key);
+  {
+    std::unique_lock lock(write_buffer_mutex_);
+    if (auto it = write_buffer_.find(key); it != write_buffer_.end()) {
+      write_buffer_bytes_ -= GetRecordBytes(*it->second);
+      write_buffer_.erase(it);
+    }
+  }
+  cache_.Erase(key);
   rdb_storage_->DeleteRecord(key);
 }
 
-auto Storage::PrefetchRecords(size_t n [[maybe_unused]]) -> void {
+auto Storage::PrefetchRecords(size_t n) -> void {
   auto it = rdb_storage_->GetIterator(RdbStorage::kRecordPrefix);
-
-  for (; it->Valid(); it->Next()) {
+  for (size_t i = 0; i < n && it->Valid(); ++i, it->Next()) {
     std::string_view key_view(it->key().data(), it->key().size());
     if (!key_view.starts_with(RdbStorage::kRecordPrefix)) {
       break;
     }
-    Key key = rox::RdbStorage::GetKey(it->key());
-    if (records_cache_.find(key) == records_cache_.end()) {
-      records_cache_[key] = rdb_storage_->GetRecord(key);
+    auto record =
+        std::make_shared<const Record>(RecordView(it->value()).ToRecord());
+    if (!cache_.HasRoom(GetRecordBytes(*record))) {
+      break;
     }
+    cache_.Put(RdbStorage::GetKey(it->key()), std::move(record));
   }
 }
 
-auto Storage::FlushRecords() -> void {
-  for (const auto key : dirty_records_) {
-    rdb_storage_->PutRecord(key, records_cache_[key]);
+auto Storage::FlushWriteBuffer() -> void {
+  // Records stay readable from the buffer until they are in RocksDB
+  std::vector<Key> keys;
+  std::vector<std::shared_ptr<const Record>> buffered;
+  std::vector<Record> records;
+  {
+    std::shared_lock lock(write_buffer_mutex_);
+    keys.reserve(write_buffer_.size());
+    buffered.reserve(write_buffer_.size());
+    records.reserve(write_buffer_.size());
+    for (const auto& [key, record] : write_buffer_) {
+      keys.push_back(key);
+      buffered.push_back(record);
+      records.push_back(*record);
+    }
+  }
+  rdb_storage_->PutRecords(keys, records);
+
+  // Keep records replaced in the meantime
+  std::unique_lock lock(write_buffer_mutex_);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto it = write_buffer_.find(keys[i]);
+    if (it != write_buffer_.end() && it->second == buffered[i]) {
+      write_buffer_bytes_ -= GetRecordBytes(*it->second);
+      write_buffer_.erase(it);
+    }
   }
-  records_cache_.clear();
 }
 
-auto Storage::PutIndex(const std::string& field, const IvfFlatIndex& index)
+auto Storage::FlushRecords() -> void {
+  FlushWriteBuffer();
+  rdb_storage_->IngestBulk();
+}
+
+auto Storage::PutIndex(const std::string& field, VectorIndex& index)
     -> void {
   rdb_storage_->PutIndex(field, index);
 }
 
-auto Storage::GetIndex(const std::string& field)
-    -> std::unique_ptr<IvfFlatIndex> {
+auto Storage::GetIndex(const VectorField& field)
+    -> std::unique_ptr<VectorIndex> {
   return rdb_storage_->GetIndex(field);
 }
 
@@ -83,35 +720,126 @@ auto Storage::GetIterator(std::string_view prefix)
   return rdb_storage_->GetIterator(prefix);
 }
 
-RdbStorage::RdbStorage(std::string_view path, const DbOptions& options)
-    : options_(options) {
-  rocksdb::Options db_options;
-  db_options.create_if_missing = options.create_if_missing;
+auto Storage::ScanScalarIndex(const ScalarFilter& filter)
+    -> std::vector<Key> {
+  FlushWriteBuffer();
+  return rdb_storage_->ScanScalarIndex(filter);
+}
+
+auto Storage::EstimateNumRecords() const -> size_t {
+  return rdb_storage_->EstimateNumRecords();
+}
 
+auto Storage::GetDeltas() -> std::vector<IndexDelta> {
+  return rdb_storage_->GetDeltas();
+}
+
+auto Storage::GetDeltaEnd() const noexcept -> uint64_t {
+  return rdb_storage_->GetDeltaEnd();
+}
+
+auto Storage::TruncateDeltas(uint64_t end) -> void {
+  rdb_storage_->TruncateDeltas(end);
+}
+
+RdbStorage::RdbStorage(std::string_view path, const DbOptions& options)
+    : options_(options), path_(path) {
+  const rocksdb::Options db_options = MakeRdbOptions(options);
+  const auto cache = options.block_cache_bytes > 0
+                         ? rocksdb::NewLRUCache(options.block_cache_bytes)
+                         : nullptr;
+
+  // Records are read by key, filter them and size blocks for their vectors
+  rocksdb::ColumnFamilyOptions records_options(db_options);
+  auto records_table = MakeTableOptions(cache);
+  records_table.block_size = options.block_size;
+  if (options.bloom_bits_per_key > 0) {
+    records_table.filter_policy.reset(
+        rocksdb::NewBloomFilterPolicy(options.bloom_bits_per_key));
+  }
+  records_options.table_factory.reset(
+      rocksdb::NewBlockBasedTableFactory(records_table));
+  // Index values are few and large, read once when loading an index
+  rocksdb::ColumnFamilyOptions indexes_options(db_options);
+  indexes_options.table_factory.reset(
+      rocksdb::NewBlockBasedTableFactory(MakeTableOptions(cache)));
+  rocksdb::ColumnFamilyOptions default_options(db_options);
+  default_options.table_factory = indexes_options.table_factory;
+
+  const std::vector<rocksdb::ColumnFamilyDescriptor> column_families = {
+      {rocksdb::kDefaultColumnFamilyName, default_options},
+      {kRecordsColumnFamily, records_options},
+      {kIndexesColumnFamily, indexes_options}};
+  std::vector<rocksdb::ColumnFamilyHandle*> handles;
   rocksdb::DB* db_ptr = nullptr;
-  rocksdb::Status status =
-      rocksdb::DB::Open(db_options, std::string(path), &db_ptr);
+  rocksdb::Status status = rocksdb::DB::Open(
+      db_options, std::string(path), column_families, &handles, &db_ptr);
   if (status.ok()) {
     db_.reset(db_ptr);
   } else {
     throw std::runtime_error(status.ToString());
   }
+  // The default column family is reached through DefaultColumnFamily()
+  db_->DestroyColumnFamilyHandle(handles[0]);
+  records_cf_ = handles[1];
+  indexes_cf_ = handles[2];
+  MigrateKeys();
+  std::string schema;
+  if (db_->Get(rocksdb::ReadOptions(), std::string(kSchemaPrefix), &schema)
+          .ok()) {
+    SetIndexedFields(GetSchema());
+  }
+
+  // Continue after the last logged delta
+  std::unique_ptr<rocksdb::Iterator> it(
+      db_->NewIterator(rocksdb::ReadOptions(), indexes_cf_));
+  it->SeekForPrev(MakeDeltaKey(std::numeric_limits<uint64_t>::max()));
+  if (it->Valid() && it->key().starts_with(kDeltaPrefix)) {
+    next_delta_ =
+        ReadBigEndian(it->key().data() + std::strlen(kDeltaPrefix)) + 1;
+  }
 }
 
-RdbStorage::~RdbStorage() { db_->Close(); }
+RdbStorage::~RdbStorage() {
+  db_->DestroyColumnFamilyHandle(records_cf_);
+  db_->DestroyColumnFamilyHandle(indexes_cf_);
+  db_->Close();
+}
 
 auto RdbStorage::GetIterator(std::string_view prefix)
     -> std::unique_ptr<rocksdb::Iterator> {
+  // Record scans stop at the end of the record key range
+  static const rocksdb::Slice kRecordEnd(kRecordEndKey);
+  rocksdb::ReadOptions read_options;
+  if (prefix == kRecordPrefix) {
+    read_options.iterate_upper_bound = &kRecordEnd;
+  }
   auto ptr = std::unique_ptr<rocksdb::Iterator>(
-      db_->NewIterator(rocksdb::ReadOptions()));
-  ptr->Seek(prefix);
+      db_->NewIterator(read_options, GetColumnFamily(prefix)));
+  ptr->Seek(rocksdb::Slice(prefix.data(), prefix.size()));
   return ptr;
 }
 
+auto RdbStorage::GetColumnFamily(std::string_view key) const
+    -> rocksdb::ColumnFamilyHandle* {
+  if (key.starts_with(kRecordPrefix)) {
+    return records_cf_;
+  }
+  if (key.starts_with(kSchemaPrefix)) {
+    return db_->DefaultColumnFamily();
+  }
+  return indexes_cf_;
+}
+
 auto RdbStorage::MakeRecordKey(Key key) -> std::string {
-  std::stringstream ss;
-  ss << kRecordPrefix << key;
-  return ss.str();
+  // Fits the small string buffer, so no allocation
+  std::string rdb_key(kRecordKeySize, '\0');
+  rdb_key[0] = kRecordPrefix[0];
+  for (size_t i = kRecordKeySize - 1; i > 0; --i) {
+    rdb_key[i] = static_cast<char>(key & 0xFF);
+    key >>= 8;
+  }
+  return rdb_key;
 }
 
 auto RdbStorage::MakeIndexKey(const std::string& field) -> std::string {
@@ -122,12 +850,77 @@ auto RdbStorage::MakeCentroidKey(const std::string& field) -> std::string {
   return std::string(kCentroidPrefix) + field;
 }
 
+auto RdbStorage::MakeHnswKey(const std::string& field) -> std::string {
+  return std::string(kHnswPrefix) + field;
+}
+
+auto RdbStorage::MakeIvfPqKey(const std::string& field) -> std::string {
+  return std::string(kIvfPqPrefix) + field;
+}
+
+auto RdbStorage::MakeIvfSqKey(const std::string& field) -> std::string {
+  return std::string(kIvfSqPrefix) + field;
+}
+
+auto RdbStorage::MakeZoneMapKey(const std::string& field) -> std::string {
+  return std::string(kZoneMapPrefix) + field;
+}
+
+auto RdbStorage::MakeDeltaKey(uint64_t sequence) -> std::string {
+  std::string rdb_key(kDeltaPrefix);
+  AppendBigEndian(rdb_key, sequence);
+  return rdb_key;
+}
+
+auto RdbStorage::MakeScalarIndexKey(const std::string& field,
+                                    const Scalar& value, Key key)
+    -> std::string {
+  std::string rdb_key(kScalarIndexPrefix);
+  rdb_key += field;
+  rdb_key += ':';
+  AppendScalar(rdb_key, value);
+  rdb_key += ':';
+  AppendBigEndian(rdb_key, key);
+  return rdb_key;
+}
+
 auto RdbStorage::GetKey(rocksdb::Slice rdb_key) -> Key {
-  std::string_view key(rdb_key.data(), rdb_key.size());
-  if (key.size() <= 2) {
+  if (rdb_key.size() != kRecordKeySize) {
     throw std::invalid_argument("Invalid key");
   }
-  return std::stoull(std::string(key.substr(2)));
+  return ReadBigEndian(rdb_key.data() + 1);
+}
+
+auto RdbStorage::MigrateKeys() -> void {
+  constexpr const size_t kBatchSize = 4096;
+  std::unique_ptr<rocksdb::Iterator> it(
+      db_->NewIterator(rocksdb::ReadOptions(), db_->DefaultColumnFamily()));
+  it->SeekToFirst();
+  while (it->Valid()) {
+    rocksdb::WriteBatch batch;
+    for (size_t n = 0; n < kBatchSize && it->Valid(); it->Next()) {
+      const std::string_view key(it->key().data(), it->key().size());
+      if (key.starts_with(kLegacyRecordPrefix)) {
+        batch.Put(records_cf_,
+                  MakeRecordKey(std::stoull(std::string(key.substr(2)))),
+                  it->value());
+      } else if (auto* cf = GetColumnFamily(key);
+                 cf != db_->DefaultColumnFamily()) {
+        batch.Put(cf, it->key(), it->value());
+      } else {
+        continue;
+      }
+      batch.Delete(it->key());
+      ++n;
+    }
+    if (batch.Count() == 0) {
+      continue;
+    }
+    auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+    if (!status.ok()) {
+      throw std::runtime_error("Failed to migrate keys: " + status.ToString());
+    }
+  }
 }
 
 auto RdbStorage::PutSchema(const Schema& schema) -> void {
@@ -138,7 +931,12 @@ auto RdbStorage::PutSchema(const Schema& schema) -> void {
   for (const auto& field : schema.vector_fields) {
     auto fb_field =
         fb::CreateVectorField(builder, builder.CreateString(field.name),
-                              field.dim, field.num_centroids);
+                              field.dim, field.num_centroids,
+                              ToFbMetric(field.metric),
+                              ToFbIndexType(field.index_type), field.hnsw_m,
+                              field.hnsw_ef_construction, field.hnsw_ef_search,
+                              field.pq_m, field.rerank,
+                              ToFbQuantization(field.quantization));
     vector_fields.push_back(fb_field);
   }
 
@@ -161,7 +959,7 @@ auto RdbStorage::PutSchema(const Schema& schema) -> void {
     }
 
     auto fb_field = fb::CreateScalarField(
-        builder, builder.CreateString(field.name), fb_type);
+        builder, builder.CreateString(field.name), fb_type, field.indexed);
     scalar_fields.push_back(fb_field);
   }
 
@@ -182,6 +980,16 @@ auto RdbStorage::PutSchema(const Schema& schema) -> void {
   if (!status.ok()) {
     throw std::runtime_error("Failed to put schema: " + status.ToString());
   }
+  SetIndexedFields(schema);
+}
+
+auto RdbStorage::SetIndexedFields(const Schema& schema) -> void {
+  indexed_fields_.clear();
+  for (size_t i = 0; i < schema.scalar_fields.size(); ++i) {
+    if (schema.scalar_fields[i].indexed) {
+      indexed_fields_.emplace_back(schema.scalar_fields[i].name, i);
+    }
+  }
 }
 
 auto RdbStorage::GetSchema() const -> Schema {
@@ -200,6 +1008,18 @@ auto RdbStorage::GetSchema() const -> Schema {
     field.name = fb_vector->name()->str();
     field.dim = fb_vector->dim();
     field.num_centroids = fb_vector->num_centroids();
+    field.metric = FromFbMetric(fb_vector->metric());
+    field.index_type = FromFbIndexType(fb_vector->index_type());
+    if (field.index_type == VectorField::IndexType::kHnsw) {
+      field.hnsw_m = fb_vector->hnsw_m();
+      field.hnsw_ef_construction = fb_vector->hnsw_ef_construction();
+      field.hnsw_ef_search = fb_vector->hnsw_ef_search();
+    }
+    if (field.index_type == VectorField::IndexType::kIvfPq) {
+      field.pq_m = fb_vector->pq_m();
+    }
+    field.quantization = FromFbQuantization(fb_vector->quantization());
+    field.rerank = fb_vector->rerank();
     schema.vector_fields.push_back(field);
   }
 
@@ -219,227 +1039,650 @@ auto RdbStorage::GetSchema() const -> Schema {
         throw std::runtime_error("Unknown scalar field type in schema");
     }
 
-    schema.AddScalarField(fb_field->name()->str(), type);
+    schema.AddScalarField(fb_field->name()->str(), type, fb_field->indexed());
   }
 
   return schema;
 }
 
 auto RdbStorage::PutRecord(Key key, const Record& record) -> void {
+  DropZoneMaps();
   flatbuffers::FlatBufferBuilder builder;
-
-  std::vector<flatbuffers::Offset<fb::Scalar>> fb_scalars;
-  for (const auto& scalar : record.scalars) {
-    flatbuffers::Offset<void> fb_value;
-    fb::ScalarValue value_type;
-
-    if (std::holds_alternative<double>(scalar)) {
-      value_type = fb::ScalarValue_DoubleValue;
-      fb_value =
-          fb::CreateDoubleValue(builder, std::get<double>(scalar)).Union();
-    } else if (std::holds_alternative<int>(scalar)) {
-      value_type = fb::ScalarValue_IntValue;
-      fb_value = fb::CreateIntValue(builder, std::get<int>(scalar)).Union();
-    } else if (std::holds_alternative<std::string>(scalar)) {
-      value_type = fb::ScalarValue_StringValue;
-      fb_value =
-          fb::CreateStringValue(
-              builder, builder.CreateString(std::get<std::string>(scalar)))
-              .Union();
-    } else {
-      throw std::runtime_error("Unknown scalar type");
-    }
-    auto fb_scalar = fb::CreateScalar(builder, value_type, fb_value);
-    fb_scalars.push_back(fb_scalar);
+  BuildRecord(builder, record);
+  const rocksdb::Slice value(
+      reinterpret_cast<const char*>(builder.GetBufferPointer()),
+      builder.GetSize());
+  if (options_.bulk_load || (!IsLogged() && indexed_fields_.empty())) {
+    PutValue(MakeRecordKey(key), value);
+    IndexScalars(nullptr, key, std::nullopt, &record);
+    return;
   }
 
-  std::vector<flatbuffers::Offset<fb::Vector>> fb_vectors;
-  for (const auto& vector : record.vectors) {
-    auto fb_vector = fb::CreateVector(
-        builder, builder.CreateVector(vector.data(), vector.size()));
-    fb_vectors.push_back(fb_vector);
+  rocksdb::WriteBatch batch;
+  batch.Put(records_cf_, MakeRecordKey(key), value);
+  const auto old = FindRecordView(key);
+  if (!indexed_fields_.empty()) {
+    IndexScalars(&batch, key, old, &record);
   }
+  if (IsLogged()) {
+    LogDelta(batch, {IndexDelta::Op::kPut, key, GetVectors(old)});
+  }
+  auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to put record: " + status.ToString());
+  }
+}
 
-  auto fb_record =
-      fb::CreateRecord(builder, record.id, builder.CreateVector(fb_scalars),
-                       builder.CreateVector(fb_vectors));
-
-  builder.Finish(fb_record);
+auto RdbStorage::PutRecords(std::span<const Key> keys,
+                            std::span<const Record> records) -> void {
+  assert(keys.size() == records.size());
+  DropZoneMaps();
+  // Bounds the memory held by serialized records and the write batch
+  constexpr const size_t kChunkSize = 4096;
+  std::vector<flatbuffers::FlatBufferBuilder> builders(
+      std::min(kChunkSize, records.size()));
+  for (size_t begin = 0; begin < records.size(); begin += kChunkSize) {
+    const auto chunk =
+        records.subspan(begin, std::min(kChunkSize, records.size() - begin));
+    std::vector<size_t> slots(chunk.size());
+    std::iota(slots.begin(), slots.end(), 0);
+    std::for_each(std::execution::par, slots.begin(), slots.end(),
+                  [&](size_t i) {
+                    builders[i].Clear();
+                    BuildRecord(builders[i], chunk[i]);
+                  });
+    // Scalar index entries follow the last record of each key in the chunk,
+    // replacing those of the stored record
+    std::vector<bool> indexed(chunk.size());
+    std::vector<std::optional<RecordView>> olds(chunk.size());
+    if (!indexed_fields_.empty()) {
+      std::unordered_map<Key, size_t> last;
+      for (size_t i = 0; i < chunk.size(); ++i) {
+        last[keys[begin + i]] = i;
+      }
+      for (const auto& [key, i] : last) {
+        indexed[i] = true;
+      }
+    }
+    // Logged deltas carry the old vectors of every record
+    if (!options_.bulk_load && (IsLogged() || !indexed_fields_.empty())) {
+      std::for_each(std::execution::par, slots.begin(), slots.end(),
+                    [&](size_t i) {
+                      if (indexed[i] || IsLogged()) {
+                        olds[i] = FindRecordView(keys[begin + i]);
+                      }
+                    });
+    }
 
-  rocksdb::WriteOptions write_options;
-  auto status = db_->Put(
-      write_options, MakeRecordKey(key),
-      rocksdb::Slice(reinterpret_cast<const char*>(builder.GetBufferPointer()),
-                     builder.GetSize()));
+    if (options_.bulk_load) {
+      for (size_t i = 0; i < chunk.size(); ++i) {
+        PutValue(MakeRecordKey(keys[begin + i]),
+                 rocksdb::Slice(reinterpret_cast<const char*>(
+                                    builders[i].GetBufferPointer()),
+                                builders[i].GetSize()));
+        if (indexed[i]) {
+          IndexScalars(nullptr, keys[begin + i], std::nullopt, &chunk[i]);
+        }
+      }
+      continue;
+    }
+    rocksdb::WriteBatch batch;
+    for (size_t i = 0; i < chunk.size(); ++i) {
+      batch.Put(records_cf_, MakeRecordKey(keys[begin + i]),
+                rocksdb::Slice(reinterpret_cast<const char*>(
+                                   builders[i].GetBufferPointer()),
+                               builders[i].GetSize()));
+      if (indexed[i]) {
+        IndexScalars(&batch, keys[begin + i], olds[i], &chunk[i]);
+      }
+      if (IsLogged()) {
+        LogDelta(batch,
+                 {IndexDelta::Op::kPut, keys[begin + i], GetVectors(olds[i])});
+      }
+    }
+    auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+    if (!status.ok()) {
+      throw std::runtime_error("Failed to write records: " +
+                               status.ToString());
+    }
+  }
 }
 
 auto RdbStorage::GetRecord(Key key) const -> Record {
-  std::string value;
-  rocksdb::ReadOptions read_options;
+  return GetRecordView(key).ToRecord();
+}
 
-  auto status = db_->Get(read_options, MakeRecordKey(key), &value);
-  if (!status.ok()) {
+auto RdbStorage::GetRecordView(Key key) const -> RecordView {
+  auto view = FindRecordView(key);
+  if (!view) {
     throw std::invalid_argument("Record not found");
   }
+  return std::move(*view);
+}
 
-  Record result;
-  const auto* const fb_record = flatbuffers::GetRoot<fb::Record>(value.data());
-  result.id = fb_record->id();
-
-  // Convert FlatBuffer scalars to C++ scalars
-  const auto* fb_scalars = fb_record->scalars();
-  if (fb_scalars) {
-    for (const auto& fb_scalar : *fb_scalars) {
-      switch (fb_scalar->value_type()) {
-        case fb::ScalarValue_DoubleValue: {
-          const auto* double_value = fb_scalar->value_as_DoubleValue();
-          result.scalars.emplace_back(double_value->value());
-          break;
-        }
-        case fb::ScalarValue_IntValue: {
-          const auto* int_value = fb_scalar->value_as_IntValue();
-          result.scalars.emplace_back(int_value->value());
-          break;
-        }
-        case fb::ScalarValue_StringValue: {
-          const auto* string_value = fb_scalar->value_as_StringValue();
-          result.scalars.emplace_back(string_value->value()->str());
-          break;
-        }
-        default:
-          throw std::runtime_error("Unknown scalar type");
-      }
-
-    }  // for (const auto& fb_scalar : *fb_scalars)
-
-    // Convert FlatBuffer vectors to C++ vectors
-    const auto* fb_vectors = fb_record->vectors();
-    if (fb_vectors) {
-      for (const auto& fb_vector : *fb_vectors) {
-        const auto* values = fb_vector->values();
-        Vector vector;
-        if (values) {
-          vector.reserve(values->size());
-          for (auto val : *values) {
-            vector.push_back(val);
-          }
-        }
-        result.vectors.push_back(std::move(vector));
-      }
-    }  // if (fb_vectors)
-  }  // if (fb_scalars)
-  return result;
+auto RdbStorage::FindRecordView(Key key) const -> std::optional<RecordView> {
+  auto value = std::make_unique<rocksdb::PinnableSlice>();
+  // Buffered bulk puts are not in RocksDB yet
+  if (auto it = bulk_positions_.find(MakeRecordKey(key));
+      it != bulk_positions_.end()) {
+    value->PinSelf(bulk_entries_[it->second].second);
+    return RecordView(std::move(value));
+  }
+  auto status = db_->Get(rocksdb::ReadOptions(), records_cf_,
+                         MakeRecordKey(key), value.get());
+  if (status.IsNotFound()) {
+    return std::nullopt;
+  }
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to get record: " + status.ToString());
+  }
+  return RecordView(std::move(value));
 }
 
 auto RdbStorage::DeleteRecord(Key key) -> void {
-  std::string record_key = MakeRecordKey(key);
-  auto status = db_->Delete(rocksdb::WriteOptions(), record_key);
+  DropZoneMaps();
+  // A buffered bulk put would be ingested after the delete, with a newer
+  // sequence number, and bring the record back
+  if (bulk_positions_.contains(MakeRecordKey(key))) {
+    IngestBulk();
+  }
+  rocksdb::WriteBatch batch;
+  batch.Delete(records_cf_, MakeRecordKey(key));
+  const auto old = FindRecordView(key);
+  if (!indexed_fields_.empty()) {
+    IndexScalars(&batch, key, old, nullptr);
+  }
+  if (IsLogged()) {
+    LogDelta(batch, {IndexDelta::Op::kDelete, key, GetVectors(old)});
+  }
+  auto status = db_->Write(rocksdb::WriteOptions(), &batch);
   if (!status.ok()) {
     throw std::runtime_error("Failed to delete record: " + status.ToString());
   }
 }
 
-auto RdbStorage::PutIndex(const std::string& field, const IvfFlatIndex& index)
+auto RdbStorage::LogDelta(rocksdb::WriteBatch& batch, IndexDelta delta)
     -> void {
-  constexpr const static size_t kBaseDim = 128;
-  constexpr const static size_t kCentroidPerPartition = 1000;
-  size_t num_centroids = index.GetCentroids().size();
-  assert(num_centroids == index.GetInvertedLists().size());
-  size_t dim = index.dim_;
-  size_t normalized_num_centroids =
-      num_centroids * (dim / kBaseDim);  // punish long vectors
-  size_t n_partitions = normalized_num_centroids / kCentroidPerPartition;
-  if (normalized_num_centroids % kCentroidPerPartition != 0) {
-    n_partitions++;
+  std::string value(1, static_cast<char>(delta.op));
+  AppendBigEndian(value, delta.key);
+  for (const auto& vector : delta.old_vectors) {
+    const auto size = static_cast<uint32_t>(vector.size());
+    value.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    value.append(reinterpret_cast<const char*>(vector.data()),
+                 vector.size() * sizeof(Float));
   }
+  batch.Put(indexes_cf_, MakeDeltaKey(next_delta_++), value);
+}
 
-  size_t partition_size = num_centroids / n_partitions;
-  size_t partition_remainder = num_centroids % n_partitions;
+auto RdbStorage::IndexScalars(rocksdb::WriteBatch* batch, Key key,
+                              const std::optional<RecordView>& old,
+                              const Record* record) -> void {
+  assert(batch != nullptr || !old);
+  const auto old_scalars = old ? old->GetScalars() : std::vector<Scalar>();
+  for (const auto& [field, i] : indexed_fields_) {
+    const Scalar* from = i < old_scalars.size() ? &old_scalars[i] : nullptr;
+    const Scalar* to = record != nullptr && i < record->scalars.size()
+                           ? &record->scalars[i]
+                           : nullptr;
+    if (from != nullptr && to != nullptr && *from == *to) {
+      continue;
+    }
+    if (from != nullptr) {
+      batch->Delete(indexes_cf_, MakeScalarIndexKey(field, *from, key));
+    }
+    if (to == nullptr) {
+      continue;
+    }
+    auto index_key = MakeScalarIndexKey(field, *to, key);
+    if (batch != nullptr) {
+      batch->Put(indexes_cf_, index_key, rocksdb::Slice());
+    } else {
+      PutValue(std::move(index_key), rocksdb::Slice());
+    }
+  }
+}
 
-  for (size_t i = 0; i < n_partitions; i++) {
-    size_t offset = i * partition_size;
-    size_t size = partition_size;
-    if (i == n_partitions - 1) {
-      size += partition_remainder;
+auto RdbStorage::ScanScalarIndex(const ScalarFilter& filter) const
+    -> std::vector<Key> {
+  if (filter.op == ScalarFilter::Op::kNe) {
+    throw std::invalid_argument("Scalar indexes do not serve kNe filters");
+  }
+  // Entries of a value v are "<prefix><v>:<key>", so they sort before
+  // "<prefix><v>;" and after "<prefix><v>". Bounds may include neighbors,
+  // decoded values are matched exactly.
+  const std::string prefix = kScalarIndexPrefix + filter.field + ':';
+  std::string value_begin = prefix;
+  AppendScalar(value_begin, filter.value);
+  const std::string value_end = value_begin + ';';
+  std::string begin = prefix;
+  std::string end = prefix;
+  end.back() = ';';
+  switch (filter.op) {
+    case ScalarFilter::Op::kEq:
+      begin = value_begin;
+      end = value_end;
+      break;
+    case ScalarFilter::Op::kGt:
+    case ScalarFilter::Op::kGe:
+      begin = value_begin;
+      break;
+    case ScalarFilter::Op::kLt:
+    case ScalarFilter::Op::kLe:
+      end = value_end;
+      break;
+    case ScalarFilter::Op::kNe:
+      break;
+  }
+
+  const rocksdb::Slice upper_bound(end);
+  rocksdb::ReadOptions read_options;
+  read_options.iterate_upper_bound = &upper_bound;
+  std::unique_ptr<rocksdb::Iterator> it(
+      db_->NewIterator(read_options, indexes_cf_));
+  std::vector<Key> keys;
+  for (it->Seek(begin); it->Valid(); it->Next()) {
+    const auto rdb_key = it->key();
+    const std::string_view value(rdb_key.data() + prefix.size(),
+                                 rdb_key.size() - prefix.size() - 1 -
+                                     sizeof(Key));
+    if (MatchFilter(ReadScalar(value), filter)) {
+      keys.push_back(ReadBigEndian(rdb_key.data() + rdb_key.size() -
+                                   sizeof(Key)));
     }
-    PutIndexPartition(field, index, i, offset, size);
   }
+  if (!it->status().ok()) {
+    throw std::runtime_error("Failed to scan scalar index: " +
+                             it->status().ToString());
+  }
+  return keys;
+}
+
+auto RdbStorage::EstimateNumRecords() const -> size_t {
+  uint64_t n = 0;
+  db_->GetIntProperty(records_cf_, rocksdb::DB::Properties::kEstimateNumKeys,
+                      &n);
+  return n;
 }
 
-auto RdbStorage::PutIndexPartition(const std::string& field,
-                                   const IvfFlatIndex& index, size_t idx,
-                                   size_t offset, size_t size) -> void {
-  std::string index_key = MakeIndexKey(field);
-  index_key += ":" + std::to_string(idx);
+auto RdbStorage::GetDeltas() -> std::vector<IndexDelta> {
+  const std::string prefix(kDeltaPrefix);
+  std::unique_ptr<rocksdb::Iterator> it(
+      db_->NewIterator(rocksdb::ReadOptions(), indexes_cf_));
+  std::vector<IndexDelta> deltas;
+  for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
+       it->Next()) {
+    const auto value = it->value();
+    if (value.size() < 1 + sizeof(Key)) {
+      throw std::runtime_error("Invalid index delta");
+    }
+    deltas.push_back({static_cast<IndexDelta::Op>(value.data()[0]),
+                      ReadBigEndian(value.data() + 1), {}});
+    auto& delta = deltas.back();
+    for (size_t pos = 1 + sizeof(Key); pos < value.size();) {
+      uint32_t size = 0;
+      if (value.size() - pos < sizeof(size)) {
+        throw std::runtime_error("Invalid index delta");
+      }
+      std::memcpy(&size, value.data() + pos, sizeof(size));
+      pos += sizeof(size);
+      if ((value.size() - pos) / sizeof(Float) < size) {
+        throw std::runtime_error("Invalid index delta");
+      }
+      auto& vector = delta.old_vectors.emplace_back(size);
+      std::memcpy(vector.data(), value.data() + pos, size * sizeof(Float));
+      pos += size * sizeof(Float);
+    }
+  }
+  return deltas;
+}
+
+auto RdbStorage::TruncateDeltas(uint64_t end) -> void {
+  auto status =
+      db_->DeleteRange(rocksdb::WriteOptions(), indexes_cf_,
+                       MakeDeltaKey(0), MakeDeltaKey(end));
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to truncate index deltas: " +
+                             status.ToString());
+  }
+}
+
+auto RdbStorage::PutIndex(const std::string& field, VectorIndex& index)
+    -> void {
+  switch (index.GetType()) {
+    case IndexType::kIvfFlat:
+      if (const auto* sq_index = dynamic_cast<const IvfSqIndex*>(&index)) {
+        PutIvfSqIndex(field, *sq_index);
+      } else {
+        PutIvfFlatIndex(field, static_cast<IvfFlatIndex&>(index));
+      }
+      return;
+    case IndexType::kHnsw:
+      PutHnswIndex(field, static_cast<const HnswIndex&>(index));
+      return;
+    case IndexType::kIvfPq:
+      PutIvfPqIndex(field, static_cast<const IvfPqIndex&>(index));
+      return;
+  }
+  throw std::invalid_argument("Unknown vector index type");
+}
+
+auto RdbStorage::GetIndex(const VectorField& field)
+    -> std::unique_ptr<VectorIndex> {
+  switch (field.index_type) {
+    case IndexType::kIvfFlat:
+      if (field.quantization != VectorField::Quantization::kNone) {
+        return GetIvfSqIndex(field.name);
+      }
+      return GetIvfFlatIndex(field.name);
+    case IndexType::kHnsw:
+      return GetHnswIndex(field.name);
+    case IndexType::kIvfPq:
+      return GetIvfPqIndex(field.name);
+  }
+  throw std::invalid_argument("Unknown vector index type");
+}
+
+auto RdbStorage::PutIvfFlatIndex(const std::string& field,
+                                 IvfFlatIndex& index) -> void {
+  // Tombstones are not stored
+  index.CompactLists();
+  if (!options_.index_segments && !index.GetSavedPartitions().empty() &&
+      PutIvfFlatPartitions(field, index)) {
+    return;
+  }
+
+  const std::string key_base = MakeIndexKey(field) + ":";
+  const auto& inverted_lists = index.GetInvertedLists();
+  const size_t nlist = index.nlist_;
+  assert(nlist == inverted_lists.size());
+
+  // Replace all partitions and the centroids at once
+  IngestBulk();
+  rocksdb::WriteBatch batch;
+  DeletePartitions(key_base, batch);
+  if (options_.index_segments) {
+    // The segment replaces the values, which are left deleted
+    IvfSegment::Write(GetSegmentPath(field), index);
+    batch.Delete(indexes_cf_, MakeCentroidKey(field));
+    batch.Delete(indexes_cf_, MakeZoneMapKey(field));
+    auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+    if (!status.ok()) {
+      throw std::runtime_error("Failed to put index: " + status.ToString());
+    }
+    index.MarkSaved({});
+    return;
+  }
+
+  std::vector<uint32_t> partition_offsets;
+  for (size_t offset = 0, idx = 0; offset < nlist || idx == 0; ++idx) {
+    const size_t end = GetPartitionEnd(inverted_lists, offset);
+    partition_offsets.push_back(offset);
+    PutIvfFlatPartition(key_base + std::to_string(idx), index, offset, end,
+                        batch);
+    offset = end;
+  }
+  partition_offsets.push_back(nlist);
+  PutZoneMaps(field, index, batch);
+
   flatbuffers::FlatBufferBuilder builder;
+  auto field_name_offset = builder.CreateString(index.GetName());
+  auto centroids =
+      builder.CreateVector(index.centroids_.data(), index.centroids_.size());
+  auto offsets = builder.CreateVector(partition_offsets);
+  builder.Finish(fb::CreateIvfCentroids(builder, field_name_offset,
+                                        index.dim_, nlist,
+                                        ToFbMetric(index.metric_), centroids,
+                                        offsets));
+  const rocksdb::Slice value(
+      reinterpret_cast<const char*>(builder.GetBufferPointer()),
+      builder.GetSize());
+  if (options_.bulk_load) {
+    PutValue(MakeCentroidKey(field), value);
+  } else {
+    batch.Put(indexes_cf_, MakeCentroidKey(field), value);
+  }
+
+  auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to put index: " + status.ToString());
+  }
+  // A segment is only dropped once the values replacing it are written
+  if (std::filesystem::exists(GetSegmentPath(field))) {
+    IngestBulk();
+    std::filesystem::remove(GetSegmentPath(field));
+  }
+  index.MarkSaved({partition_offsets.begin(), partition_offsets.end()});
+}
 
-  // Create field name
+auto RdbStorage::PutIvfFlatPartitions(const std::string& field,
+                                      IvfFlatIndex& index) -> bool {
+  // Partitions keep their lists, one grown far past the budget is better
+  // split by a full rewrite
+  constexpr const static size_t kMaxPartitionBytes = 4 * kPartitionBytes;
+  const auto saved = index.GetSavedPartitions();
+  std::vector<size_t> partitions;
+  for (const auto c : index.GetDirtyLists()) {
+    const size_t p = std::ranges::upper_bound(saved, c) - saved.begin() - 1;
+    if (partitions.empty() || partitions.back() != p) {
+      partitions.push_back(p);
+    }
+  }
+  for (const auto p : partitions) {
+    size_t bytes = 0;
+    for (size_t c = saved[p]; c < saved[p + 1]; ++c) {
+      bytes += GetListBytes(index.GetList(c));
+    }
+    if (bytes > kMaxPartitionBytes) {
+      return false;
+    }
+  }
+
+  const std::string key_base = MakeIndexKey(field) + ":";
+  rocksdb::WriteBatch batch;
+  for (const auto p : partitions) {
+    PutIvfFlatPartition(key_base + std::to_string(p), index, saved[p],
+                        saved[p + 1], batch);
+  }
+  PutZoneMaps(field, index, batch);
+  auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to put index: " + status.ToString());
+  }
+  index.MarkSaved({saved.begin(), saved.end()});
+  return true;
+}
+
+auto RdbStorage::PutIvfFlatPartition(const std::string& key,
+                                     const IvfFlatIndex& index, size_t offset,
+                                     size_t end, rocksdb::WriteBatch& batch)
+    -> void {
+  for (size_t c = offset; c < end; ++c) {
+    index.LoadList(c);
+  }
+  flatbuffers::FlatBufferBuilder builder;
+  auto lists = CreateIvfLists(builder, index.inverted_lists_, offset, end);
   auto field_name_offset = builder.CreateString(index.GetName());
+  auto fb_index = fb::CreateIvfFlatIndex(builder, field_name_offset,
+                                         index.dim_, index.nlist_, 0, lists,
+                                         ToFbMetric(index.metric_), offset);
+  builder.Finish(fb_index);
 
-  // Create centroids
-  std::vector<flatbuffers::Offset<rox::fb::Vector>> centroids;
-  centroids.reserve(size);
-  // for (const auto& centroid : index.GetCentroids()) {
-  for (size_t i = offset; i < offset + size; i++) {
-    const auto& centroid = index.GetCentroids()[i];
-    auto values = builder.CreateVector(centroid);
-    auto vector_fb = rox::fb::CreateVector(builder, values);
-    centroids.push_back(vector_fb);
+  const rocksdb::Slice value(
+      reinterpret_cast<const char*>(builder.GetBufferPointer()),
+      builder.GetSize());
+  if (options_.bulk_load) {
+    PutValue(key, value);
+  } else {
+    batch.Put(indexes_cf_, key, value);
   }
+}
 
-  // Create inverted lists
-  std::vector<flatbuffers::Offset<rox::fb::IvfList>> inverted_lists;
-  inverted_lists.reserve(size);
-  // for (const auto& list : index.GetInvertedLists()) {
-  for (size_t i = offset; i < offset + size; i++) {
-    const auto& list = index.GetInvertedLists()[i];
-    std::vector<flatbuffers::Offset<rox::fb::IvfListEntry>> entries;
+auto RdbStorage::GetIvfFlatIndex(const std::string& field)
+    -> std::unique_ptr<IvfFlatIndex> {
+  // Whichever way the index is read, the next record write drops them
+  zone_map_keys_.insert(MakeZoneMapKey(field));
+  // A crash while switching between segments and values may leave both.
+  // Either is written before the other is dropped, so the one of the
+  // configured format is the newer.
+  auto open_segment = [&]() -> std::unique_ptr<IvfFlatIndex> {
+    auto segment = IvfSegment::Open(GetSegmentPath(field));
+    if (!segment) {
+      return nullptr;
+    }
+    auto index = std::make_unique<IvfFlatIndex>(
+        field, segment->GetDim(), segment->GetNumLists(),
+        segment->GetMetric());
+    index->SetSegment(std::move(segment));
+    return index;
+  };
+  if (options_.index_segments) {
+    if (auto index = open_segment()) {
+      return index;
+    }
+  }
 
-    for (const auto& [key, vec] : list) {
-      auto values = builder.CreateVector(vec);
-      auto vector_fb = rox::fb::CreateVector(builder, values);
-      auto entry_fb = rox::fb::CreateIvfListEntry(builder, key, vector_fb);
-      entries.push_back(entry_fb);
+  std::string value;
+  auto status = db_->Get(rocksdb::ReadOptions(), indexes_cf_,
+                         MakeCentroidKey(field), &value);
+  if (status.IsNotFound()) {
+    if (auto index = open_segment()) {
+      return index;
     }
+    return GetLegacyIvfFlatIndex(field);
+  }
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to get index: " + status.ToString());
+  }
+  if (!options_.index_segments) {
+    std::filesystem::remove(GetSegmentPath(field));  // stale
+  }
 
-    auto entries_vector = builder.CreateVector(entries);
-    auto list_fb = rox::fb::CreateIvfList(builder, entries_vector);
-    inverted_lists.push_back(list_fb);
+  const auto* meta = flatbuffers::GetRoot<fb::IvfCentroids>(value.data());
+  const size_t dim = meta->dim();
+  const size_t nlist = meta->nlist();
+  if (!meta->centroids() || meta->centroids()->size() != nlist * dim ||
+      !meta->partition_offsets()) {
+    throw std::runtime_error("Inconsistent index metadata");
   }
+  auto index = std::make_unique<IvfFlatIndex>(
+      meta->field_name()->str(), dim, nlist, FromFbMetric(meta->metric()));
+  std::copy_n(meta->centroids()->data(), nlist * dim,
+              index->centroids_.begin());
+
+  // Lists are read from their partition on first access
+  const std::string key_base = MakeIndexKey(field) + ":";
+  const auto* fb_offsets = meta->partition_offsets();
+  std::vector<size_t> offsets(fb_offsets->data(),
+                              fb_offsets->data() + fb_offsets->size());
+  index->SetLazyLists(
+      std::move(offsets), [this, key_base, dim](size_t partition) {
+        std::string value;
+        auto status =
+            db_->Get(rocksdb::ReadOptions(), indexes_cf_,
+                     key_base + std::to_string(partition), &value);
+        if (!status.ok()) {
+          throw std::runtime_error("Failed to get index partition: " +
+                                   status.ToString());
+        }
+        const auto* fb_index =
+            flatbuffers::GetRoot<fb::IvfFlatIndex>(value.data());
+        std::vector<IvfList> lists;
+        if (fb_index->inverted_lists()) {
+          lists.reserve(fb_index->inverted_lists()->size());
+          for (const auto* fb_list : *fb_index->inverted_lists()) {
+            auto& list = lists.emplace_back(dim);
+            if (fb_list->entries()) {
+              list.Reserve(fb_list->entries()->size());
+              ReadIvfList(fb_list, list);
+            }
+          }
+        }
+        return lists;
+      });
 
-  // Create vectors
-  auto centroids_vector = builder.CreateVector(centroids);
-  auto lists_vector = builder.CreateVector(inverted_lists);
+  // Lists without a saved zone map get theirs when loaded
+  status = db_->Get(rocksdb::ReadOptions(), indexes_cf_, MakeZoneMapKey(field),
+                    &value);
+  if (status.ok()) {
+    const auto* fb_zone_maps =
+        flatbuffers::GetRoot<fb::IvfZoneMaps>(value.data());
+    if (fb_zone_maps->zone_maps()) {
+      for (const auto* fb_zone_map : *fb_zone_maps->zone_maps()) {
+        if (fb_zone_map->list() >= nlist) {
+          throw std::runtime_error("Inconsistent index metadata");
+        }
+        index->SetSavedZoneMap(fb_zone_map->list(), ReadZoneMap(fb_zone_map));
+      }
+    }
+  } else if (!status.IsNotFound()) {
+    throw std::runtime_error("Failed to get zone maps: " + status.ToString());
+  }
+  return index;
+}
 
-  // Create index
-  auto fb_index =
-      rox::fb::CreateIvfFlatIndex(builder, field_name_offset, index.dim_,
-                                  index.nlist_, centroids_vector, lists_vector);
+auto RdbStorage::PutZoneMaps(const std::string& field,
+                             const IvfFlatIndex& index,
+                             rocksdb::WriteBatch& batch) -> void {
+  const std::string key = MakeZoneMapKey(field);
+  flatbuffers::FlatBufferBuilder builder;
+  std::vector<flatbuffers::Offset<fb::ListZoneMap>> zone_maps;
+  // Bulk-loaded values would be ingested after the next DropZoneMaps
+  if (!options_.bulk_load) {
+    for (CentroidId c = 0; c < index.nlist_; ++c) {
+      if (const auto* zone_map = index.FindZoneMap(c)) {
+        zone_maps.push_back(CreateZoneMap(builder, c, *zone_map));
+      }
+    }
+  }
+  if (zone_maps.empty()) {
+    batch.Delete(indexes_cf_, key);
+    return;
+  }
+  auto field_name_offset = builder.CreateString(index.GetName());
+  builder.Finish(fb::CreateIvfZoneMaps(builder, field_name_offset,
+                                       builder.CreateVector(zone_maps)));
+  batch.Put(indexes_cf_, key,
+            rocksdb::Slice(
+                reinterpret_cast<const char*>(builder.GetBufferPointer()),
+                builder.GetSize()));
+  zone_map_keys_.insert(key);
+}
 
-  // Finish the builder
-  builder.Finish(fb_index);
+auto RdbStorage::DropZoneMaps() -> void {
+  if (zone_map_keys_.empty()) {
+    return;
+  }
+  rocksdb::WriteBatch batch;
+  for (const auto& key : zone_map_keys_) {
+    batch.Delete(indexes_cf_, key);
+  }
+  auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to drop zone maps: " + status.ToString());
+  }
+  zone_map_keys_.clear();
+}
 
-  // Store in RocksDB
-  rocksdb::WriteOptions write_options;
-  auto status = db_->Put(
-      write_options, index_key,
-      rocksdb::Slice(reinterpret_cast<const char*>(builder.GetBufferPointer()),
-                     builder.GetSize()));
+auto RdbStorage::GetSegmentPath(const std::string& field) const
+    -> std::string {
+  return path_ + "/ivf-" + field + ".seg";
 }
 
-auto RdbStorage::GetIndex(const std::string& field)
+auto RdbStorage::GetLegacyIvfFlatIndex(const std::string& field)
     -> std::unique_ptr<IvfFlatIndex> {
   std::string index_key_base = MakeIndexKey(field);
   std::string value;
   rocksdb::ReadOptions read_options;
-  std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_options));
+  std::unique_ptr<rocksdb::Iterator> it(
+      db_->NewIterator(read_options, indexes_cf_));
   it->Seek(index_key_base + ":");
   if (!it->Valid() || !it->key().starts_with(index_key_base + ":")) {
     return nullptr;  // No index found
   }
 
   // Retrieve metadata from partition 0
-  auto status = db_->Get(read_options, index_key_base + ":0", &value);
+  auto status =
+      db_->Get(read_options, indexes_cf_, index_key_base + ":0", &value);
   if (!status.ok()) {
     throw std::runtime_error("Failed to get index: " + status.ToString());
   }
@@ -450,10 +1693,11 @@ auto RdbStorage::GetIndex(const std::string& field)
   std::string field_name = fb_index->field_name()->str();
   size_t dim = fb_index->dim();
   size_t nlist = fb_index->nlist();
+  auto metric = FromFbMetric(fb_index->metric());
 
   // IvfFlatIndex index(field_name, dim, nlist);
   std::unique_ptr<IvfFlatIndex> index =
-      std::make_unique<IvfFlatIndex>(field_name, dim, nlist);
+      std::make_unique<IvfFlatIndex>(field_name, dim, nlist, metric);
 
   std::vector<Vector> centroids;
   std::vector<IvfList> inverted_lists;
@@ -487,18 +1731,15 @@ auto RdbStorage::GetIndex(const std::string& field)
     // Extract inverted lists
     if (fb_index->inverted_lists()) {
       for (const auto* list : *fb_index->inverted_lists()) {
-        IvfList ivf_list;
+        IvfList ivf_list(dim);
         if (list->entries()) {
+          ivf_list.Reserve(list->entries()->size());
           for (const auto* entry : *list->entries()) {
             Key key = entry->key();
-            Vector vec;
             if (entry->vector() && entry->vector()->values()) {
-              vec.reserve(entry->vector()->values()->size());
-              for (float val : *entry->vector()->values()) {
-                vec.push_back(val);
-              }
+              const auto* values = entry->vector()->values();
+              ivf_list.Append(key, {values->data(), values->size()});
             }
-            ivf_list.emplace_back(key, std::move(vec));
           }
         }
         inverted_lists.push_back(std::move(ivf_list));
@@ -514,9 +1755,446 @@ auto RdbStorage::GetIndex(const std::string& field)
   return index;
 }
 
+auto RdbStorage::PutHnswIndex(const std::string& field,
+                              const HnswIndex& index) -> void {
+  // Nodes are split into partitions of bounded vector payload
+  constexpr const static size_t kFloatsPerPartition = 1 << 22;
+  const size_t num_nodes = index.GetNumNodes();
+  const size_t partition_size =
+      std::max<size_t>(1, kFloatsPerPartition /
+                              std::max<size_t>(1, index.dim_));
+
+  const std::string key_base = MakeHnswKey(field) + ":";
+  // Replace all partitions in one write, a partial one fails to load.
+  // Buffered bulk partitions are ingested first, so they are deleted too.
+  IngestBulk();
+  rocksdb::WriteBatch batch;
+  DeletePartitions(key_base, batch);
+
+  for (size_t offset = 0, idx = 0; offset < num_nodes || idx == 0;
+       offset += partition_size, ++idx) {
+    const size_t end = std::min(num_nodes, offset + partition_size);
+    flatbuffers::FlatBufferBuilder builder;
+
+    // Neighbor lists of all levels, each prefixed with its length
+    std::vector<uint32_t> links;
+    for (size_t i = offset; i < end; ++i) {
+      const auto id = static_cast<HnswIndex::NodeId>(i);
+      for (int l = 0; l <= index.levels_[i]; ++l) {
+        const auto neighbors = index.GetNeighbors(id, l);
+        links.push_back(neighbors.size());
+        links.insert(links.end(), neighbors.begin(), neighbors.end());
+      }
+    }
+    const std::vector<bool> deleted(index.deleted_.begin() + offset,
+                                    index.deleted_.begin() + end);
+
+    auto field_name_offset = builder.CreateString(index.GetName());
+    auto keys_offset =
+        builder.CreateVector(index.keys_.data() + offset, end - offset);
+    auto deleted_offset = builder.CreateVector(deleted);
+    auto levels_offset =
+        builder.CreateVector(index.levels_.data() + offset, end - offset);
+    auto vectors_offset = builder.CreateVector(
+        index.data_.data() + (offset * index.dim_),
+        (end - offset) * index.dim_);
+    auto links_offset = builder.CreateVector(links);
+
+    auto fb_index = fb::CreateHnswIndex(
+        builder, field_name_offset, index.dim_, index.m_,
+        index.ef_construction_, index.ef_search_, ToFbMetric(index.metric_),
+        num_nodes, index.entry_point_, index.max_level_, offset, keys_offset,
+        deleted_offset, levels_offset, vectors_offset, links_offset);
+    builder.Finish(fb_index);
+
+    const rocksdb::Slice value(
+        reinterpret_cast<const char*>(builder.GetBufferPointer()),
+        builder.GetSize());
+    if (options_.bulk_load) {
+      PutValue(key_base + std::to_string(idx), value);
+    } else {
+      batch.Put(indexes_cf_, key_base + std::to_string(idx), value);
+    }
+  }
+
+  auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to put index: " + status.ToString());
+  }
+}
+
+auto RdbStorage::GetHnswIndex(const std::string& field)
+    -> std::unique_ptr<HnswIndex> {
+  auto partitions = GetPartitions(MakeHnswKey(field));
+  if (partitions.empty()) {
+    return nullptr;  // No index found
+  }
+  SortPartitions<fb::HnswIndex>(partitions);
+  const auto get_partition = [](const std::string& value) {
+    return flatbuffers::GetRoot<fb::HnswIndex>(value.data());
+  };
+
+  const auto* meta = get_partition(partitions.front());
+  auto index = std::make_unique<HnswIndex>(
+      meta->field_name()->str(), meta->dim(), meta->m(),
+      meta->ef_construction(), meta->ef_search(),
+      FromFbMetric(meta->metric()));
+  const size_t dim = meta->dim();
+
+  for (const auto& value : partitions) {
+    const auto* fb_index = get_partition(value);
+    if (fb_index->offset() != index->GetNumNodes() ||
+        fb_index->dim() != dim) {
+      throw std::runtime_error("Inconsistent index metadata");
+    }
+
+    const auto* keys = fb_index->keys();
+    const auto* deleted = fb_index->deleted();
+    const auto* levels = fb_index->levels();
+    const auto* vectors = fb_index->vectors();
+    const auto* links = fb_index->links();
+    size_t link_pos = 0;
+    for (size_t i = 0; i < keys->size(); ++i) {
+      const int level = levels->Get(i);
+      const auto id = index->AllocateNode(
+          keys->Get(i), {vectors->data() + (i * dim), dim}, level);
+      for (int l = 0; l <= level; ++l) {
+        const size_t count = links->Get(link_pos);
+        index->SetNeighbors(id, l, {links->data() + link_pos + 1, count});
+        link_pos += count + 1;
+      }
+      if (deleted->Get(i)) {
+        index->deleted_[id] = true;
+      } else {
+        index->key_to_node_[keys->Get(i)] = id;
+      }
+    }
+  }
+
+  if (index->GetNumNodes() != meta->num_nodes()) {
+    throw std::runtime_error("Inconsistent index metadata");
+  }
+  index->entry_point_ = meta->entry_point();
+  index->max_level_ = meta->max_level();
+  return index;
+}
+
+auto RdbStorage::PutIvfPqIndex(const std::string& field,
+                               const IvfPqIndex& index) -> void {
+  const std::string key_base = MakeIvfPqKey(field) + ":";
+  const size_t dim = index.dim_;
+  const size_t nlist = index.nlist_;
+
+  // Replace all partitions at once, their number shrinks with the lists.
+  // Buffered bulk partitions are ingested first, so they are deleted too.
+  IngestBulk();
+  rocksdb::WriteBatch batch;
+  DeletePartitions(key_base, batch);
+
+  for (size_t offset = 0, idx = 0; offset < nlist || idx == 0; ++idx) {
+    const size_t end =
+        GetPartitionEnd(index.lists_, index.pending_lists_, offset);
+
+    flatbuffers::FlatBufferBuilder builder;
+    auto lists = CreateCodeLists(builder, index.lists_, offset, end);
+    auto pending_lists =
+        CreateIvfLists(builder, index.pending_lists_, offset, end);
+
+    // Centroids and codebooks go with the first partition
+    flatbuffers::Offset<flatbuffers::Vector<float>> centroids = 0;
+    flatbuffers::Offset<flatbuffers::Vector<float>> codebooks = 0;
+    if (offset == 0) {
+      centroids = builder.CreateVector(index.centroids_.data(),
+                                       index.centroids_.size());
+      const auto& pq_codebooks = index.pq_.GetCodebooks();
+      codebooks =
+          builder.CreateVector(pq_codebooks.data(), pq_codebooks.size());
+    }
+
+    auto field_name_offset = builder.CreateString(index.GetName());
+    auto fb_index = fb::CreateIvfPqIndex(
+        builder, field_name_offset, dim, nlist, index.pq_.GetCodeSize(),
+        ToFbMetric(index.metric_), offset, centroids, codebooks, lists,
+        pending_lists);
+    builder.Finish(fb_index);
+
+    const rocksdb::Slice value(
+        reinterpret_cast<const char*>(builder.GetBufferPointer()),
+        builder.GetSize());
+    if (options_.bulk_load) {
+      PutValue(key_base + std::to_string(idx), value);
+    } else {
+      batch.Put(indexes_cf_, key_base + std::to_string(idx), value);
+    }
+    offset = end;
+  }
+
+  auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to put index: " + status.ToString());
+  }
+}
+
+auto RdbStorage::GetIvfPqIndex(const std::string& field)
+    -> std::unique_ptr<IvfPqIndex> {
+  auto partitions = GetPartitions(MakeIvfPqKey(field));
+  if (partitions.empty()) {
+    return nullptr;  // No index found
+  }
+  SortPartitions<fb::IvfPqIndex>(partitions);
+
+  const auto* meta = flatbuffers::GetRoot<fb::IvfPqIndex>(
+      partitions.front().data());
+  const size_t dim = meta->dim();
+  const size_t nlist = meta->nlist();
+  auto index = std::make_unique<IvfPqIndex>(meta->field_name()->str(), dim,
+                                            nlist, meta->pq_m(),
+                                            FromFbMetric(meta->metric()));
+  if (meta->offset() != 0 || !meta->centroids() ||
+      meta->centroids()->size() != nlist * dim) {
+    throw std::runtime_error("Inconsistent index metadata");
+  }
+  std::copy_n(meta->centroids()->data(), nlist * dim,
+              index->centroids_.begin());
+  if (meta->codebooks() && meta->codebooks()->size() > 0) {
+    index->pq_.SetCodebooks(
+        {meta->codebooks()->data(), meta->codebooks()->size()});
+  }
+
+  size_t list_idx = 0;
+  for (const auto& value : partitions) {
+    const auto* fb_index = flatbuffers::GetRoot<fb::IvfPqIndex>(value.data());
+    if (fb_index->offset() != list_idx || fb_index->dim() != dim ||
+        fb_index->nlist() != nlist) {
+      throw std::runtime_error("Inconsistent index metadata");
+    }
+
+    const size_t n = fb_index->lists()->size();
+    for (size_t i = 0; i < n; ++i, ++list_idx) {
+      ReadCodeList(fb_index->lists()->Get(i), index->lists_[list_idx]);
+      ReadIvfList(fb_index->pending_lists()->Get(i),
+                      index->pending_lists_[list_idx]);
+      index->num_pending_ += index->pending_lists_[list_idx].Size();
+    }
+  }
+  if (list_idx != nlist) {
+    throw std::runtime_error("Inconsistent index metadata");
+  }
+
+  return index;
+}
+
+auto RdbStorage::PutIvfSqIndex(const std::string& field,
+                               const IvfSqIndex& index) -> void {
+  const std::string key_base = MakeIvfSqKey(field) + ":";
+  const size_t dim = index.dim_;
+  const size_t nlist = index.nlist_;
+
+  // Replace all partitions at once, their number shrinks with the lists.
+  // Buffered bulk partitions are ingested first, so they are deleted too.
+  IngestBulk();
+  rocksdb::WriteBatch batch;
+  DeletePartitions(key_base, batch);
+
+  for (size_t offset = 0, idx = 0; offset < nlist || idx == 0; ++idx) {
+    const size_t end =
+        GetPartitionEnd(index.lists_, index.pending_lists_, offset);
+
+    flatbuffers::FlatBufferBuilder builder;
+    auto lists = CreateCodeLists(builder, index.lists_, offset, end);
+    auto pending_lists =
+        CreateIvfLists(builder, index.pending_lists_, offset, end);
+
+    // Centroids and SQ8 ranges go with the first partition
+    flatbuffers::Offset<flatbuffers::Vector<float>> centroids = 0;
+    flatbuffers::Offset<flatbuffers::Vector<float>> vmin = 0;
+    flatbuffers::Offset<flatbuffers::Vector<float>> scale = 0;
+    if (offset == 0) {
+      centroids = builder.CreateVector(index.centroids_.data(),
+                                       index.centroids_.size());
+      const auto& sq_min = index.sq_.GetMin();
+      const auto& sq_scale = index.sq_.GetScale();
+      vmin = builder.CreateVector(sq_min.data(), sq_min.size());
+      scale = builder.CreateVector(sq_scale.data(), sq_scale.size());
+    }
+
+    auto field_name_offset = builder.CreateString(index.GetName());
+    auto fb_index = fb::CreateIvfSqIndex(
+        builder, field_name_offset, dim, nlist,
+        ToFbQuantization(index.GetQuantization()), ToFbMetric(index.metric_),
+        offset, centroids, vmin, scale, lists, pending_lists);
+    builder.Finish(fb_index);
+
+    const rocksdb::Slice value(
+        reinterpret_cast<const char*>(builder.GetBufferPointer()),
+        builder.GetSize());
+    if (options_.bulk_load) {
+      PutValue(key_base + std::to_string(idx), value);
+    } else {
+      batch.Put(indexes_cf_, key_base + std::to_string(idx), value);
+    }
+    offset = end;
+  }
+
+  auto status = db_->Write(rocksdb::WriteOptions(), &batch);
+  if (!status.ok()) {
+    throw std::runtime_error("Failed to put index: " + status.ToString());
+  }
+}
+
+auto RdbStorage::GetIvfSqIndex(const std::string& field)
+    -> std::unique_ptr<IvfSqIndex> {
+  auto partitions = GetPartitions(MakeIvfSqKey(field));
+  if (partitions.empty()) {
+    return nullptr;  // No index found
+  }
+  SortPartitions<fb::IvfSqIndex>(partitions);
+
+  const auto* meta = flatbuffers::GetRoot<fb::IvfSqIndex>(
+      partitions.front().data());
+  const size_t dim = meta->dim();
+  const size_t nlist = meta->nlist();
+  auto index = std::make_unique<IvfSqIndex>(
+      meta->field_name()->str(), dim, nlist,
+      FromFbQuantization(meta->quantization()), FromFbMetric(meta->metric()));
+  if (meta->offset() != 0 || !meta->centroids() ||
+      meta->centroids()->size() != nlist * dim) {
+    throw std::runtime_error("Inconsistent index metadata");
+  }
+  std::copy_n(meta->centroids()->data(), nlist * dim,
+              index->centroids_.begin());
+  if (meta->vmin() && meta->vmin()->size() > 0) {
+    index->sq_.SetRange({meta->vmin()->data(), meta->vmin()->size()},
+                        {meta->scale()->data(), meta->scale()->size()});
+  }
+
+  size_t list_idx = 0;
+  for (const auto& value : partitions) {
+    const auto* fb_index = flatbuffers::GetRoot<fb::IvfSqIndex>(value.data());
+    if (fb_index->offset() != list_idx || fb_index->dim() != dim ||
+        fb_index->nlist() != nlist) {
+      throw std::runtime_error("Inconsistent index metadata");
+    }
+
+    const size_t n = fb_index->lists()->size();
+    for (size_t i = 0; i < n; ++i, ++list_idx) {
+      ReadCodeList(fb_index->lists()->Get(i), index->lists_[list_idx]);
+      ReadIvfList(fb_index->pending_lists()->Get(i),
+                      index->pending_lists_[list_idx]);
+      index->num_pending_ += index->pending_lists_[list_idx].Size();
+    }
+  }
+  if (list_idx != nlist) {
+    throw std::runtime_error("Inconsistent index metadata");
+  }
+
+  return index;
+}
+
+auto RdbStorage::GetPartitions(const std::string& prefix)
+    -> std::vector<std::string> {
+  const std::string key_base = prefix + ":";
+  std::unique_ptr<rocksdb::Iterator> it(
+      db_->NewIterator(rocksdb::ReadOptions(), indexes_cf_));
+  std::vector<std::string> partitions;
+  for (it->Seek(key_base); it->Valid() && it->key().starts_with(key_base);
+       it->Next()) {
+    partitions.push_back(it->value().ToString());
+  }
+  return partitions;
+}
+
+auto RdbStorage::DeletePartitions(const std::string& key_base,
+                                  rocksdb::WriteBatch& batch) -> void {
+  std::unique_ptr<rocksdb::Iterator> it(
+      db_->NewIterator(rocksdb::ReadOptions(), indexes_cf_));
+  for (it->Seek(key_base); it->Valid() && it->key().starts_with(key_base);
+       it->Next()) {
+    batch.Delete(indexes_cf_, it->key());
+  }
+}
+
+auto RdbStorage::PutValue(std::string key, rocksdb::Slice value) -> void {
+  if (!options_.bulk_load) {
+    auto status =
+        db_->Put(rocksdb::WriteOptions(), GetColumnFamily(key), key, value);
+    if (!status.ok()) {
+      throw std::runtime_error("Failed to put value: " + status.ToString());
+    }
+    return;
+  }
+
+  // Bounds the memory held by buffered entries
+  constexpr const size_t kBulkFileBytes = size_t{256} << 20;
+  bulk_bytes_ += key.size() + value.size();
+  bulk_positions_.insert_or_assign(key, bulk_entries_.size());
+  bulk_entries_.emplace_back(std::move(key), value.ToString());
+  if (bulk_bytes_ >= kBulkFileBytes) {
+    IngestBulk();
+  }
+}
+
+auto RdbStorage::IngestBulk() -> void {
+  if (bulk_entries_.empty()) {
+    return;
+  }
+
+  // SST files need strictly increasing keys, the last put of a key wins
+  std::ranges::stable_sort(bulk_entries_, {},
+                           [](const auto& entry) { return entry.first; });
+  const auto last = std::unique(
+      bulk_entries_.rbegin(), bulk_entries_.rend(),
+      [](const auto& a, const auto& b) { return a.first == b.first; });
+  bulk_entries_.erase(bulk_entries_.begin(), last.base());
+
+  // One file per column family, keys of each are contiguous once sorted
+  auto begin = bulk_entries_.begin();
+  while (begin != bulk_entries_.end()) {
+    auto* cf = GetColumnFamily(begin->first);
+    const auto end =
+        std::find_if(begin, bulk_entries_.end(), [&](const auto& entry) {
+          return GetColumnFamily(entry.first) != cf;
+        });
+    const std::string file =
+        path_ + "/bulk-" + std::to_string(bulk_files_++) + ".sst";
+    // With the bloom filter, block size and compression of the column
+    // family. Ingested files often land in the bottommost level, where
+    // compactions may never rewrite them.
+    const rocksdb::Options sst_options = db_->GetOptions(cf);
+    rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), sst_options, cf);
+    auto status = writer.Open(file);
+    for (auto it = begin; it != end && status.ok(); ++it) {
+      status = writer.Put(it->first, it->second);
+    }
+    if (status.ok()) {
+      status = writer.Finish();
+    }
+    if (!status.ok()) {
+      throw std::runtime_error("Failed to write SST file: " +
+                               status.ToString());
+    }
+
+    rocksdb::IngestExternalFileOptions ingest_options;
+    ingest_options.move_files = true;
+    status = db_->IngestExternalFile(cf, {file}, ingest_options);
+    if (!status.ok()) {
+      throw std::runtime_error("Failed to ingest SST file: " +
+                               status.ToString());
+    }
+    begin = end;
+  }
+  bulk_entries_.clear();
+  bulk_positions_.clear();
+  bulk_bytes_ = 0;
+}
+
 auto RdbStorage::DeleteIndex(const std::string& field) -> void {
-  std::string index_key = MakeIndexKey(field);
-  auto status = db_->Delete(rocksdb::WriteOptions(), index_key);
+  rocksdb::WriteBatch batch;
+  batch.Delete(indexes_cf_, MakeCentroidKey(field));
+  batch.Delete(indexes_cf_, MakeZoneMapKey(field));
+  DeletePartitions(MakeIndexKey(field) + ":", batch);
+  std::filesystem::remove(GetSegmentPath(field));
+  auto status = db_->Write(rocksdb::WriteOptions(), &batch);
   if (!status.ok()) {
     throw std::runtime_error("Failed to delete index: " + status.ToString());
   }
@@ -3,18 +3,72 @@
 #include <rocksdb/db.h>
 #include <rocksdb/options.h>
 
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "rocksdb/slice.h"
+#include "rocksdb/write_batch.h"
+#include "hnsw.h"
+#include "ivf_pq.h"
+#include "ivf_sq.h"
+#include "record_cache.h"
 #include "roxdb/db.h"
 #include "vector.h"
 
 namespace rox {
 
+namespace fb {
+struct Record;
+}  // namespace fb
+
 class RdbStorage;
 
+// Index change logged with a record write, replayed into the indexes on open
+// when it is newer than their last checkpoint
+struct IndexDelta {
+  enum class Op : char { kPut = 'P', kDelete = 'D' } op;
+  Key key;
+  // Of the record before the change, empty if there was none. They locate
+  // its postings in the saved indexes.
+  std::vector<Vector> old_vectors;
+};  // struct IndexDelta
+
+// Read-only access to a record without deserializing it. Fields are read in
+// place from the serialized record, kept pinned by the view or owned by the
+// caller, or from a shared cached Record. Only string scalars are copied.
+class RecordView {
+ public:
+  RecordView() = default;
+  explicit RecordView(std::shared_ptr<const Record> record);
+  // value must outlive the view
+  explicit RecordView(rocksdb::Slice value);
+  explicit RecordView(std::unique_ptr<rocksdb::PinnableSlice> pinned);
+
+  auto GetId() const -> Key;
+  auto GetScalar(size_t i) const -> Scalar;
+  auto GetScalars() const -> std::vector<Scalar>;
+  // Valid as long as the view
+  auto GetVector(size_t i) const -> std::span<const Float>;
+  auto ApplyFilter(const Schema& schema, const ScalarFilter& filter) const
+      -> bool;
+  auto ToRecord() const -> Record;
+
+ private:
+  std::shared_ptr<const Record> record_;
+  const fb::Record* fb_record_ = nullptr;
+  std::unique_ptr<rocksdb::PinnableSlice> pinned_;
+  // Copies of vectors not aligned for Float in the serialized record
+  mutable std::vector<Vector> unaligned_;
+};  // class RecordView
+
 class Storage {
  public:
   explicit Storage(std::string_view path, const DbOptions& options);
@@ -24,39 +78,73 @@ class Storage {
   // Pass-through to RdbStorage
   auto GetSchema() const -> Schema;
 
-  // Cached in-memory
+  // Buffered in memory until FlushRecords or the write buffer is full, or
+  // written through with DbOptions::durable_writes
   auto PutRecord(Key key, const Record& record) -> void;
-  // Cached in-memory
+  // Read through the record cache
   auto GetRecord(Key key) -> Record;
+  // Buffered or cached copy if any, otherwise read from RdbStorage into the
+  // record cache
+  auto GetRecordView(Key key) -> RecordView;
+  // As above, with value the stored record read by an iterator
+  auto GetRecordView(Key key, rocksdb::Slice value) -> RecordView;
+  // As GetRecordView, std::nullopt if there is no record with the key. Not
+  // cached, it serves writes.
+  auto FindRecordView(Key key) -> std::optional<RecordView>;
+  // Write-through, keyed by Record::id
+  auto PutRecords(std::span<const Record> records) -> void;
   // Write-through
   auto DeleteRecord(Key key) -> void;
 
-  // Cache records in memory
+  // Cache up to n records, as long as they fit the cache budget
   auto PrefetchRecords(size_t n) -> void;
-  // Flush cached records to RdbStorage
+  // Write buffered records to RdbStorage
   auto FlushRecords() -> void;
 
   // Pass-through to RdbStorage
-  auto PutIndex(const std::string& field, const IvfFlatIndex& index) -> void;
+  auto PutIndex(const std::string& field, VectorIndex& index) -> void;
   // Pass-through to RdbStorage
-  auto GetIndex(const std::string& field) -> std::unique_ptr<IvfFlatIndex>;
+  auto GetIndex(const VectorField& field) -> std::unique_ptr<VectorIndex>;
   // Pass-through to RdbStorage
   auto DeleteIndex(const std::string& field) -> void;
 
   // Pass-through to RdbStorage
   auto GetIterator(std::string_view prefix)
       -> std::unique_ptr<rocksdb::Iterator>;
+  // Pass-through to RdbStorage, once buffered records are written so that
+  // the index covers them
+  auto ScanScalarIndex(const ScalarFilter& filter) -> std::vector<Key>;
+  // Pass-through to RdbStorage
+  auto EstimateNumRecords() const -> size_t;
 
-  auto GetCacheHit() const noexcept -> size_t { return cache_hit_; }
-  auto GetCacheMiss() const noexcept -> size_t { return cache_miss_; }
+  // Pass-through to RdbStorage
+  auto GetDeltas() -> std::vector<IndexDelta>;
+  // Pass-through to RdbStorage
+  auto GetDeltaEnd() const noexcept -> uint64_t;
+  // Pass-through to RdbStorage
+  auto TruncateDeltas(uint64_t end) -> void;
+
+  auto GetCacheHit() const noexcept -> size_t { return cache_.GetHits(); }
+  auto GetCacheMiss() const noexcept -> size_t { return cache_.GetMisses(); }
+  auto GetCacheEviction() const noexcept -> size_t {
+    return cache_.GetEvictions();
+  }
 
  private:
   friend class DbImpl;
-  size_t cache_hit_ = 0;
-  size_t cache_miss_ = 0;
-  std::unordered_set<Key> dirty_records_;
-  std::unordered_map<Key, Record> records_cache_;
+  // Clean records only, safe for concurrent readers
+  RecordCache cache_;
+  // Records put but not yet written to RdbStorage
+  mutable std::shared_mutex write_buffer_mutex_;
+  std::unordered_map<Key, std::shared_ptr<const Record>> write_buffer_;
+  size_t write_buffer_bytes_ = 0;
+  const size_t write_buffer_capacity_;
+  // Records are written through with their index deltas
+  const bool durable_writes_;
   std::unique_ptr<RdbStorage> rdb_storage_;
+
+  auto GetBuffered(Key key) const -> std::shared_ptr<const Record>;
+  auto FlushWriteBuffer() -> void;
 };
 
 class RdbStorage {
@@ -71,34 +159,157 @@ class RdbStorage {
   auto PutRecord(Key key, const Record& record) -> void;
   auto GetRecord(Key key) const -> Record;
   auto DeleteRecord(Key key) -> void;
+  // Serialized in parallel and written in WriteBatches
+  auto PutRecords(std::span<const Key> keys, std::span<const Record> records)
+      -> void;
 
-  // Zero-Copy Access to Record Scalar Fields
-  // auto GetRecordScalarField(Key key, const std::string& field) const ->
-  // Scalar;
+  // Zero-copy access, see RecordView
+  auto GetRecordView(Key key) const -> RecordView;
+  auto FindRecordView(Key key) const -> std::optional<RecordView>;
 
-  auto PutIndex(const std::string& field, const IvfFlatIndex& index) -> void;
-  auto GetIndex(const std::string& field) -> std::unique_ptr<IvfFlatIndex>;
+  // With DbOptions::durable_writes, record writes and deletes log an
+  // IndexDelta in the same WriteBatch under "d:<sequence>". Its value is the
+  // op, the key, then each old vector as its size and floats.
+  auto GetDeltas() -> std::vector<IndexDelta>;
+  // Sequence number of the next delta
+  auto GetDeltaEnd() const noexcept -> uint64_t { return next_delta_; }
+  // Drop the deltas before end, once the indexes hold them
+  auto TruncateDeltas(uint64_t end) -> void;
+
+  // Dispatch on the index type
+  auto PutIndex(const std::string& field, VectorIndex& index) -> void;
+  auto GetIndex(const VectorField& field) -> std::unique_ptr<VectorIndex>;
   auto DeleteIndex(const std::string& field) -> void;
 
+  // Keys of the records whose value of an indexed scalar field matches
+  // filter, which must not be kNe. Entries "x:<field>:<value>:<key>" are
+  // written and deleted in the write batches of the records, so they match
+  // the stored records.
+  auto ScanScalarIndex(const ScalarFilter& filter) const -> std::vector<Key>;
+  // Estimate of RocksDB
+  auto EstimateNumRecords() const -> size_t;
+
   auto GetIterator(std::string_view prefix)
       -> std::unique_ptr<rocksdb::Iterator>;
 
   static auto MakeRecordKey(Key key) -> std::string;
   static auto MakeIndexKey(const std::string& field) -> std::string;
   static auto MakeCentroidKey(const std::string& field) -> std::string;
+  static auto MakeHnswKey(const std::string& field) -> std::string;
+  static auto MakeIvfPqKey(const std::string& field) -> std::string;
+  static auto MakeIvfSqKey(const std::string& field) -> std::string;
+  static auto MakeZoneMapKey(const std::string& field) -> std::string;
+
+  static auto MakeDeltaKey(uint64_t sequence) -> std::string;
+  static auto MakeScalarIndexKey(const std::string& field, const Scalar& value,
+                                 Key key) -> std::string;
 
   static auto GetKey(rocksdb::Slice rdb_key) -> Key;
 
+  // Bulk-load mode only: write buffered entries to an SST file and ingest it
+  auto IngestBulk() -> void;
+
   static constexpr const char* kSchemaPrefix = "s:";
-  static constexpr const char* kRecordPrefix = "r:";
+  // Records are keyed by the prefix byte and the big-endian key, 9 bytes, so
+  // they sort in key order
+  static constexpr const char* kRecordPrefix = "R";
+  static constexpr const char* kRecordEndKey = "S";
+  static constexpr const size_t kRecordKeySize = 1 + sizeof(Key);
+  // Decimal string keys written by earlier versions, migrated on open
+  static constexpr const char* kLegacyRecordPrefix = "r:";
   static constexpr const char* kIndexPrefix = "i:";
   static constexpr const char* kCentroidPrefix = "c:";
+  static constexpr const char* kHnswPrefix = "h:";
+  static constexpr const char* kIvfPqPrefix = "q:";
+  static constexpr const char* kIvfSqPrefix = "v:";
+  static constexpr const char* kDeltaPrefix = "d:";
+  // Zone maps of IVF-Flat lists as of the last index save, valid until the
+  // next record write, which drops them
+  static constexpr const char* kZoneMapPrefix = "z:";
+  static constexpr const char* kScalarIndexPrefix = "x:";
+  // Records and index values (with deltas) have their own column families,
+  // the schema is in the default one
+  static constexpr const char* kRecordsColumnFamily = "records";
+  static constexpr const char* kIndexesColumnFamily = "indexes";
 
  private:
-  auto PutIndexPartition(const std::string& field, const IvfFlatIndex& index,
-                         size_t idx, size_t offset, size_t size) -> void;
+  // Rewrites only the partitions of dirty lists when the index was saved or
+  // loaded before, all of them otherwise
+  auto PutIvfFlatIndex(const std::string& field, IvfFlatIndex& index) -> void;
+  // False if the index needs a full rewrite instead
+  auto PutIvfFlatPartitions(const std::string& field, IvfFlatIndex& index)
+      -> bool;
+  // Lists [offset, end) under key
+  auto PutIvfFlatPartition(const std::string& key, const IvfFlatIndex& index,
+                           size_t offset, size_t end,
+                           rocksdb::WriteBatch& batch) -> void;
+  // Centroids and zone maps are read eagerly, inverted lists per partition
+  // on demand
+  auto GetIvfFlatIndex(const std::string& field)
+      -> std::unique_ptr<IvfFlatIndex>;
+  // Zone maps of the lists of index that FindZoneMap returns, or a delete
+  // of the saved ones if there are none
+  auto PutZoneMaps(const std::string& field, const IvfFlatIndex& index,
+                   rocksdb::WriteBatch& batch) -> void;
+  // Delete the zone maps that may be stored, before writing records they do
+  // not cover
+  auto DropZoneMaps() -> void;
+  // IVF-Flat segment file of field, see DbOptions::index_segments
+  auto GetSegmentPath(const std::string& field) const -> std::string;
+  // Indexes written without an IvfCentroids value are read at once
+  auto GetLegacyIvfFlatIndex(const std::string& field)
+      -> std::unique_ptr<IvfFlatIndex>;
+  auto PutHnswIndex(const std::string& field, const HnswIndex& index) -> void;
+  auto GetHnswIndex(const std::string& field) -> std::unique_ptr<HnswIndex>;
+  auto PutIvfPqIndex(const std::string& field, const IvfPqIndex& index)
+      -> void;
+  auto GetIvfPqIndex(const std::string& field) -> std::unique_ptr<IvfPqIndex>;
+  auto PutIvfSqIndex(const std::string& field, const IvfSqIndex& index)
+      -> void;
+  auto GetIvfSqIndex(const std::string& field) -> std::unique_ptr<IvfSqIndex>;
+  // Partitioned indexes store one value per group of lists under
+  // "<key_base><n>". Add deletes of all of them to batch.
+  auto DeletePartitions(const std::string& key_base,
+                        rocksdb::WriteBatch& batch) -> void;
+  // Values of all partitions under "<prefix>:", in key order
+  auto GetPartitions(const std::string& prefix) -> std::vector<std::string>;
+  // Move records and index values that earlier versions wrote to the default
+  // column family to their own, rewriting records stored under legacy keys
+  auto MigrateKeys() -> void;
+  // Column family of a key, by its prefix
+  auto GetColumnFamily(std::string_view key) const
+      -> rocksdb::ColumnFamilyHandle*;
+  // Buffer for the next ingested SST files in bulk-load mode, otherwise a Put
+  auto PutValue(std::string key, rocksdb::Slice value) -> void;
+  // Whether record writes log deltas, not in bulk-load mode as there is no WAL
+  auto IsLogged() const noexcept -> bool {
+    return options_.durable_writes && !options_.bulk_load;
+  }
+  auto LogDelta(rocksdb::WriteBatch& batch, IndexDelta delta) -> void;
+  // Of the schema, if stored
+  auto SetIndexedFields(const Schema& schema) -> void;
+  // Replace the scalar index entries of key for the stored record old by
+  // those of record, nullptr on delete. Added to batch, or put with PutValue
+  // if batch is nullptr.
+  auto IndexScalars(rocksdb::WriteBatch* batch, Key key,
+                    const std::optional<RecordView>& old, const Record* record)
+      -> void;
   std::unique_ptr<rocksdb::DB> db_;
+  rocksdb::ColumnFamilyHandle* records_cf_ = nullptr;
+  rocksdb::ColumnFamilyHandle* indexes_cf_ = nullptr;
   const DbOptions& options_;
+  const std::string path_;
+  std::vector<std::pair<std::string, std::string>> bulk_entries_;
+  // Position of the last buffered entry of each key
+  std::unordered_map<std::string, size_t> bulk_positions_;
+  size_t bulk_bytes_ = 0;
+  size_t bulk_files_ = 0;
+  // Written by a single writer at a time
+  uint64_t next_delta_ = 0;
+  // Name and position of the indexed scalar fields
+  std::vector<std::pair<std::string, size_t>> indexed_fields_;
+  // Keys of the zone maps read or saved since the last DropZoneMaps
+  std::unordered_set<std::string> zone_map_keys_;
 };
 
 }  // namespace rox
\ No newline at end of file
@@ -1,41 +1,365 @@
 #include "vector.h"
 
 #include <algorithm>
+#include <cassert>
 #include <execution>
+#include <numeric>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
 #ifdef DEBUG
 #include <iostream>
 #endif
 
 #include "roxdb/db.h"
+#include "segment.h"
 
 namespace rox {
 
-auto IvfFlatIterator::Seek() -> void {
-  probe_lists_.clear();
-  current_prob_ = 0;
-  candidates_ = {};
+auto IvfFlatIndex::NewIterator(const Vector& query, size_t nprobe) const
+    -> std::unique_ptr<VectorIterator> {
+  return std::make_unique<IvfFlatIterator>(*this, query, nprobe, 0, 0);
+}
 
-  // Find cloest nprobe_ centroids
-  std::vector<std::pair<Float, CentroidId>> distances(index_.centroids_.size());
-  std::transform(std::execution::par, index_.centroids_.begin(),
-                 index_.centroids_.end(), distances.begin(),
-                 [&](const auto& centroid) {
-                   return std::make_pair(GetDistanceL2Sq(centroid, query_),
-                                         &centroid - index_.centroids_.data());
-                 });
-
-  auto comp = [](const auto& a, const auto& b) { return a.first < b.first; };
-  std::partial_sort(std::execution::seq, distances.begin(),
-                    distances.begin() + nprobe_, distances.end(), comp);
-
-  // Add nprobe_ centroids to probe_lists_
-  probe_lists_.reserve(nprobe_);
-  for (size_t i = 0; i < nprobe_; ++i) {
-    const auto& [_, centroid_idx] = distances[i];
-    probe_lists_.push_back(centroid_idx);
+auto IvfFlatIndex::Put(const Key& key, const Vector& v) -> void {
+  const CentroidId c =
+      AssignCentroid(v, centroids_.data(), nlist_, dim_, metric_);
+  IndexPartition(GetPartition(c));
+  Upsert(c, key, v);
+}
+
+auto IvfFlatIndex::Update(const Key& key, std::span<const Float> old_v,
+                          const Vector& v) -> void {
+  LocateKey(key, old_v);
+  Put(key, v);
+}
+
+auto IvfFlatIndex::PutBatch(std::span<const Key> keys, const Float* data)
+    -> void {
+  std::vector<CentroidId> assignments(keys.size());
+  AssignCentroids(data, keys.size(), centroids_.data(), nlist_, dim_, metric_,
+                  assignments.data());
+
+  // Grow each list once, then append
+  std::vector<size_t> counts(nlist_);
+  for (const auto list : assignments) {
+    ++counts[list];
+  }
+  for (CentroidId c = 0; c < nlist_; ++c) {
+    if (counts[c] > 0) {
+      IndexPartition(GetPartition(c));
+      inverted_lists_[c].Reserve(inverted_lists_[c].Size() + counts[c]);
+    }
+  }
+  for (size_t i = 0; i < keys.size(); ++i) {
+    Upsert(assignments[i], keys[i], {data + (i * dim_), dim_});
+  }
+}
+
+auto IvfFlatIndex::Delete(const Key& key) -> void {
+  BuildDirectory();
+  Erase(key);
+}
+
+auto IvfFlatIndex::Remove(const Key& key, std::span<const Float> old_v)
+    -> void {
+  LocateKey(key, old_v);
+  Erase(key);
+}
+
+auto IvfFlatIndex::Discard(const Key& key, std::span<const Vector> candidates)
+    -> void {
+  for (const auto& v : candidates) {
+    IndexPartition(GetPartition(
+        AssignCentroid(v, centroids_.data(), nlist_, dim_, metric_)));
+  }
+  Erase(key);
+}
+
+auto IvfFlatIndex::CompactLists() -> void {
+  for (CentroidId c = 0; c < nlist_; ++c) {
+    if (inverted_lists_[c].GetNumDeleted() > 0) {
+      CompactList(c);
+    }
+  }
+}
+
+auto IvfFlatIndex::GetPartition(CentroidId c) const -> size_t {
+  if (!loader_) {
+    return 0;
+  }
+  const auto it = std::ranges::upper_bound(partition_offsets_, c);
+  return std::distance(partition_offsets_.begin(), it) - 1;
+}
+
+auto IvfFlatIndex::IndexPartition(size_t partition) -> void {
+  if (indexed_partitions_[partition]) {
+    return;
+  }
+  LoadPartition(partition);
+  const size_t begin = loader_ ? partition_offsets_[partition] : 0;
+  const size_t end = loader_ ? partition_offsets_[partition + 1] : nlist_;
+  for (size_t c = begin; c < end; ++c) {
+    auto& list = inverted_lists_[c];
+    for (size_t i = 0; i < list.Size(); ++i) {
+      if (list.IsDeleted(i)) {
+        continue;
+      }
+      // A key has one live posting, unless a crash left two. Postings are
+      // not ordered by put across lists, and one already in the directory
+      // may have been written since the lists were saved: it is kept.
+      const auto [it, inserted] = directory_.try_emplace(
+          list.GetKey(i), Posting{static_cast<uint32_t>(c),
+                                  static_cast<uint32_t>(i)});
+      if (!inserted) {
+        list.MarkDeleted(i);
+        dirty_lists_[c] = true;
+      }
+    }
+  }
+  indexed_partitions_[partition] = true;
+}
+
+auto IvfFlatIndex::BuildDirectory() -> void {
+  for (size_t p = 0; p < indexed_partitions_.size(); ++p) {
+    IndexPartition(p);
+  }
+}
+
+auto IvfFlatIndex::LocateKey(Key key, std::span<const Float> v) -> void {
+  IndexPartition(GetPartition(
+      AssignCentroid(v, centroids_.data(), nlist_, dim_, metric_)));
+  // Not in the list of its vector if the centroids changed since it was put
+  if (!directory_.contains(key)) {
+    BuildDirectory();
+  }
+}
+
+auto IvfFlatIndex::Append(CentroidId c, Key key, std::span<const Float> v)
+    -> void {
+  auto& list = inverted_lists_[c];
+  directory_[key] = {static_cast<uint32_t>(c),
+                     static_cast<uint32_t>(list.Size())};
+  list.Append(key, v);
+  dirty_lists_[c] = true;
+}
+
+auto IvfFlatIndex::Upsert(CentroidId c, Key key, std::span<const Float> v)
+    -> void {
+  if (auto it = directory_.find(key);
+      it != directory_.end() && it->second.list == c) {
+    inverted_lists_[c].SetVector(it->second.slot, v);
+    dirty_lists_[c] = true;
+  } else {
+    Erase(key);
+    Append(c, key, v);
+  }
+  if (zone_maps_[c]) {
+    zone_map_builder_({&key, 1}, *zone_maps_[c]);
   }
+}
+
+auto IvfFlatIndex::Erase(Key key) -> void {
+  // Compacting costs a pass over the list, amortized over the deletes
+  constexpr const static size_t kMaxDeletedShare = 4;  // 1/4 of the list
+  auto it = directory_.find(key);
+  if (it == directory_.end()) {
+    return;
+  }
+  const CentroidId c = it->second.list;
+  auto& list = inverted_lists_[c];
+  list.MarkDeleted(it->second.slot);
+  dirty_lists_[c] = true;
+  directory_.erase(it);
+  if (list.GetNumDeleted() * kMaxDeletedShare > list.Size()) {
+    CompactList(c);
+  }
+}
+
+auto IvfFlatIndex::CompactList(CentroidId c) -> void {
+  auto& list = inverted_lists_[c];
+  list.Compact();
+  // The keys of the list are in the directory if its partition is indexed
+  for (size_t i = 0; i < list.Size(); ++i) {
+    auto it = directory_.find(list.GetKey(i));
+    if (it != directory_.end() && it->second.list == c) {
+      it->second.slot = static_cast<uint32_t>(i);
+    }
+  }
+  // Values of the deleted postings drop out of the zone map
+  if (zone_map_builder_) {
+    BuildZoneMap(c);
+  }
+}
+
+auto IvfFlatIndex::SetZoneMapBuilder(ZoneMapBuilder builder) -> void {
+  zone_map_builder_ = std::move(builder);
+  BuildZoneMaps();
+}
+
+auto IvfFlatIndex::BuildZoneMaps() -> void {
+  // Lazy lists get theirs when loaded, if not saved with the index
+  if (zone_map_builder_ && loader_) {
+    return;
+  }
+  zone_maps_.assign(nlist_, std::nullopt);
+  saved_zone_maps_.assign(nlist_, false);
+  if (!zone_map_builder_) {
+    return;
+  }
+  for (CentroidId c = 0; c < nlist_; ++c) {
+    BuildZoneMap(c);
+  }
+}
+
+auto IvfFlatIndex::BuildZoneMap(CentroidId c) const -> void {
+  const auto& list = inverted_lists_[c];
+  auto& zone_map = zone_maps_[c].emplace();
+  if (list.GetNumDeleted() == 0) {
+    zone_map_builder_(list.GetKeys(), zone_map);
+    return;
+  }
+  std::vector<Key> keys;
+  keys.reserve(list.Size() - list.GetNumDeleted());
+  for (size_t i = 0; i < list.Size(); ++i) {
+    if (!list.IsDeleted(i)) {
+      keys.push_back(list.GetKey(i));
+    }
+  }
+  zone_map_builder_(keys, zone_map);
+}
+
+auto IvfFlatIndex::UpdateZoneMap(Key key, std::span<const Float> v) -> void {
+  LocateKey(key, v);
+  auto it = directory_.find(key);
+  if (it != directory_.end() && zone_maps_[it->second.list]) {
+    zone_map_builder_({&key, 1}, *zone_maps_[it->second.list]);
+  }
+}
+
+auto IvfFlatIndex::MayMatch(CentroidId c, const ZoneFilter& filter) const
+    -> bool {
+  if (!saved_zone_maps_[c]) {
+    LoadList(c);
+  }
+  return !zone_maps_[c] || filter(*zone_maps_[c]);
+}
+
+auto IvfFlatIndex::SetSavedZoneMap(CentroidId c, ZoneMap zone_map) -> void {
+  zone_maps_[c] = std::move(zone_map);
+  saved_zone_maps_[c] = true;
+}
+
+auto IvfFlatIndex::FindZoneMap(CentroidId c) const -> const ZoneMap* {
+  if (loader_ && !saved_zone_maps_[c] &&
+      !partition_ready_[GetPartition(c)].load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return zone_maps_[c] ? &*zone_maps_[c] : nullptr;
+}
+
+auto IvfFlatIndex::SetLazyLists(std::vector<size_t> offsets,
+                                PartitionLoader loader) -> void {
+  if (offsets.empty() || offsets.front() != 0 || offsets.back() != nlist_ ||
+      !std::ranges::is_sorted(offsets)) {
+    throw std::invalid_argument("Invalid IVF partition offsets");
+  }
+  saved_partitions_ = offsets;
+  partition_offsets_ = std::move(offsets);
+  directory_.clear();
+  indexed_partitions_.assign(partition_offsets_.size() - 1, false);
+  partition_loaded_ =
+      std::make_unique<std::once_flag[]>(partition_offsets_.size() - 1);
+  partition_ready_ =
+      std::make_unique<std::atomic<bool>[]>(partition_offsets_.size() - 1);
+  loader_ = std::move(loader);
+  zone_maps_.assign(nlist_, std::nullopt);
+  saved_zone_maps_.assign(nlist_, false);
+}
+
+auto IvfFlatIndex::SetSegment(std::shared_ptr<const IvfSegment> segment)
+    -> void {
+  if (segment->GetDim() != dim_ || segment->GetNumLists() != nlist_) {
+    throw std::invalid_argument("Index segment does not match the index");
+  }
+  std::copy_n(segment->GetCentroids(), nlist_ * dim_, centroids_.begin());
+  for (CentroidId c = 0; c < nlist_; ++c) {
+    inverted_lists_[c] = segment->GetList(c);
+  }
+  loader_ = nullptr;
+  segment_ = std::move(segment);
+  saved_partitions_.clear();
+  directory_.clear();
+  indexed_partitions_.assign(1, false);
+  BuildZoneMaps();
+}
+
+auto IvfFlatIndex::GetDirtyLists() const -> std::vector<CentroidId> {
+  std::vector<CentroidId> lists;
+  for (CentroidId c = 0; c < nlist_; ++c) {
+    if (dirty_lists_[c]) {
+      lists.push_back(c);
+    }
+  }
+  return lists;
+}
+
+auto IvfFlatIndex::MarkSaved(std::vector<size_t> partition_offsets) -> void {
+  saved_partitions_ = std::move(partition_offsets);
+  dirty_lists_.assign(nlist_, false);
+}
+
+auto IvfFlatIndex::WillNeed(std::span<const CentroidId> lists) const
+    -> void {
+  if (!segment_) {
+    return;
+  }
+  for (const auto c : lists) {
+    if (inverted_lists_[c].IsView()) {
+      segment_->WillNeed(c);
+    }
+  }
+}
+
+auto IvfFlatIndex::LoadList(CentroidId c) const -> void {
+  if (!loader_) {
+    return;
+  }
+  LoadPartition(GetPartition(c));
+}
+
+auto IvfFlatIndex::LoadPartition(size_t partition) const -> void {
+  if (!loader_) {
+    return;
+  }
+  std::call_once(partition_loaded_[partition], [&]() {
+    const size_t offset = partition_offsets_[partition];
+    auto lists = loader_(partition);
+    if (lists.size() != partition_offsets_[partition + 1] - offset) {
+      throw std::runtime_error("Inconsistent index partition");
+    }
+    std::ranges::move(lists, inverted_lists_.begin() + offset);
+    if (zone_map_builder_) {
+      for (size_t c = offset; c < partition_offsets_[partition + 1]; ++c) {
+        if (!saved_zone_maps_[c]) {
+          BuildZoneMap(c);
+        }
+      }
+    }
+    partition_ready_[partition].store(true, std::memory_order_release);
+  });
+}
+
+auto IvfFlatIndex::LoadAllLists() const -> void {
+  for (size_t p = 0; p < GetNumPartitions(); ++p) {
+    LoadPartition(p);
+  }
+}
+
+auto IvfFlatIterator::Seek() -> void {
+  candidates_ = {};
+  FindProbeLists();
 
 #ifdef DEBUG
   // Print probe clusters
@@ -46,15 +370,90 @@ auto IvfFlatIterator::Seek() -> void {
   std::cout << std::endl;
 #endif
 
-  // Collect candidates from the first probe cluster
-  CollectCandidates();
+  // Collect candidates from the first non-empty probe cluster
+  for (; current_prob_ < probe_lists_.size(); ++current_prob_) {
+    CollectCandidates();
+    if (!candidates_.empty()) {
+      break;
+    }
+  }
+}
+
+auto FindNearestCentroids(std::span<const Float> v, const Float* centroids,
+                          size_t n, size_t dim [[maybe_unused]], size_t nprobe,
+                          Metric metric) -> std::vector<CentroidId> {
+  assert(v.size() == dim);
+  // Calculate distance to each centroid
+  std::vector<Float> centroid_distances(n);
+  GetDistances(metric, v, centroids, n, centroid_distances.data());
+
+  // Find cloest nprobe centroids
+  std::vector<std::pair<Float, CentroidId>> distances(n);
+  for (CentroidId i = 0; i < n; ++i) {
+    distances[i] = {centroid_distances[i], i};
+  }
+  nprobe = std::min(nprobe, n);
+  std::ranges::partial_sort(distances, distances.begin() + nprobe,
+                            std::less<>());
+
+  std::vector<CentroidId> nearest;
+  nearest.reserve(nprobe);
+  for (size_t i = 0; i < nprobe; ++i) {
+    const auto& [_, centroid_idx] = distances[i];
+    nearest.push_back(centroid_idx);
+  }
+  return nearest;
+}
+
+auto AssignCentroids(const Float* data, size_t n, const Float* centroids,
+                     size_t k, size_t dim, Metric metric,
+                     CentroidId* assignments) -> void {
+  constexpr const size_t kBlockSize = 256;
+  std::vector<size_t> blocks((n + kBlockSize - 1) / kBlockSize);
+  std::iota(blocks.begin(), blocks.end(), 0);
+  std::for_each(std::execution::par, blocks.begin(), blocks.end(),
+                [&](size_t block) {
+                  std::vector<Float> distances(k);
+                  const size_t end = std::min(n, (block + 1) * kBlockSize);
+                  for (size_t i = block * kBlockSize; i < end; ++i) {
+                    GetDistances(metric, {data + (i * dim), dim}, centroids, k,
+                                 distances.data());
+                    assignments[i] = std::distance(
+                        distances.begin(), std::ranges::min_element(distances));
+                  }
+                });
+}
+
+auto IvfFlatIterator::FindProbeLists() -> void {
+  if (zone_filter_) {
+    // Lists ruled out by their zone map do not count toward nprobe, the next
+    // nearest ones are probed instead
+    const auto nearest =
+        FindNearestCentroids(query_, index_.GetCentroidData(), index_.nlist_,
+                             index_.dim_, index_.nlist_, index_.metric_);
+    probe_lists_.clear();
+    for (const auto c : nearest) {
+      if (probe_lists_.size() == nprobe_) {
+        break;
+      }
+      if (index_.MayMatch(c, zone_filter_)) {
+        probe_lists_.push_back(c);
+      }
+    }
+  } else {
+    probe_lists_ =
+        FindNearestCentroids(query_, index_.GetCentroidData(), index_.nlist_,
+                             index_.dim_, nprobe_, index_.metric_);
+  }
+  current_prob_ = 0;
+  index_.WillNeed(probe_lists_);
 }
 
 auto IvfFlatIterator::Next() -> void {
   candidates_.pop();
   while (candidates_.empty()) {
     ++current_prob_;
-    if (current_prob_ >= nprobe_) {
+    if (current_prob_ >= probe_lists_.size()) {
       return;
     }
     CollectCandidates();
@@ -69,11 +468,38 @@ auto IvfFlatIterator::CollectCandidates() -> void {
   std::cout << "Collecting candidates from cluster " << current_centroid_idx
             << std::endl;
 #endif
-  for (const auto& [key, vector] :
-       index_.inverted_lists_[current_centroid_idx]) {
-    const auto distance = GetDistanceL2Sq(vector, query_);
-    candidates_.push({key, vector, distance});
+  const auto& list = index_.GetList(current_centroid_idx);
+  if (filter_) {
+    // Only postings passing the filter are scored
+    SelectSlots(list);
+    std::vector<Float> distances;
+    ComputeSlotDistances(list, distances);
+    std::vector<Candidate> candidates;
+    candidates.reserve(slots_.size());
+    for (size_t j = 0; j < slots_.size(); ++j) {
+      candidates.push_back({list.GetKey(slots_[j]),
+                            list.GetVector(slots_[j]).data(), distances[j]});
+    }
+    candidates_ =
+        decltype(candidates_)(std::greater<>(), std::move(candidates));
+    return;
+  }
+
+  // Vectors are contiguous in the list, compute all distances in one pass
+  std::vector<Float> distances(list.Size());
+  GetDistances(index_.metric_, query_, list.GetData(), list.Size(),
+               distances.data());
+
+  std::vector<Candidate> candidates;
+  candidates.reserve(list.Size());
+  for (size_t i = 0; i < list.Size(); ++i) {
+    if (!list.IsDeleted(i)) {
+      candidates.push_back(
+          {list.GetKey(i), list.GetVector(i).data(), distances[i]});
+    }
   }
+  // Heapify in O(n) instead of n pushes
+  candidates_ = decltype(candidates_)(std::greater<>(), std::move(candidates));
 }
 
 auto IvfFlatIterator::Valid() const -> bool {
@@ -84,44 +510,102 @@ auto IvfFlatIterator::GetKey() const noexcept -> Key {
   return candidates_.top().key;
 }
 
-auto IvfFlatIterator::GetVector() const noexcept -> const Vector& {
-  return candidates_.top().vector;
+auto IvfFlatIterator::GetVector() const noexcept -> std::span<const Float> {
+  return {candidates_.top().vector, index_.dim_};
+}
+
+auto IvfFlatIterator::GetDistance() const noexcept -> Float {
+  return candidates_.top().distance;
 }
 
 auto IvfFlatIterator::SeekCluster() -> void {
-  probe_lists_.clear();
-  current_prob_ = 0;
+  FindProbeLists();
+  ComputeClusterDistances();
+}
 
-  // Calculate distance to each centroid
-  std::vector<std::pair<Float, CentroidId>> distances(index_.centroids_.size());
-  std::transform(std::execution::par, index_.centroids_.begin(),
-                 index_.centroids_.end(), distances.begin(),
-                 [&](const auto& centroid) {
-                   return std::make_pair(GetDistanceL2Sq(centroid, query_),
-                                         &centroid - index_.centroids_.data());
-                 });
-
-  // Sort by distance
-  std::ranges::partial_sort(distances, distances.begin() + nprobe_,
-                            std::less<>());
+auto IvfFlatIterator::NextCluster() -> void {
+  ++current_prob_;
+  ComputeClusterDistances();
+}
 
-  // Add nprobe_ centroids to probe_lists_
-  probe_lists_.reserve(nprobe_);
-  for (size_t i = 0; i < nprobe_; ++i) {
-    const auto& [_, centroid_idx] = distances[i];
-    probe_lists_.push_back(centroid_idx);
+auto IvfFlatIterator::HasNextCluster() const -> bool {
+  return current_prob_ < probe_lists_.size();
+}
+
+auto IvfFlatIterator::GetClusterKeys() const -> std::span<const Key> {
+  const auto& list = index_.GetList(probe_lists_[current_prob_]);
+  if (filter_ || list.GetNumDeleted() > 0) {
+    return cluster_keys_;
   }
+  return list.GetKeys();
 }
 
-auto IvfFlatIterator::GetCluster() -> const IvfList& {
-  const auto current_centroid_idx = probe_lists_[current_prob_];
-  return index_.inverted_lists_[current_centroid_idx];
+auto IvfFlatIterator::GetClusterDistances() const -> std::span<const Float> {
+  return cluster_distances_;
 }
 
-auto IvfFlatIterator::NextCluster() -> void { ++current_prob_; }
+auto IvfFlatIterator::ComputeClusterDistances() -> void {
+  if (!HasNextCluster()) {
+    cluster_distances_.clear();
+    return;
+  }
+  const auto& list = index_.GetList(probe_lists_[current_prob_]);
+  if (filter_) {
+    SelectSlots(list);
+    cluster_keys_.clear();
+    for (const auto slot : slots_) {
+      cluster_keys_.push_back(list.GetKey(slot));
+    }
+    ComputeSlotDistances(list, cluster_distances_);
+    return;
+  }
+  cluster_distances_.resize(list.Size());
+  GetDistances(index_.metric_, query_, list.GetData(), list.Size(),
+               cluster_distances_.data());
+  if (list.GetNumDeleted() == 0) {
+    return;
+  }
 
-auto IvfFlatIterator::HasNextCluster() const -> bool {
-  return current_prob_ < probe_lists_.size();
+  // Drop tombstones, keys are copied to stay parallel to the distances
+  cluster_keys_.clear();
+  size_t out = 0;
+  for (size_t i = 0; i < list.Size(); ++i) {
+    if (!list.IsDeleted(i)) {
+      cluster_keys_.push_back(list.GetKey(i));
+      cluster_distances_[out++] = cluster_distances_[i];
+    }
+  }
+  cluster_distances_.resize(out);
+}
+
+auto IvfFlatIterator::SelectSlots(const IvfList& list) -> void {
+  slots_.clear();
+  for (size_t i = 0; i < list.Size(); ++i) {
+    if (!list.IsDeleted(i) && filter_(list.GetKey(i))) {
+      slots_.push_back(i);
+    }
+  }
+}
+
+auto IvfFlatIterator::ComputeSlotDistances(const IvfList& list,
+                                           std::vector<Float>& distances)
+    -> void {
+  distances.resize(slots_.size());
+  // Past a quarter of the list, one batched pass over all of it is cheaper
+  // than scoring the selected vectors one by one
+  if (slots_.size() * 4 >= list.Size()) {
+    list_distances_.resize(list.Size());
+    GetDistances(index_.metric_, query_, list.GetData(), list.Size(),
+                 list_distances_.data());
+    for (size_t j = 0; j < slots_.size(); ++j) {
+      distances[j] = list_distances_[slots_[j]];
+    }
+    return;
+  }
+  for (size_t j = 0; j < slots_.size(); ++j) {
+    distances[j] =
+        rox::GetDistance(index_.metric_, query_, list.GetVector(slots_[j]));
+  }
 }
 
 }  // namespace rox
\ No newline at end of file
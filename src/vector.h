@@ -1,79 +1,497 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <execution>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
 #include <queue>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "roxdb/db.h"
 #include "vector_distance.h"
+#include "zone_map.h"
 
 namespace rox {
 
 using CentroidId = size_t;
-using IvfList = std::vector<std::pair<Key, Vector>>;
+using IndexType = VectorField::IndexType;
 
-inline auto AssignCentroid(const Vector &v,
-                           const std::vector<Vector> &centroids,
-                           const size_t dim) noexcept -> CentroidId {
-  assert(!centroids.empty());
-  assert(v.size() == dim);
-  std::vector<Float> distances(centroids.size());
+class IvfSegment;
 
-  std::transform(std::execution::par, centroids.begin(), centroids.end(),
-                 distances.begin(), [&v](const auto &centroid) {
-                   return GetDistanceL2Sq(centroid, v);
-                 });
+// Allocator returning kAlignment-byte aligned storage, so that vector blocks
+// start on a cache line boundary.
+template <typename T, size_t kAlignment = 64>
+struct AlignedAllocator {
+  using value_type = T;
 
-  return std::distance(distances.begin(), std::ranges::min_element(distances));
-}
+  template <typename U>
+  struct rebind {
+    using other = AlignedAllocator<U, kAlignment>;
+  };
+
+  AlignedAllocator() noexcept = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, kAlignment> &) noexcept {}
+
+  auto allocate(size_t n) -> T * {
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t{kAlignment}));
+  }
 
-class IvfFlatIndex {
+  auto deallocate(T *p, size_t n [[maybe_unused]]) noexcept -> void {
+    ::operator delete(p, std::align_val_t{kAlignment});
+  }
+
+  friend auto operator==(const AlignedAllocator &,
+                         const AlignedAllocator &) noexcept -> bool {
+    return true;
+  }
+};  // struct AlignedAllocator
+
+using AlignedVector = std::vector<Float, AlignedAllocator<Float>>;
+
+// Inverted list stored as structure of arrays: a contiguous n x dim block of
+// vectors plus a parallel array of keys, so a cluster scan is a linear stream.
+class IvfList {
  public:
-  IvfFlatIndex(std::string field_name, const size_t dim, const size_t nlist)
-      : field_name_(std::move(field_name)), dim_(dim), nlist_(nlist) {
-    centroids_.resize(nlist_);
-    inverted_lists_.resize(nlist_);
+  IvfList() = default;
+  explicit IvfList(size_t dim) : dim_(dim) {}
+
+  // Read-only view of n entries owned elsewhere, e.g. by a mapped index
+  // segment. The entries are copied on the first change.
+  static auto View(size_t dim, const Key *keys, const Float *data, size_t n)
+      -> IvfList {
+    IvfList list(dim);
+    list.view_keys_ = {keys, n};
+    list.view_data_ = data;
+    return list;
+  }
+
+  auto Append(Key key, std::span<const Float> v) -> void {
+    assert(v.size() == dim_);
+    Materialize();
+    keys_.push_back(key);
+    data_.insert(data_.end(), v.begin(), v.end());
+  }
+
+  auto SetVector(size_t i, std::span<const Float> v) -> void {
+    assert(v.size() == dim_);
+    Materialize();
+    std::ranges::copy(v, data_.begin() + (i * dim_));
+  }
+
+  // Remove all entries with the given key, preserving order of the others
+  auto Remove(Key key) -> void {
+    Compact();
+    if (IsView()) {
+      if (std::ranges::find(view_keys_, key) == view_keys_.end()) {
+        return;
+      }
+      Materialize();
+    }
+    size_t out = 0;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      if (keys_[i] == key) {
+        continue;
+      }
+      if (out != i) {
+        keys_[out] = keys_[i];
+        std::copy_n(data_.begin() + (i * dim_), dim_,
+                    data_.begin() + (out * dim_));
+      }
+      ++out;
+    }
+    keys_.resize(out);
+    data_.resize(out * dim_);
+  }
+
+  auto Reserve(size_t n) -> void {
+    Materialize();
+    keys_.reserve(n);
+    data_.reserve(n * dim_);
+  }
+
+  // Deleted entries stay in place as tombstones, skipped by scans, until
+  // the list is compacted
+  auto MarkDeleted(size_t i) -> void {
+    if (deleted_.size() < Size()) {
+      deleted_.resize(Size());
+    }
+    if (!deleted_[i]) {
+      deleted_[i] = true;
+      ++num_deleted_;
+    }
+  }
+  auto IsDeleted(size_t i) const noexcept -> bool {
+    return i < deleted_.size() && deleted_[i];
+  }
+  auto GetNumDeleted() const noexcept -> size_t { return num_deleted_; }
+  // Drop deleted entries, preserving order of the others
+  auto Compact() -> void {
+    if (num_deleted_ == 0) {
+      return;
+    }
+    Materialize();
+    size_t out = 0;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      if (IsDeleted(i)) {
+        continue;
+      }
+      if (out != i) {
+        keys_[out] = keys_[i];
+        std::copy_n(data_.begin() + (i * dim_), dim_,
+                    data_.begin() + (out * dim_));
+      }
+      ++out;
+    }
+    keys_.resize(out);
+    data_.resize(out * dim_);
+    deleted_.clear();
+    num_deleted_ = 0;
+  }
+
+  // Including deleted entries
+  auto Size() const noexcept -> size_t { return GetKeys().size(); }
+  auto Empty() const noexcept -> bool { return Size() == 0; }
+  auto GetDim() const noexcept -> size_t { return dim_; }
+  auto IsView() const noexcept -> bool { return view_data_ != nullptr; }
+
+  auto GetKey(size_t i) const noexcept -> Key { return GetKeys()[i]; }
+  auto GetVector(size_t i) const noexcept -> std::span<const Float> {
+    return {GetData() + (i * dim_), dim_};
+  }
+
+  auto GetKeys() const noexcept -> std::span<const Key> {
+    return IsView() ? view_keys_ : std::span<const Key>(keys_);
+  }
+  auto GetData() const noexcept -> const Float * {
+    return IsView() ? view_data_ : data_.data();
+  }
+
+ private:
+  size_t dim_ = 0;
+  std::vector<Key> keys_;
+  AlignedVector data_;  // keys_.size() x dim_, row-major
+  std::span<const Key> view_keys_;
+  const Float *view_data_ = nullptr;
+  std::vector<bool> deleted_;  // may be shorter than the list
+  size_t num_deleted_ = 0;
+
+  auto Materialize() -> void {
+    if (IsView()) {
+      keys_.assign(view_keys_.begin(), view_keys_.end());
+      data_.assign(view_data_, view_data_ + (view_keys_.size() * dim_));
+      view_keys_ = {};
+      view_data_ = nullptr;
+    }
+  }
+};  // class IvfList
+
+// Inverted list of fixed-size codes of quantized vectors: a contiguous
+// n x code_size block of bytes plus a parallel array of keys
+class CodeList {
+ public:
+  CodeList() = default;
+  explicit CodeList(size_t code_size) : code_size_(code_size) {}
+
+  auto Append(Key key, const uint8_t *code) -> void {
+    keys_.push_back(key);
+    codes_.insert(codes_.end(), code, code + code_size_);
+  }
+
+  // Remove all entries with the given key, preserving order of the others
+  auto Remove(Key key) -> void {
+    size_t out = 0;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      if (keys_[i] == key) {
+        continue;
+      }
+      if (out != i) {
+        keys_[out] = keys_[i];
+        std::copy_n(codes_.begin() + (i * code_size_), code_size_,
+                    codes_.begin() + (out * code_size_));
+      }
+      ++out;
+    }
+    keys_.resize(out);
+    codes_.resize(out * code_size_);
   }
 
-  auto Put(const Key &key, const Vector &v) -> void {
-    const CentroidId cluster = AssignCentroid(v, centroids_, dim_);
-    inverted_lists_[cluster].emplace_back(key, v);
+  auto Reserve(size_t n) -> void {
+    keys_.reserve(n);
+    codes_.reserve(n * code_size_);
   }
 
-  auto Delete(const Key &key) -> void {
-    for (auto &list : inverted_lists_) {
-      auto it = std::ranges::remove_if(list, [&key](const auto &pair) {
-                  return pair.first == key;
-                }).begin();
-      list.erase(it, list.end());
+  auto Size() const noexcept -> size_t { return keys_.size(); }
+  auto Empty() const noexcept -> bool { return keys_.empty(); }
+
+  auto GetKey(size_t i) const noexcept -> Key { return keys_[i]; }
+  auto GetCode(size_t i) const noexcept -> const uint8_t * {
+    return codes_.data() + (i * code_size_);
+  }
+
+  auto GetKeys() const noexcept -> const std::vector<Key> & { return keys_; }
+  auto GetCodeSize() const noexcept -> size_t { return code_size_; }
+  auto GetCodes() const noexcept -> const uint8_t * { return codes_.data(); }
+
+ private:
+  size_t code_size_ = 0;
+  std::vector<Key> keys_;
+  // keys_.size() x code_size_, cache line aligned
+  std::vector<uint8_t, AlignedAllocator<uint8_t>> codes_;
+};  // class CodeList
+
+// Keys a search is restricted to
+using KeyFilter = std::function<bool(Key)>;
+// Whether the records summarized by a zone map may pass a search's filters
+using ZoneFilter = std::function<bool(const ZoneMap &)>;
+
+// Iterates over the indexed vectors closest to a query. Results come one at a
+// time (Seek/Next) in approximately ascending distance, or in blocks of keys
+// with their distances (SeekCluster/NextCluster).
+class VectorIterator {
+ public:
+  virtual ~VectorIterator() = default;
+
+  virtual auto Seek() -> void = 0;
+  virtual auto Next() -> void = 0;
+  virtual auto Valid() const -> bool = 0;
+
+  virtual auto GetKey() const noexcept -> Key = 0;
+  virtual auto GetVector() const noexcept -> std::span<const Float> = 0;
+  virtual auto GetDistance() const noexcept -> Float = 0;
+
+  virtual auto SeekCluster() -> void = 0;
+  virtual auto NextCluster() -> void = 0;
+  virtual auto HasNextCluster() const -> bool = 0;
+  virtual auto GetClusterKeys() const -> std::span<const Key> = 0;
+  // Distances from the query, parallel to GetClusterKeys()
+  virtual auto GetClusterDistances() const -> std::span<const Float> = 0;
+
+  // Skip keys rejected by filter before computing their distance. Set before
+  // seeking. Ignored by indexes that cannot skip postings early, so results
+  // must still be checked.
+  virtual auto SetFilter(KeyFilter filter [[maybe_unused]]) -> void {}
+  // Skip clusters whose zone map is rejected by filter, probing further ones
+  // instead. Set before seeking. Ignored by indexes without zone maps.
+  virtual auto SetZoneFilter(ZoneFilter filter [[maybe_unused]]) -> void {}
+};  // class VectorIterator
+
+class VectorIndex {
+ public:
+  virtual ~VectorIndex() = default;
+
+  virtual auto Put(const Key &key, const Vector &v) -> void = 0;
+  virtual auto Delete(const Key &key) -> void = 0;
+  // Replace the vector of a key in the index, old_v being its current vector
+  virtual auto Update(const Key &key,
+                      std::span<const Float> old_v [[maybe_unused]],
+                      const Vector &v) -> void {
+    Delete(key);
+    Put(key, v);
+  }
+  // Delete key from the index, old_v being its current vector
+  virtual auto Remove(const Key &key,
+                      std::span<const Float> old_v [[maybe_unused]]) -> void {
+    Delete(key);
+  }
+  // Delete key if it is in the index, with one of candidates as its vector
+  virtual auto Discard(const Key &key,
+                       std::span<const Vector> candidates [[maybe_unused]])
+      -> void {
+    Delete(key);
+  }
+  // Put keys.size() vectors stored row-major in data, same as Put one by one
+  virtual auto PutBatch(std::span<const Key> keys, const Float *data) -> void {
+    const size_t dim = GetDim();
+    for (size_t i = 0; i < keys.size(); ++i) {
+      Put(keys[i], Vector(data + (i * dim), data + ((i + 1) * dim)));
     }
   }
 
+  // The iterator references query and the index, both must outlive it.
+  // nprobe is the search width, its meaning depends on the index type.
+  virtual auto NewIterator(const Vector &query, size_t nprobe) const
+      -> std::unique_ptr<VectorIterator> = 0;
+
+  virtual auto GetType() const noexcept -> IndexType = 0;
+  virtual auto GetName() const noexcept -> const std::string & = 0;
+  virtual auto GetMetric() const noexcept -> Metric = 0;
+  virtual auto GetDim() const noexcept -> size_t = 0;
+};  // class VectorIndex
+
+// Index of the nearest of n contiguous centroids (row-major, n x dim) to v
+inline auto AssignCentroid(std::span<const Float> v, const Float *centroids,
+                           const size_t n, const size_t dim,
+                           const Metric metric = Metric::kL2) -> CentroidId {
+  assert(n > 0);
+  assert(v.size() == dim);
+  std::vector<Float> distances(n);
+  GetDistances(metric, v, centroids, n, distances.data());
+
+  return std::distance(distances.begin(), std::ranges::min_element(distances));
+}
+
+// Indexes of the nprobe centroids nearest to v, nearest first
+auto FindNearestCentroids(std::span<const Float> v, const Float *centroids,
+                          size_t n, size_t dim, size_t nprobe, Metric metric)
+    -> std::vector<CentroidId>;
+
+// Nearest of k centroids for each of n row-major vectors, written to
+// assignments. Runs in parallel blocks of vectors, each scoring its vectors
+// against the whole centroid matrix with the batched kernels.
+auto AssignCentroids(const Float *data, size_t n, const Float *centroids,
+                     size_t k, size_t dim, Metric metric,
+                     CentroidId *assignments) -> void;
+
+class IvfFlatIndex : public VectorIndex {
+ public:
+  IvfFlatIndex(std::string field_name, const size_t dim, const size_t nlist,
+               const Metric metric = Metric::kL2)
+      : field_name_(std::move(field_name)),
+        dim_(dim),
+        nlist_(nlist),
+        metric_(metric) {
+    centroids_.resize(nlist_ * dim_);
+    inverted_lists_.assign(nlist_, IvfList(dim_));
+    dirty_lists_.assign(nlist_, false);
+    zone_maps_.resize(nlist_);
+    saved_zone_maps_.assign(nlist_, false);
+    indexed_partitions_.assign(1, false);
+  }
+
+  // Writes only load the partitions of the lists they touch. Put replaces
+  // the posting of key if any in a loaded list, in place if it stays in its
+  // list. A key that may be in a list not loaded yet goes through Update,
+  // or Delete first.
+  auto Put(const Key &key, const Vector &v) -> void override;
+  // Looks for the posting of key in the list of old_v first
+  auto Update(const Key &key, std::span<const Float> old_v,
+              const Vector &v) -> void override;
+  auto PutBatch(std::span<const Key> keys, const Float *data) -> void override;
+  // O(1), through the key directory and a tombstone. Loads all lists, unlike
+  // Remove.
+  auto Delete(const Key &key) -> void override;
+  auto Remove(const Key &key, std::span<const Float> old_v) -> void override;
+  // Only looks in the lists of candidates, unlike Remove. A posting put
+  // under other centroids is missed.
+  auto Discard(const Key &key, std::span<const Vector> candidates)
+      -> void override;
+
   auto SetCentroids(const std::vector<Vector> &centroids) -> void {
     assert(centroids.size() == nlist_);
-    centroids_ = centroids;
+    for (size_t i = 0; i < nlist_; ++i) {
+      assert(centroids[i].size() == dim_);
+      std::ranges::copy(centroids[i], centroids_.begin() + (i * dim_));
+    }
+    saved_partitions_.clear();
   }
 
   auto SetInvertedLists(const std::vector<IvfList> &inverted_lists) -> void {
     assert(inverted_lists.size() == nlist_);
     inverted_lists_ = inverted_lists;
+    loader_ = nullptr;
+    saved_partitions_.clear();
+    directory_.clear();
+    indexed_partitions_.assign(1, false);
+    BuildZoneMaps();
+  }
+
+  // Drop the tombstones of all lists
+  auto CompactLists() -> void;
+
+  // Reads the lists of one partition, parallel to the lists it covers
+  using PartitionLoader = std::function<std::vector<IvfList>(size_t)>;
+  // Load inverted lists on first access instead of up front. Partition p
+  // covers lists [offsets[p], offsets[p + 1]), offsets ends with nlist.
+  auto SetLazyLists(std::vector<size_t> offsets, PartitionLoader loader)
+      -> void;
+  // Thread-safe, each partition is loaded once
+  auto LoadList(CentroidId c) const -> void;
+  auto LoadPartition(size_t partition) const -> void;
+  auto LoadAllLists() const -> void;
+  auto GetNumPartitions() const noexcept -> size_t {
+    return loader_ ? partition_offsets_.size() - 1 : 0;
+  }
+
+  // Use the centroids of a mapped segment and scan its lists in place.
+  // Lists are copied out of the segment when changed.
+  auto SetSegment(std::shared_ptr<const IvfSegment> segment) -> void;
+  // Hint that the given lists are about to be scanned
+  auto WillNeed(std::span<const CentroidId> lists) const -> void;
+
+  // Adds the scalars of the records of keys to a zone map
+  using ZoneMapBuilder =
+      std::function<void(std::span<const Key> keys, ZoneMap &zone_map)>;
+  // Keep a zone map of the scalars of each list, built with builder as lists
+  // are loaded and widened as keys are put. Compacting a list rebuilds it.
+  // Lists loaded before the builder is set are never ruled out. Without a
+  // builder, zone maps are dropped.
+  auto SetZoneMapBuilder(ZoneMapBuilder builder) -> void;
+  // Widen the zone map of the list of key, after its scalars changed. v is
+  // the vector of key.
+  auto UpdateZoneMap(Key key, std::span<const Float> v) -> void;
+  // False if the zone map of list c is rejected by filter. Loads the list
+  // unless its zone map was saved with the index.
+  auto MayMatch(CentroidId c, const ZoneFilter &filter) const -> bool;
+  // Zone map of lazy list c read with the centroids, kept by
+  // SetZoneMapBuilder instead of building one when the list is loaded
+  auto SetSavedZoneMap(CentroidId c, ZoneMap zone_map) -> void;
+  // Zone map of list c to save with the index, nullptr if it has none or it
+  // is still being loaded by another thread
+  auto FindZoneMap(CentroidId c) const -> const ZoneMap *;
+
+  // Partition offsets the index was last saved or loaded with, as in
+  // SetLazyLists. Empty if unknown or the centroids changed since, then the
+  // index has to be saved whole.
+  auto GetSavedPartitions() const noexcept -> std::span<const size_t> {
+    return saved_partitions_;
   }
+  // Lists changed since then
+  auto GetDirtyLists() const -> std::vector<CentroidId>;
+  auto MarkSaved(std::vector<size_t> partition_offsets) -> void;
 
-  auto GetCentroids() const noexcept -> const std::vector<Vector> & {
-    return centroids_;
+  auto GetNumCentroids() const noexcept -> size_t { return nlist_; }
+  auto GetCentroid(CentroidId i) const noexcept -> std::span<const Float> {
+    return {centroids_.data() + (i * dim_), dim_};
+  }
+  // Contiguous nlist x dim centroid matrix
+  auto GetCentroidData() const noexcept -> const Float * {
+    return centroids_.data();
   }
 
-  auto GetInvertedLists() const noexcept -> const std::vector<IvfList> & {
+  // Loads all lists
+  auto GetInvertedLists() const -> const std::vector<IvfList> & {
+    LoadAllLists();
     return inverted_lists_;
   }
+  auto GetList(CentroidId c) const -> const IvfList & {
+    LoadList(c);
+    return inverted_lists_[c];
+  }
+
+  auto NewIterator(const Vector &query, size_t nprobe) const
+      -> std::unique_ptr<VectorIterator> override;
 
-  auto GetName() const noexcept -> const std::string & { return field_name_; }
+  auto GetType() const noexcept -> IndexType override {
+    return IndexType::kIvfFlat;
+  }
+  auto GetName() const noexcept -> const std::string & override {
+    return field_name_;
+  }
+  auto GetMetric() const noexcept -> Metric override { return metric_; }
+  auto GetDim() const noexcept -> size_t override { return dim_; }
 
  private:
   friend class IvfFlatIterator;
@@ -81,36 +499,90 @@ class IvfFlatIndex {
   const std::string field_name_;
   const size_t dim_;
   const size_t nlist_;
+  const Metric metric_;
+
+  AlignedVector centroids_;  // nlist_ x dim_, row-major
+  // Filled by loader_ on first access when set
+  mutable std::vector<IvfList> inverted_lists_;
+  PartitionLoader loader_;
+  std::vector<size_t> partition_offsets_;
+  std::unique_ptr<std::once_flag[]> partition_loaded_;
+  // Set once the lists of a partition are in place, read without loading it
+  std::unique_ptr<std::atomic<bool>[]> partition_ready_;
+  // Backs the lists that are views
+  std::shared_ptr<const IvfSegment> segment_;
+  std::vector<size_t> saved_partitions_;
+  std::vector<bool> dirty_lists_;
+  ZoneMapBuilder zone_map_builder_;
+  // Parallel to the lists, std::nullopt until built
+  mutable std::vector<std::optional<ZoneMap>> zone_maps_;
+  // Lists whose zone map was read with the centroids. Loading them leaves
+  // their zone map alone, so it can be read while loading.
+  std::vector<bool> saved_zone_maps_;
+
+  // Where the live posting of each key is, for the keys of the partitions
+  // written to so far. Without a loader all lists are one partition.
+  struct Posting {
+    uint32_t list;
+    uint32_t slot;
+  };  // struct Posting
+  std::unordered_map<Key, Posting> directory_;
+  std::vector<bool> indexed_partitions_;
 
-  std::vector<Vector> centroids_;
-  std::vector<IvfList> inverted_lists_;
+  auto GetPartition(CentroidId c) const -> size_t;
+  // Add the keys of a partition to the directory, loading it
+  auto IndexPartition(size_t partition) -> void;
+  // Of all partitions
+  auto BuildDirectory() -> void;
+  // Add the posting of key to the directory, looking in the list of v, its
+  // vector, before all lists
+  auto LocateKey(Key key, std::span<const Float> v) -> void;
+  auto Append(CentroidId c, Key key, std::span<const Float> v) -> void;
+  // Put key in list c, overwriting its vector if the key is already there
+  auto Upsert(CentroidId c, Key key, std::span<const Float> v) -> void;
+  // Tombstone the posting of key, compacting its list once a large enough
+  // share of it is deleted
+  auto Erase(Key key) -> void;
+  auto CompactList(CentroidId c) -> void;
+  // Of the loaded lists, or of list c
+  auto BuildZoneMaps() -> void;
+  auto BuildZoneMap(CentroidId c) const -> void;
 };  // class IvfFlatIndex
 
-class IvfFlatIterator {
+class IvfFlatIterator : public VectorIterator {
  public:
   IvfFlatIterator(const IvfFlatIndex &index, const Vector &query, size_t nprobe,
                   size_t rm_window_size [[maybe_unused]],
                   size_t rm_neighbor_size [[maybe_unused]])
       : index_(index), query_(query), nprobe_((nprobe)) {}
 
-  auto Seek() -> void;
+  auto Seek() -> void override;
 
-  auto Next() -> void;
+  auto Next() -> void override;
 
-  auto Valid() const -> bool;
+  auto Valid() const -> bool override;
 
-  auto GetKey() const noexcept -> Key;
-  auto GetVector() const noexcept -> const Vector &;
+  auto GetKey() const noexcept -> Key override;
+  auto GetVector() const noexcept -> std::span<const Float> override;
+  auto GetDistance() const noexcept -> Float override;
 
-  auto SeekCluster() -> void;
-  auto NextCluster() -> void;
-  auto GetCluster() -> const IvfList &;
-  auto HasNextCluster() const -> bool;
+  auto SeekCluster() -> void override;
+  auto NextCluster() -> void override;
+  auto HasNextCluster() const -> bool override;
+  auto GetClusterKeys() const -> std::span<const Key> override;
+  auto GetClusterDistances() const -> std::span<const Float> override;
+
+  auto SetFilter(KeyFilter filter) -> void override {
+    filter_ = std::move(filter);
+  }
+  auto SetZoneFilter(ZoneFilter filter) -> void override {
+    zone_filter_ = std::move(filter);
+  }
 
  private:
   struct Candidate {
     Key key;
-    Vector vector;
+    const Float *vector;  // points into the inverted list block
     Float distance;
 
     auto operator<=>(const Candidate &other) const {
@@ -125,8 +597,22 @@ class IvfFlatIterator {
   size_t current_prob_ = 0;              // current probe cluster index
   std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>>
       candidates_;  // candidates in the current probe cluster (min heap)
+  std::vector<Float> cluster_distances_;  // for the cluster API
+  // Live keys of a list with tombstones or a filter
+  std::vector<Key> cluster_keys_;
+  KeyFilter filter_;
+  ZoneFilter zone_filter_;
+  std::vector<uint32_t> slots_;  // postings of the list passing filter_
+  std::vector<Float> list_distances_;
 
   auto CollectCandidates() -> void;
+  auto ComputeClusterDistances() -> void;
+  auto FindProbeLists() -> void;
+  // Fill slots_ with the live postings of list accepted by filter_
+  auto SelectSlots(const IvfList &list) -> void;
+  // Distances of the postings in slots_, parallel to them
+  auto ComputeSlotDistances(const IvfList &list, std::vector<Float> &distances)
+      -> void;
 };  // class IvfFlatIterator
 
 }  // namespace rox
\ No newline at end of file
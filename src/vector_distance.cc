@@ -0,0 +1,30 @@
+#include "vector_distance.h"
+
+namespace rox {
+
+namespace {
+
+auto SelectDistanceKernels() noexcept -> const DistanceKernels & {
+  __builtin_cpu_init();
+#ifdef ROX_WITH_AVX512
+  if (__builtin_cpu_supports("avx512f")) {
+    return kAvx512FDistanceKernels;
+  }
+#endif
+#ifdef ROX_WITH_AVX2
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+      __builtin_cpu_supports("f16c")) {
+    return kAvx2DistanceKernels;
+  }
+#endif
+  return kScalarDistanceKernels;
+}
+
+}  // namespace
+
+auto GetDistanceKernels() noexcept -> const DistanceKernels & {
+  static const DistanceKernels &kernels = SelectDistanceKernels();
+  return kernels;
+}
+
+}  // namespace rox
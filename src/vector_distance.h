@@ -1,86 +1,235 @@
 #pragma once
 
 #include <cassert>
-#include <numeric>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 
 #include "roxdb/db.h"
 
-#if defined(__AVX512F__) || defined(__AVX2__)
-#include <immintrin.h>
+namespace rox {
+
+using Metric = VectorField::Metric;
+
+// Distance kernels built for one instruction set. The best table supported
+// by the host CPU is picked once at startup, see GetDistanceKernels().
+struct DistanceKernels {
+  using DistanceFn = auto (*)(std::span<const Float> a,
+                              std::span<const Float> b) -> Float;
+  using BatchDistanceFn = auto (*)(std::span<const Float> query,
+                                   const Float *vectors, size_t n,
+                                   Float *distances) -> void;
+  // Batched kernels over n contiguous quantized codes of query.size()
+  // elements, decoded on the fly. SQ8 element j decodes to
+  // vmin[j] + code * scale[j], FP16 elements are IEEE half floats.
+  using Sq8BatchDistanceFn = auto (*)(std::span<const Float> query,
+                                      const uint8_t *codes, size_t n,
+                                      const Float *vmin, const Float *scale,
+                                      Float *distances) -> void;
+  using Fp16BatchDistanceFn = auto (*)(std::span<const Float> query,
+                                       const uint16_t *codes, size_t n,
+                                       Float *distances) -> void;
+
+  const char *name;
+  DistanceFn l2_sq;
+  BatchDistanceFn l2_sq_batch;
+  DistanceFn dot;
+  BatchDistanceFn dot_batch;
+  DistanceFn l1;
+  BatchDistanceFn l1_batch;
+  Sq8BatchDistanceFn sq8_l2_sq_batch;
+  Sq8BatchDistanceFn sq8_dot_batch;
+  Sq8BatchDistanceFn sq8_l1_batch;
+  Fp16BatchDistanceFn fp16_l2_sq_batch;
+  Fp16BatchDistanceFn fp16_dot_batch;
+  Fp16BatchDistanceFn fp16_l1_batch;
+};  // struct DistanceKernels
+
+extern const DistanceKernels kScalarDistanceKernels;
+#ifdef ROX_WITH_AVX2
+extern const DistanceKernels kAvx2DistanceKernels;
+#endif
+#ifdef ROX_WITH_AVX512
+extern const DistanceKernels kAvx512FDistanceKernels;
 #endif
 
-namespace rox {
+// Kernels for the host CPU, selected via cpuid on first use
+auto GetDistanceKernels() noexcept -> const DistanceKernels &;
 
-#ifdef __AVX512F__
-inline auto GetDistanceL2SqAvx512F(const Vector &a, const Vector &b) -> Float {
-  constexpr const size_t kFloatsPerAvx512F = 16;
-  const size_t rounds = a.size() / kFloatsPerAvx512F;
-  const size_t remainder = a.size() % kFloatsPerAvx512F;
-
-  __m512 sum = _mm512_setzero_ps();
-  for (size_t i = 0; i < rounds; ++i) {
-    if (i + 2 < rounds) {
-      _mm_prefetch(reinterpret_cast<const char *>(
-                       a.data() + ((i + 2) * kFloatsPerAvx512F)),
-                   _MM_HINT_T0);
-      _mm_prefetch(reinterpret_cast<const char *>(
-                       b.data() + ((i + 2) * kFloatsPerAvx512F)),
-                   _MM_HINT_T0);
-    }
-    const __m512 a_vec = _mm512_loadu_ps(a.data() + (i * kFloatsPerAvx512F));
-    const __m512 b_vec = _mm512_loadu_ps(b.data() + (i * kFloatsPerAvx512F));
-    const __m512 diff = _mm512_sub_ps(a_vec, b_vec);
-    sum = _mm512_fmadd_ps(diff, diff, sum);
-  }
+inline auto GetDistanceL2Sq(std::span<const Float> a, std::span<const Float> b)
+    -> Float {
+  assert(a.size() == b.size());
+  return GetDistanceKernels().l2_sq(a, b);
+}
 
-  Float result = _mm512_reduce_add_ps(sum);
+// Squared L2 distances from query to each of n contiguous vectors of
+// query.size() floats, written to distances[0..n).
+inline auto GetDistancesL2Sq(std::span<const Float> query,
+                             const Float *vectors, size_t n,
+                             Float *distances) -> void {
+  GetDistanceKernels().l2_sq_batch(query, vectors, n, distances);
+}
 
-  if (remainder > 0) {
-    const size_t start_idx = rounds * kFloatsPerAvx512F;
+inline auto GetDistanceL1(std::span<const Float> a,
+                          std::span<const Float> b) noexcept -> Float {
+  assert(a.size() == b.size());
+  return GetDistanceKernels().l1(a, b);
+}
 
-    // Create mask for remaining elements
-    __mmask16 mask = _cvtu32_mask16((1U << remainder) - 1);
+inline auto GetDotProduct(std::span<const Float> a, std::span<const Float> b)
+    -> Float {
+  assert(a.size() == b.size());
+  return GetDistanceKernels().dot(a, b);
+}
+
+// Distance under the given metric, smaller is closer. Inner product is
+// turned into -<a, b>, cosine into 1 - <a, b> over pre-normalized vectors.
+inline auto GetDistance(Metric metric, std::span<const Float> a,
+                        std::span<const Float> b) -> Float {
+  assert(a.size() == b.size());
+  const auto &kernels = GetDistanceKernels();
+  switch (metric) {
+    case Metric::kL2:
+      return kernels.l2_sq(a, b);
+    case Metric::kInnerProduct:
+      return -kernels.dot(a, b);
+    case Metric::kCosine:
+      return 1.0F - kernels.dot(a, b);
+    case Metric::kL1:
+      return kernels.l1(a, b);
+  }
+  return kernels.l2_sq(a, b);
+}
+
+// Batched GetDistance over n contiguous vectors of query.size() floats
+inline auto GetDistances(Metric metric, std::span<const Float> query,
+                         const Float *vectors, size_t n, Float *distances)
+    -> void {
+  const auto &kernels = GetDistanceKernels();
+  switch (metric) {
+    case Metric::kL2:
+      kernels.l2_sq_batch(query, vectors, n, distances);
+      return;
+    case Metric::kInnerProduct:
+      kernels.dot_batch(query, vectors, n, distances);
+      for (size_t i = 0; i < n; ++i) {
+        distances[i] = -distances[i];
+      }
+      return;
+    case Metric::kCosine:
+      kernels.dot_batch(query, vectors, n, distances);
+      for (size_t i = 0; i < n; ++i) {
+        distances[i] = 1.0F - distances[i];
+      }
+      return;
+    case Metric::kL1:
+      kernels.l1_batch(query, vectors, n, distances);
+      return;
+  }
+}
 
-    // Masked load for boundary-safe operations
-    __m512 a_rem = _mm512_maskz_loadu_ps(mask, a.data() + start_idx);
-    __m512 b_rem = _mm512_maskz_loadu_ps(mask, b.data() + start_idx);
-    __m512 diff_rem = _mm512_sub_ps(a_rem, b_rem);
+// Turn raw batched kernel outputs into metric distances, see GetDistance()
+inline auto FinishDistances(Metric metric, size_t n, Float *distances)
+    -> void {
+  if (metric == Metric::kInnerProduct) {
+    for (size_t i = 0; i < n; ++i) {
+      distances[i] = -distances[i];
+    }
+  } else if (metric == Metric::kCosine) {
+    for (size_t i = 0; i < n; ++i) {
+      distances[i] = 1.0F - distances[i];
+    }
+  }
+}
 
-    // Add squared differences for remainder using masked reduction
-    result +=
-        _mm512_mask_reduce_add_ps(mask, _mm512_mul_ps(diff_rem, diff_rem));
+// Batched GetDistance over n contiguous SQ8 codes
+inline auto GetDistancesSq8(Metric metric, std::span<const Float> query,
+                            const uint8_t *codes, size_t n, const Float *vmin,
+                            const Float *scale, Float *distances) -> void {
+  const auto &kernels = GetDistanceKernels();
+  switch (metric) {
+    case Metric::kL2:
+      kernels.sq8_l2_sq_batch(query, codes, n, vmin, scale, distances);
+      break;
+    case Metric::kInnerProduct:
+    case Metric::kCosine:
+      kernels.sq8_dot_batch(query, codes, n, vmin, scale, distances);
+      break;
+    case Metric::kL1:
+      kernels.sq8_l1_batch(query, codes, n, vmin, scale, distances);
+      break;
   }
+  FinishDistances(metric, n, distances);
+}
 
-  return result;
+// Batched GetDistance over n contiguous FP16 codes
+inline auto GetDistancesFp16(Metric metric, std::span<const Float> query,
+                             const uint16_t *codes, size_t n,
+                             Float *distances) -> void {
+  const auto &kernels = GetDistanceKernels();
+  switch (metric) {
+    case Metric::kL2:
+      kernels.fp16_l2_sq_batch(query, codes, n, distances);
+      break;
+    case Metric::kInnerProduct:
+    case Metric::kCosine:
+      kernels.fp16_dot_batch(query, codes, n, distances);
+      break;
+    case Metric::kL1:
+      kernels.fp16_l1_batch(query, codes, n, distances);
+      break;
+  }
+  FinishDistances(metric, n, distances);
 }
-#endif
 
-inline auto GetDistanceL2Sq(const Vector &a, const Vector &b) -> Float {
-  assert(a.size() == b.size());
-#ifdef __AVX512F__
-  return GetDistanceL2SqAvx512F(a, b);
-#else
-  return std::transform_reduce(
-      a.begin(), a.end(), b.begin(), 0.0, std::plus<>(),
-      [](Float x, Float y) { return (x - y) * (x - y); });
-#endif
+// IEEE half to single precision conversion, exact
+inline auto HalfToFloat(uint16_t h) noexcept -> Float {
+  const uint32_t sign = static_cast<uint32_t>(h & 0x8000U) << 16;
+  const uint32_t exponent = (h >> 10) & 0x1FU;
+  const uint32_t mantissa = h & 0x3FFU;
+  if (exponent == 0) {
+    // Zero or subnormal: mantissa * 2^-24
+    const Float magnitude = std::ldexp(static_cast<Float>(mantissa), -24);
+    return sign != 0 ? -magnitude : magnitude;
+  }
+  if (exponent == 0x1F) {  // Inf or NaN
+    return std::bit_cast<Float>(sign | 0x7F800000U | (mantissa << 13));
+  }
+  return std::bit_cast<Float>(sign | ((exponent + 112) << 23) |
+                              (mantissa << 13));
 }
 
-// #ifdef __AVX512F__
-// inline auto GetDistanceL1Avx512F(const Vector &a, const Vector &b) -> Float {
-//   return 0.0;
-// }
-// #endif
+// Single to IEEE half precision conversion, rounding to nearest even
+inline auto FloatToHalf(Float f) noexcept -> uint16_t {
+  const uint32_t bits = std::bit_cast<uint32_t>(f);
+  const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000U);
+  const uint32_t abs = bits & 0x7FFFFFFFU;
+  if (abs >= 0x7F800000U) {  // Inf or NaN
+    return sign | 0x7C00U | (abs > 0x7F800000U ? 0x200U : 0U);
+  }
+  if (abs >= 0x477FF000U) {  // Rounds to a value above the half range
+    return sign | 0x7C00U;
+  }
+  if (abs < 0x38800000U) {  // Subnormal half, round mantissa * 2^24
+    const Float magnitude = std::bit_cast<Float>(abs);
+    return sign | static_cast<uint16_t>(std::nearbyint(magnitude * 0x1p24F));
+  }
+  // Rebias the exponent and round the 13 dropped mantissa bits
+  const uint32_t rebased = abs - (112U << 23);
+  const uint32_t rounded = rebased + 0xFFFU + ((rebased >> 13) & 1U);
+  return sign | static_cast<uint16_t>(rounded >> 13);
+}
 
-inline auto GetDistanceL1(const Vector &a, const Vector &b) noexcept -> Float {
-  assert(a.size() == b.size());
-  // #ifdef __AVX512F__
-  //   return GetDistanceL1Avx512F(a, b);
-  // #else
-  return std::transform_reduce(
-      a.begin(), a.end(), b.begin(), 0.0, std::plus<>(),
-      [](Float x, Float y) { return std::abs(x - y); });
-  // #endif
+// Scale v to unit L2 norm in place, zero vectors are left untouched
+inline auto NormalizeVector(std::span<Float> v) -> void {
+  const Float norm = std::sqrt(GetDotProduct(v, v));
+  if (norm > 0.0F) {
+    for (auto &x : v) {
+      x /= norm;
+    }
+  }
 }
 
-}  // namespace rox
\ No newline at end of file
+}  // namespace rox
@@ -0,0 +1,199 @@
+#ifdef ROX_WITH_AVX2
+
+#include <immintrin.h>
+
+#include <cmath>
+
+#include "vector_distance.h"
+
+namespace rox {
+
+namespace {
+
+constexpr const size_t kFloatsPerAvx2 = 8;
+
+struct L2SqOp {
+  static auto Apply(__m256 acc, __m256 a, __m256 b) -> __m256 {
+    const __m256 diff = _mm256_sub_ps(a, b);
+    return _mm256_fmadd_ps(diff, diff, acc);
+  }
+  static auto Apply(Float acc, Float a, Float b) -> Float {
+    return acc + ((a - b) * (a - b));
+  }
+};
+
+struct DotOp {
+  static auto Apply(__m256 acc, __m256 a, __m256 b) -> __m256 {
+    return _mm256_fmadd_ps(a, b, acc);
+  }
+  static auto Apply(Float acc, Float a, Float b) -> Float {
+    return acc + (a * b);
+  }
+};
+
+struct L1Op {
+  static auto Apply(__m256 acc, __m256 a, __m256 b) -> __m256 {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    return _mm256_add_ps(acc, _mm256_and_ps(_mm256_sub_ps(a, b), abs_mask));
+  }
+  static auto Apply(Float acc, Float a, Float b) -> Float {
+    return acc + std::abs(a - b);
+  }
+};
+
+inline auto ReduceAddAvx2(__m256 s) -> Float {
+  __m128 sum =
+      _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+  sum = _mm_hadd_ps(sum, sum);
+  sum = _mm_hadd_ps(sum, sum);
+  return _mm_cvtss_f32(sum);
+}
+
+// Horizontal sums of four accumulators, returned as one 4-lane vector
+inline auto ReduceAdd4Avx2(__m256 s0, __m256 s1, __m256 s2, __m256 s3)
+    -> __m128 {
+  const __m256 s01 = _mm256_hadd_ps(s0, s1);
+  const __m256 s23 = _mm256_hadd_ps(s2, s3);
+  const __m256 s0123 = _mm256_hadd_ps(s01, s23);
+  return _mm_add_ps(_mm256_castps256_ps128(s0123),
+                    _mm256_extractf128_ps(s0123, 1));
+}
+
+template <typename Op>
+auto GetDistanceAvx2(std::span<const Float> a, std::span<const Float> b)
+    -> Float {
+  const size_t rounds = a.size() / kFloatsPerAvx2;
+
+  __m256 sum = _mm256_setzero_ps();
+  for (size_t i = 0; i < rounds; ++i) {
+    const __m256 a_vec = _mm256_loadu_ps(a.data() + (i * kFloatsPerAvx2));
+    const __m256 b_vec = _mm256_loadu_ps(b.data() + (i * kFloatsPerAvx2));
+    sum = Op::Apply(sum, a_vec, b_vec);
+  }
+
+  Float result = ReduceAddAvx2(sum);
+  for (size_t i = rounds * kFloatsPerAvx2; i < a.size(); ++i) {
+    result = Op::Apply(result, a[i], b[i]);
+  }
+  return result;
+}
+
+// Four vectors per pass, see GetDistancesAvx512F
+template <typename Op>
+auto GetDistancesAvx2(std::span<const Float> query, const Float *vectors,
+                      size_t n, Float *distances) -> void {
+  constexpr const size_t kVectorsPerPass = 4;
+  const size_t dim = query.size();
+  const size_t rounds = dim / kFloatsPerAvx2;
+  const Float *q = query.data();
+
+  size_t i = 0;
+  for (; i + kVectorsPerPass <= n; i += kVectorsPerPass) {
+    const Float *v0 = vectors + (i * dim);
+    const Float *v1 = v0 + dim;
+    const Float *v2 = v1 + dim;
+    const Float *v3 = v2 + dim;
+
+    __m256 s0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps();
+    __m256 s3 = _mm256_setzero_ps();
+    for (size_t r = 0; r < rounds; ++r) {
+      const size_t off = r * kFloatsPerAvx2;
+      const __m256 q_vec = _mm256_loadu_ps(q + off);
+      s0 = Op::Apply(s0, _mm256_loadu_ps(v0 + off), q_vec);
+      s1 = Op::Apply(s1, _mm256_loadu_ps(v1 + off), q_vec);
+      s2 = Op::Apply(s2, _mm256_loadu_ps(v2 + off), q_vec);
+      s3 = Op::Apply(s3, _mm256_loadu_ps(v3 + off), q_vec);
+    }
+    _mm_storeu_ps(distances + i, ReduceAdd4Avx2(s0, s1, s2, s3));
+
+    for (size_t j = rounds * kFloatsPerAvx2; j < dim; ++j) {
+      distances[i] = Op::Apply(distances[i], v0[j], q[j]);
+      distances[i + 1] = Op::Apply(distances[i + 1], v1[j], q[j]);
+      distances[i + 2] = Op::Apply(distances[i + 2], v2[j], q[j]);
+      distances[i + 3] = Op::Apply(distances[i + 3], v3[j], q[j]);
+    }
+  }
+
+  // Tail vectors
+  for (; i < n; ++i) {
+    distances[i] = GetDistanceAvx2<Op>({vectors + (i * dim), dim}, query);
+  }
+}
+
+// Codes are decoded into float lanes and fed to the same ops as float
+// vectors. Elements past the last full round go through the scalar ops.
+template <typename Op>
+auto GetDistancesSq8Avx2(std::span<const Float> query, const uint8_t *codes,
+                         size_t n, const Float *vmin, const Float *scale,
+                         Float *distances) -> void {
+  const size_t dim = query.size();
+  const size_t rounds = dim / kFloatsPerAvx2;
+  const Float *q = query.data();
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t *code = codes + (i * dim);
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t r = 0; r < rounds; ++r) {
+      const size_t off = r * kFloatsPerAvx2;
+      const __m128i bytes =
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(code + off));
+      const __m256 decoded = _mm256_fmadd_ps(
+          _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)),
+          _mm256_loadu_ps(scale + off), _mm256_loadu_ps(vmin + off));
+      sum = Op::Apply(sum, _mm256_loadu_ps(q + off), decoded);
+    }
+    Float result = ReduceAddAvx2(sum);
+    for (size_t j = rounds * kFloatsPerAvx2; j < dim; ++j) {
+      result = Op::Apply(result, q[j], vmin[j] + (code[j] * scale[j]));
+    }
+    distances[i] = result;
+  }
+}
+
+template <typename Op>
+auto GetDistancesFp16Avx2(std::span<const Float> query, const uint16_t *codes,
+                          size_t n, Float *distances) -> void {
+  const size_t dim = query.size();
+  const size_t rounds = dim / kFloatsPerAvx2;
+  const Float *q = query.data();
+  for (size_t i = 0; i < n; ++i) {
+    const uint16_t *code = codes + (i * dim);
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t r = 0; r < rounds; ++r) {
+      const size_t off = r * kFloatsPerAvx2;
+      const __m256 decoded = _mm256_cvtph_ps(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(code + off)));
+      sum = Op::Apply(sum, _mm256_loadu_ps(q + off), decoded);
+    }
+    Float result = ReduceAddAvx2(sum);
+    // Not the inline HalfToFloat, whose copy emitted here with F16C enabled
+    // could be picked by the linker for the portable callers
+    for (size_t j = rounds * kFloatsPerAvx2; j < dim; ++j) {
+      result = Op::Apply(result, q[j], _cvtsh_ss(code[j]));
+    }
+    distances[i] = result;
+  }
+}
+
+}  // namespace
+
+const DistanceKernels kAvx2DistanceKernels = {
+    .name = "avx2",
+    .l2_sq = GetDistanceAvx2<L2SqOp>,
+    .l2_sq_batch = GetDistancesAvx2<L2SqOp>,
+    .dot = GetDistanceAvx2<DotOp>,
+    .dot_batch = GetDistancesAvx2<DotOp>,
+    .l1 = GetDistanceAvx2<L1Op>,
+    .l1_batch = GetDistancesAvx2<L1Op>,
+    .sq8_l2_sq_batch = GetDistancesSq8Avx2<L2SqOp>,
+    .sq8_dot_batch = GetDistancesSq8Avx2<DotOp>,
+    .sq8_l1_batch = GetDistancesSq8Avx2<L1Op>,
+    .fp16_l2_sq_batch = GetDistancesFp16Avx2<L2SqOp>,
+    .fp16_dot_batch = GetDistancesFp16Avx2<DotOp>,
+    .fp16_l1_batch = GetDistancesFp16Avx2<L1Op>,
+};
+
+}  // namespace rox
+
+#endif  // ROX_WITH_AVX2
@@ -0,0 +1,238 @@
+#ifdef ROX_WITH_AVX512
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+#include "vector_distance.h"
+
+namespace rox {
+
+namespace {
+
+constexpr const size_t kFloatsPerAvx512F = 16;
+
+// Lanes masked off in the remainder are zero in both operands, which
+// contributes nothing for any of the ops below.
+struct L2SqOp {
+  static auto Apply(__m512 acc, __m512 a, __m512 b) -> __m512 {
+    const __m512 diff = _mm512_sub_ps(a, b);
+    return _mm512_fmadd_ps(diff, diff, acc);
+  }
+};
+
+struct DotOp {
+  static auto Apply(__m512 acc, __m512 a, __m512 b) -> __m512 {
+    return _mm512_fmadd_ps(a, b, acc);
+  }
+};
+
+struct L1Op {
+  static auto Apply(__m512 acc, __m512 a, __m512 b) -> __m512 {
+    return _mm512_add_ps(acc, _mm512_abs_ps(_mm512_sub_ps(a, b)));
+  }
+};
+
+template <typename Op>
+auto GetDistanceAvx512F(std::span<const Float> a, std::span<const Float> b)
+    -> Float {
+  const size_t rounds = a.size() / kFloatsPerAvx512F;
+  const size_t remainder = a.size() % kFloatsPerAvx512F;
+
+  __m512 sum = _mm512_setzero_ps();
+  for (size_t i = 0; i < rounds; ++i) {
+    if (i + 2 < rounds) {
+      _mm_prefetch(reinterpret_cast<const char *>(
+                       a.data() + ((i + 2) * kFloatsPerAvx512F)),
+                   _MM_HINT_T0);
+      _mm_prefetch(reinterpret_cast<const char *>(
+                       b.data() + ((i + 2) * kFloatsPerAvx512F)),
+                   _MM_HINT_T0);
+    }
+    const __m512 a_vec = _mm512_loadu_ps(a.data() + (i * kFloatsPerAvx512F));
+    const __m512 b_vec = _mm512_loadu_ps(b.data() + (i * kFloatsPerAvx512F));
+    sum = Op::Apply(sum, a_vec, b_vec);
+  }
+
+  if (remainder > 0) {
+    const size_t start_idx = rounds * kFloatsPerAvx512F;
+
+    // Create mask for remaining elements
+    const __mmask16 mask = _cvtu32_mask16((1U << remainder) - 1);
+
+    // Masked load for boundary-safe operations
+    const __m512 a_rem = _mm512_maskz_loadu_ps(mask, a.data() + start_idx);
+    const __m512 b_rem = _mm512_maskz_loadu_ps(mask, b.data() + start_idx);
+    sum = Op::Apply(sum, a_rem, b_rem);
+  }
+
+  return _mm512_reduce_add_ps(sum);
+}
+
+// Horizontal sums of four accumulators, returned as one 4-lane vector
+inline auto ReduceAdd4Avx512F(__m512 s0, __m512 s1, __m512 s2, __m512 s3)
+    -> __m128 {
+  auto fold = [](__m512 s) {
+    return _mm256_add_ps(_mm512_castps512_ps256(s),
+                         _mm256_castpd_ps(_mm512_extractf64x4_pd(
+                             _mm512_castps_pd(s), 1)));
+  };
+  // [s0 s0 s1 s1 | s0 s0 s1 s1] and [s2 s2 s3 s3 | s2 s2 s3 s3]
+  const __m256 s01 = _mm256_hadd_ps(fold(s0), fold(s1));
+  const __m256 s23 = _mm256_hadd_ps(fold(s2), fold(s3));
+  // [s0 s1 s2 s3 | s0 s1 s2 s3]
+  const __m256 s0123 = _mm256_hadd_ps(s01, s23);
+  return _mm_add_ps(_mm256_castps256_ps128(s0123),
+                    _mm256_extractf128_ps(s0123, 1));
+}
+
+// Distances from one query to n contiguous vectors (row-major, n x dim).
+// Four vectors are processed per pass so every query chunk is loaded once
+// per pass, and the horizontal reductions are batched at the end.
+template <typename Op>
+auto GetDistancesAvx512F(std::span<const Float> query, const Float *vectors,
+                         size_t n, Float *distances) -> void {
+  constexpr const size_t kVectorsPerPass = 4;
+  const size_t dim = query.size();
+  const size_t rounds = dim / kFloatsPerAvx512F;
+  const size_t remainder = dim % kFloatsPerAvx512F;
+  const __mmask16 mask = _cvtu32_mask16((1U << remainder) - 1);
+  const Float *q = query.data();
+
+  size_t i = 0;
+  for (; i + kVectorsPerPass <= n; i += kVectorsPerPass) {
+    const Float *v0 = vectors + (i * dim);
+    const Float *v1 = v0 + dim;
+    const Float *v2 = v1 + dim;
+    const Float *v3 = v2 + dim;
+
+    __m512 s0 = _mm512_setzero_ps();
+    __m512 s1 = _mm512_setzero_ps();
+    __m512 s2 = _mm512_setzero_ps();
+    __m512 s3 = _mm512_setzero_ps();
+    for (size_t r = 0; r < rounds; ++r) {
+      const size_t off = r * kFloatsPerAvx512F;
+      const __m512 q_vec = _mm512_loadu_ps(q + off);
+      s0 = Op::Apply(s0, _mm512_loadu_ps(v0 + off), q_vec);
+      s1 = Op::Apply(s1, _mm512_loadu_ps(v1 + off), q_vec);
+      s2 = Op::Apply(s2, _mm512_loadu_ps(v2 + off), q_vec);
+      s3 = Op::Apply(s3, _mm512_loadu_ps(v3 + off), q_vec);
+    }
+    if (remainder > 0) {
+      const size_t off = rounds * kFloatsPerAvx512F;
+      const __m512 q_vec = _mm512_maskz_loadu_ps(mask, q + off);
+      s0 = Op::Apply(s0, _mm512_maskz_loadu_ps(mask, v0 + off), q_vec);
+      s1 = Op::Apply(s1, _mm512_maskz_loadu_ps(mask, v1 + off), q_vec);
+      s2 = Op::Apply(s2, _mm512_maskz_loadu_ps(mask, v2 + off), q_vec);
+      s3 = Op::Apply(s3, _mm512_maskz_loadu_ps(mask, v3 + off), q_vec);
+    }
+    _mm_storeu_ps(distances + i, ReduceAdd4Avx512F(s0, s1, s2, s3));
+  }
+
+  // Tail vectors
+  for (; i < n; ++i) {
+    distances[i] = GetDistanceAvx512F<Op>({vectors + (i * dim), dim}, query);
+  }
+}
+
+// Codes are decoded into float lanes and fed to the same ops as float
+// vectors. The remainder is copied into a zeroed buffer, as masked byte and
+// word loads need AVX512BW; zero lanes are masked off of the query.
+template <typename Op>
+auto GetDistancesSq8Avx512F(std::span<const Float> query, const uint8_t *codes,
+                            size_t n, const Float *vmin, const Float *scale,
+                            Float *distances) -> void {
+  const size_t dim = query.size();
+  const size_t rounds = dim / kFloatsPerAvx512F;
+  const size_t remainder = dim % kFloatsPerAvx512F;
+  const __mmask16 mask = _cvtu32_mask16((1U << remainder) - 1);
+  const Float *q = query.data();
+  const size_t tail = rounds * kFloatsPerAvx512F;
+
+  auto decode = [&](const uint8_t *bytes, size_t off) {
+    const __m128i packed =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+    return _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(packed)),
+                           _mm512_maskz_loadu_ps(mask, scale + off),
+                           _mm512_maskz_loadu_ps(mask, vmin + off));
+  };
+
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t *code = codes + (i * dim);
+    if (i + 1 < n) {
+      _mm_prefetch(reinterpret_cast<const char *>(code + dim), _MM_HINT_T0);
+    }
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t r = 0; r < rounds; ++r) {
+      const size_t off = r * kFloatsPerAvx512F;
+      const __m512 decoded = _mm512_fmadd_ps(
+          _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(
+              reinterpret_cast<const __m128i *>(code + off)))),
+          _mm512_loadu_ps(scale + off), _mm512_loadu_ps(vmin + off));
+      sum = Op::Apply(sum, _mm512_loadu_ps(q + off), decoded);
+    }
+    if (remainder > 0) {
+      alignas(16) uint8_t buffer[kFloatsPerAvx512F] = {};
+      std::copy_n(code + tail, remainder, buffer);
+      sum = Op::Apply(sum, _mm512_maskz_loadu_ps(mask, q + tail),
+                      decode(buffer, tail));
+    }
+    distances[i] = _mm512_reduce_add_ps(sum);
+  }
+}
+
+template <typename Op>
+auto GetDistancesFp16Avx512F(std::span<const Float> query,
+                             const uint16_t *codes, size_t n,
+                             Float *distances) -> void {
+  const size_t dim = query.size();
+  const size_t rounds = dim / kFloatsPerAvx512F;
+  const size_t remainder = dim % kFloatsPerAvx512F;
+  const __mmask16 mask = _cvtu32_mask16((1U << remainder) - 1);
+  const Float *q = query.data();
+  const size_t tail = rounds * kFloatsPerAvx512F;
+
+  for (size_t i = 0; i < n; ++i) {
+    const uint16_t *code = codes + (i * dim);
+    if (i + 1 < n) {
+      _mm_prefetch(reinterpret_cast<const char *>(code + dim), _MM_HINT_T0);
+    }
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t r = 0; r < rounds; ++r) {
+      const size_t off = r * kFloatsPerAvx512F;
+      const __m512 decoded = _mm512_cvtph_ps(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(code + off)));
+      sum = Op::Apply(sum, _mm512_loadu_ps(q + off), decoded);
+    }
+    if (remainder > 0) {
+      alignas(32) uint16_t buffer[kFloatsPerAvx512F] = {};
+      std::copy_n(code + tail, remainder, buffer);
+      const __m512 decoded = _mm512_cvtph_ps(
+          _mm256_load_si256(reinterpret_cast<const __m256i *>(buffer)));
+      sum = Op::Apply(sum, _mm512_maskz_loadu_ps(mask, q + tail), decoded);
+    }
+    distances[i] = _mm512_reduce_add_ps(sum);
+  }
+}
+
+}  // namespace
+
+const DistanceKernels kAvx512FDistanceKernels = {
+    .name = "avx512f",
+    .l2_sq = GetDistanceAvx512F<L2SqOp>,
+    .l2_sq_batch = GetDistancesAvx512F<L2SqOp>,
+    .dot = GetDistanceAvx512F<DotOp>,
+    .dot_batch = GetDistancesAvx512F<DotOp>,
+    .l1 = GetDistanceAvx512F<L1Op>,
+    .l1_batch = GetDistancesAvx512F<L1Op>,
+    .sq8_l2_sq_batch = GetDistancesSq8Avx512F<L2SqOp>,
+    .sq8_dot_batch = GetDistancesSq8Avx512F<DotOp>,
+    .sq8_l1_batch = GetDistancesSq8Avx512F<L1Op>,
+    .fp16_l2_sq_batch = GetDistancesFp16Avx512F<L2SqOp>,
+    .fp16_dot_batch = GetDistancesFp16Avx512F<DotOp>,
+    .fp16_l1_batch = GetDistancesFp16Avx512F<L1Op>,
+};
+
+}  // namespace rox
+
+#endif  // ROX_WITH_AVX512
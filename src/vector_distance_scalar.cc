@@ -0,0 +1,94 @@
+#include <cmath>
+
+#include "vector_distance.h"
+
+namespace rox {
+
+namespace {
+
+struct L2SqOp {
+  static auto Apply(Float acc, Float a, Float b) -> Float {
+    return acc + ((a - b) * (a - b));
+  }
+};
+
+struct DotOp {
+  static auto Apply(Float acc, Float a, Float b) -> Float {
+    return acc + (a * b);
+  }
+};
+
+struct L1Op {
+  static auto Apply(Float acc, Float a, Float b) -> Float {
+    return acc + std::abs(a - b);
+  }
+};
+
+template <typename Op>
+auto GetDistanceScalar(std::span<const Float> a, std::span<const Float> b)
+    -> Float {
+  Float result = 0.0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    result = Op::Apply(result, a[i], b[i]);
+  }
+  return result;
+}
+
+template <typename Op>
+auto GetDistancesScalar(std::span<const Float> query, const Float *vectors,
+                        size_t n, Float *distances) -> void {
+  const size_t dim = query.size();
+  for (size_t i = 0; i < n; ++i) {
+    distances[i] = GetDistanceScalar<Op>(query, {vectors + (i * dim), dim});
+  }
+}
+
+template <typename Op>
+auto GetDistancesSq8Scalar(std::span<const Float> query, const uint8_t *codes,
+                           size_t n, const Float *vmin, const Float *scale,
+                           Float *distances) -> void {
+  const size_t dim = query.size();
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t *code = codes + (i * dim);
+    Float result = 0.0;
+    for (size_t j = 0; j < dim; ++j) {
+      result = Op::Apply(result, query[j], vmin[j] + (code[j] * scale[j]));
+    }
+    distances[i] = result;
+  }
+}
+
+template <typename Op>
+auto GetDistancesFp16Scalar(std::span<const Float> query,
+                            const uint16_t *codes, size_t n, Float *distances)
+    -> void {
+  const size_t dim = query.size();
+  for (size_t i = 0; i < n; ++i) {
+    const uint16_t *code = codes + (i * dim);
+    Float result = 0.0;
+    for (size_t j = 0; j < dim; ++j) {
+      result = Op::Apply(result, query[j], HalfToFloat(code[j]));
+    }
+    distances[i] = result;
+  }
+}
+
+}  // namespace
+
+const DistanceKernels kScalarDistanceKernels = {
+    .name = "scalar",
+    .l2_sq = GetDistanceScalar<L2SqOp>,
+    .l2_sq_batch = GetDistancesScalar<L2SqOp>,
+    .dot = GetDistanceScalar<DotOp>,
+    .dot_batch = GetDistancesScalar<DotOp>,
+    .l1 = GetDistanceScalar<L1Op>,
+    .l1_batch = GetDistancesScalar<L1Op>,
+    .sq8_l2_sq_batch = GetDistancesSq8Scalar<L2SqOp>,
+    .sq8_dot_batch = GetDistancesSq8Scalar<DotOp>,
+    .sq8_l1_batch = GetDistancesSq8Scalar<L1Op>,
+    .fp16_l2_sq_batch = GetDistancesFp16Scalar<L2SqOp>,
+    .fp16_dot_batch = GetDistancesFp16Scalar<DotOp>,
+    .fp16_l1_batch = GetDistancesFp16Scalar<L1Op>,
+};
+
+}  // namespace rox
@@ -0,0 +1,118 @@
+#include "zone_map.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <variant>
+
+namespace rox {
+
+namespace {
+
+auto IsNan(const Scalar &value) noexcept -> bool {
+  const auto *d = std::get_if<double>(&value);
+  return d != nullptr && std::isnan(*d);
+}
+
+// Doubles are left to min and max, equal doubles may differ in bits
+auto HasBloom(const Scalar &value) noexcept -> bool {
+  return !std::holds_alternative<double>(value);
+}
+
+// FNV-1a of the type and bytes of value. std::hash may differ between
+// standard libraries.
+auto HashScalar(const Scalar &value) noexcept -> uint64_t {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  const auto add = [&](uint8_t byte) {
+    hash = (hash ^ byte) * 0x100000001B3ULL;
+  };
+  add(static_cast<uint8_t>(value.index()));
+  if (const auto *i = std::get_if<int>(&value)) {
+    const auto bits = static_cast<uint32_t>(*i);
+    for (int shift = 0; shift < 32; shift += 8) {
+      add(static_cast<uint8_t>(bits >> shift));
+    }
+  } else if (const auto *str = std::get_if<std::string>(&value)) {
+    for (const char c : *str) {
+      add(static_cast<uint8_t>(c));
+    }
+  }
+  return hash;
+}
+
+}  // namespace
+
+auto ZoneMap::GetBloomBits(const Scalar &value) noexcept
+    -> std::array<size_t, 2> {
+  constexpr const size_t kBits = kBloomWords * 64;
+  const uint64_t hash = HashScalar(value) * 0x9E3779B97F4A7C15ULL;
+  return {hash % kBits, (hash >> 32) % kBits};
+}
+
+auto ZoneMap::Add(size_t field, const Scalar &value) -> void {
+  if (field >= zones_.size()) {
+    zones_.resize(field + 1);
+  }
+  auto &zone = zones_[field];
+  if (IsNan(value)) {
+    zone.has_nan = true;
+    return;
+  }
+  if (!zone.min || value < *zone.min) {
+    zone.min = value;
+  }
+  if (!zone.max || *zone.max < value) {
+    zone.max = value;
+  }
+  if (HasBloom(value)) {
+    for (const auto bit : GetBloomBits(value)) {
+      zone.bloom[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+  }
+}
+
+auto ZoneMap::MayMatch(size_t field, const ScalarFilter &filter) const
+    -> bool {
+  if (field >= zones_.size()) {
+    return false;  // no record has the field
+  }
+  const auto &zone = zones_[field];
+  const auto &value = filter.value;
+  // NaNs only compare with values of other types, checked on their own
+  if (zone.has_nan &&
+      MatchFilter(std::numeric_limits<double>::quiet_NaN(), filter)) {
+    return true;
+  }
+  if (!zone.min) {
+    return false;
+  }
+  switch (filter.op) {
+    case ScalarFilter::Op::kEq: {
+      if (value < *zone.min || *zone.max < value) {
+        return false;
+      }
+      if (!HasBloom(value)) {
+        return true;
+      }
+      for (const auto bit : GetBloomBits(value)) {
+        if ((zone.bloom[bit / 64] & (uint64_t{1} << (bit % 64))) == 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case ScalarFilter::Op::kNe:
+      return *zone.min != *zone.max || *zone.min != value;
+    case ScalarFilter::Op::kGt:
+      return *zone.max > value;
+    case ScalarFilter::Op::kGe:
+      return *zone.max >= value;
+    case ScalarFilter::Op::kLt:
+      return *zone.min < value;
+    case ScalarFilter::Op::kLe:
+      return *zone.min <= value;
+  }
+  return true;
+}
+
+}  // namespace rox
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "roxdb/db.h"
+
+namespace rox {
+
+// Summary of the scalar fields of a set of records, to rule out filters that
+// none of them can match. Each field keeps the min and max of its values and
+// a small bloom filter of its ints and strings for equality filters. Values
+// are only ever added, so a zone map widens until it is rebuilt.
+class ZoneMap {
+ public:
+  constexpr static const size_t kBloomWords = 4;  // 256 bits per field
+
+  struct Zone {
+    std::optional<Scalar> min;
+    std::optional<Scalar> max;
+    bool has_nan = false;  // kept out of min and max, as they are unordered
+    std::array<uint64_t, kBloomWords> bloom{};
+  };  // struct Zone
+
+  ZoneMap() = default;
+  // Of zones as returned by GetZones, e.g. read back from storage
+  explicit ZoneMap(std::vector<Zone> zones) : zones_(std::move(zones)) {}
+
+  // Add the value of field of one record
+  auto Add(size_t field, const Scalar &value) -> void;
+  // False if no record added can match filter on field
+  auto MayMatch(size_t field, const ScalarFilter &filter) const -> bool;
+  auto GetZones() const noexcept -> std::span<const Zone> { return zones_; }
+
+ private:
+  std::vector<Zone> zones_;  // by schema position, records may lack fields
+
+  // The two bloom filter bits of value, the same across builds as zone maps
+  // are stored
+  static auto GetBloomBits(const Scalar &value) noexcept
+      -> std::array<size_t, 2>;
+};  // class ZoneMap
+
+}  // namespace rox
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <vector>
 
 #include "roxdb/db.h"
 
@@ -129,4 +130,186 @@ TEST(CRUD, Delete) {
     db.DeleteRecord(i);
     EXPECT_THROW(db.GetRecord(i), std::invalid_argument);
   }
-}
\ No newline at end of file
+}
+TEST(CRUD, BulkPut) {
+  rox::DbOptions options;
+  options.create_if_missing = true;
+  rox::Schema schema;
+  schema.AddScalarField("age", rox::ScalarField::Type::kInt)
+      .AddVectorField("v1", 2, 2);
+
+  rox::DB db("/tmp/roxdb", options, schema);
+  db.SetCentroids("v1", {{0.0, 0.0}, {10.0, 10.0}});
+
+  const size_t n_records = 100;
+  std::vector<rox::Record> records(n_records);
+  for (size_t i = 0; i < n_records; ++i) {
+    records[i].id = i;
+    records[i].scalars.emplace_back(static_cast<int>(i));
+    const auto x = static_cast<rox::Float>(i % 2 == 0 ? i % 5 : 10 + (i % 5));
+    records[i].vectors.push_back({x, x});
+  }
+  db.PutRecords(records);
+
+  for (size_t i = 0; i < n_records; ++i) {
+    auto record = db.GetRecord(i);
+    EXPECT_EQ(std::get<int>(record.scalars[0]), i);
+    EXPECT_EQ(record.vectors[0], records[i].vectors[0]);
+  }
+
+  // Batch assignment matches the nearest centroid
+  rox::Query q;
+  q.AddVector("v1", {11.0, 11.0});
+  q.WithLimit(n_records / 2);
+  auto results = db.KnnSearch(q, 1);
+  ASSERT_EQ(results.size(), n_records / 2);
+  for (const auto &result : results) {
+    EXPECT_EQ(result.id % 2, 1);
+  }
+
+  // A batch with a bad vector is rejected whole
+  std::vector<rox::Record> bad(2);
+  bad[0].id = n_records;
+  bad[0].scalars.emplace_back(0);
+  bad[0].vectors.push_back({1.0, 1.0});
+  bad[1].id = n_records + 1;
+  bad[1].scalars.emplace_back(0);
+  bad[1].vectors.push_back({1.0, 1.0, 1.0});
+  EXPECT_THROW(db.PutRecords(bad), std::invalid_argument);
+  EXPECT_THROW(db.GetRecord(n_records), std::invalid_argument);
+  // So is a single one
+  EXPECT_THROW(db.PutRecord(bad[1].id, bad[1]), std::invalid_argument);
+  bad[1].vectors.clear();
+  EXPECT_THROW(db.PutRecord(bad[1].id, bad[1]), std::invalid_argument);
+  EXPECT_THROW(db.GetRecord(bad[1].id), std::invalid_argument);
+}
+
+TEST(CRUD, Upsert) {
+  rox::DbOptions options;
+  options.create_if_missing = true;
+  rox::Schema schema;
+  schema.AddScalarField("age", rox::ScalarField::Type::kInt)
+      .AddVectorField("v1", 2, 2);
+
+  rox::DB db("/tmp/roxdb", options, schema);
+  db.SetCentroids("v1", {{0.0, 0.0}, {10.0, 10.0}});
+
+  const size_t n_records = 20;
+  for (size_t i = 0; i < n_records; ++i) {
+    rox::Record record;
+    record.id = i;
+    record.scalars.emplace_back(static_cast<int>(i));
+    record.vectors.push_back({static_cast<rox::Float>(i % 5), 0.0});
+    db.PutRecord(i, record);
+  }
+
+  // Move odd records to the other list, key 1 twice in the batch
+  std::vector<rox::Record> moved;
+  for (size_t i = 1; i < n_records; i += 2) {
+    rox::Record record;
+    record.id = i;
+    record.scalars.emplace_back(static_cast<int>(i));
+    record.vectors.push_back({10.0, static_cast<rox::Float>(i)});
+    moved.push_back(record);
+  }
+  moved.push_back(moved.front());
+  moved.back().vectors[0] = {10.0, 10.0};
+  db.PutRecords(moved);
+  // Only scalars of even records change
+  for (size_t i = 0; i < n_records; i += 2) {
+    auto record = db.GetRecord(i);
+    record.scalars[0] = static_cast<int>(100 + i);
+    db.PutRecord(i, record);
+  }
+  db.FlushRecords();
+
+  rox::Query q;
+  q.AddVector("v1", {10.0, 10.0});
+  q.WithLimit(n_records);
+  auto results = db.KnnSearch(q, 2);
+  ASSERT_EQ(results.size(), n_records);
+  std::vector<rox::Key> ids;
+  for (const auto &result : results) {
+    ids.push_back(result.id);
+  }
+  std::ranges::sort(ids);
+  EXPECT_EQ(std::ranges::adjacent_find(ids), ids.end());
+  EXPECT_EQ(results[0].id, 1);
+  EXPECT_EQ(db.GetRecord(1).vectors[0], rox::Vector({10.0, 10.0}));
+  EXPECT_EQ(std::get<int>(db.GetRecord(2).scalars[0]), 102);
+
+  // The nearest list holds exactly the moved records
+  results = db.KnnSearch(q, 1);
+  ASSERT_EQ(results.size(), n_records / 2);
+  for (const auto &result : results) {
+    EXPECT_EQ(result.id % 2, 1);
+  }
+}
+
+TEST(CRUD, LargeKeys) {
+  rox::DbOptions options;
+  options.create_if_missing = true;
+  rox::Schema schema;
+  schema.AddScalarField("age", rox::ScalarField::Type::kInt);
+
+  rox::DB db("/tmp/roxdb", options, schema);
+
+  // Keys are stored big-endian, check byte boundaries and extremes
+  const std::vector<rox::Key> keys = {255, 256, rox::Key{1} << 40,
+                                      ~rox::Key{0}};
+  for (size_t i = 0; i < keys.size(); ++i) {
+    rox::Record record;
+    record.id = keys[i];
+    record.scalars.emplace_back(static_cast<int>(i));
+    db.PutRecord(keys[i], record);
+  }
+  db.FlushRecords();
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto record = db.GetRecord(keys[i]);
+    EXPECT_EQ(record.id, keys[i]);
+    EXPECT_EQ(std::get<int>(record.scalars[0]), i);
+  }
+}
+
+TEST(CRUD, SmallRecordCache) {
+  rox::DbOptions options;
+  options.create_if_missing = true;
+  // Room for a few records per shard, and frequent write buffer flushes
+  options.record_cache_bytes = 64 * 1024;
+  options.write_buffer_bytes = 16 * 1024;
+  rox::Schema schema;
+  schema.AddScalarField("age", rox::ScalarField::Type::kInt)
+      .AddVectorField("vec", 64, 1);
+
+  rox::DB db("/tmp/roxdb", options, schema);
+  db.SetCentroids("vec", {rox::Vector(64, 0.0)});
+
+  const size_t n_records = 1000;
+  for (size_t i = 0; i < n_records; ++i) {
+    rox::Record record;
+    record.id = i;
+    record.scalars.emplace_back(static_cast<int>(i));
+    record.vectors.emplace_back(64, static_cast<rox::Float>(i));
+    db.PutRecord(i, record);
+  }
+
+  // Read twice, records are evicted and read back from storage
+  for (size_t round = 0; round < 2; ++round) {
+    for (size_t i = 0; i < n_records; ++i) {
+      auto record = db.GetRecord(i);
+      EXPECT_EQ(std::get<int>(record.scalars[0]), i);
+      EXPECT_EQ(record.vectors[0][63], static_cast<rox::Float>(i));
+    }
+  }
+
+  // Queries read through the cache too
+  rox::Query q;
+  q.AddVector("vec", rox::Vector(64, 500.0));
+  q.WithLimit(3);
+  for (size_t round = 0; round < 2; ++round) {
+    auto results = db.KnnSearch(q, 1);
+    ASSERT_EQ(results.size(), 3);
+    EXPECT_EQ(results[0].id, 500);
+  }
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <filesystem>
 #include <random>
 #include <vector>
 
@@ -113,3 +114,465 @@ TEST(KNN, SingleVectorWFilter) {
   EXPECT_EQ(results[0].id, gt[0].id);
   EXPECT_EQ(results[1].id, gt[1].id);
 }
+
+TEST(KNN, CosineMetric) {
+  if (std::filesystem::exists("/tmp/roxdb")) {
+    std::filesystem::remove_all("/tmp/roxdb");
+  }
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 4, rox::VectorField::Metric::kCosine);
+
+  rox::DbOptions options;
+  rox::DB db("/tmp/roxdb", options, schema);
+
+  const std::vector<rox::Vector> centroids = {
+      {1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+  db.SetCentroids("vec", centroids);
+
+  // Same directions as centroids, magnitudes growing with the key
+  const size_t n_records = 16;
+  for (size_t i = 0; i < n_records; ++i) {
+    const auto &centroid = centroids[i % 4];
+    const auto scale = static_cast<rox::Float>(i + 1);
+    rox::Record record;
+    record.id = i;
+    record.vectors.push_back({centroid[0] * scale + 0.01F * i,
+                              centroid[1] * scale + 0.01F * i});
+    db.PutRecord(i, record);
+  }
+  db.FlushRecords();
+
+  // Direction matters, magnitude does not
+  rox::Query q;
+  q.AddVector("vec", {0.0, 10.0});
+  q.WithLimit(4);
+  auto results = db.KnnSearch(q, 4);
+  auto gt = db.FullScan(q);
+  ASSERT_EQ(results.size(), 4);
+  ASSERT_EQ(gt.size(), 4);
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].id, gt[i].id);
+    EXPECT_EQ(results[i].id % 4, 1);
+  }
+}
+
+TEST(KNN, Hnsw) {
+  if (std::filesystem::exists("/tmp/roxdb")) {
+    std::filesystem::remove_all("/tmp/roxdb");
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<rox::Float> dist(-1.0, 1.0);
+
+  rox::Schema schema;
+  schema.AddHnswVectorField("vec", 4);
+
+  rox::DbOptions options;
+  rox::DB db("/tmp/roxdb", options, schema);
+
+  const size_t n_records = 256;
+  for (size_t i = 0; i < n_records; ++i) {
+    rox::Record record;
+    record.id = i;
+    record.vectors.push_back({dist(gen), dist(gen), dist(gen), dist(gen)});
+    db.PutRecord(i, record);
+  }
+  db.DeleteRecord(0);
+  db.FlushRecords();
+
+  rox::Query q;
+  q.AddVector("vec", {0.5, -0.5, 0.5, -0.5});
+  q.WithLimit(5);
+  auto results = db.KnnSearch(q);
+  auto gt = db.FullScan(q);
+  ASSERT_EQ(results.size(), 5);
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].id, gt[i].id);
+    EXPECT_NE(results[i].id, 0);
+  }
+}
+
+TEST(KNN, HnswRewrites) {
+  if (std::filesystem::exists("/tmp/roxdb")) {
+    std::filesystem::remove_all("/tmp/roxdb");
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<rox::Float> dist(-1.0, 1.0);
+
+  rox::Schema schema;
+  schema.AddHnswVectorField("vec", 4);
+
+  rox::DbOptions options;
+  rox::DB db("/tmp/roxdb", options, schema);
+
+  // Each round tombstones every node, rebuilding the graph along the way
+  const size_t n_records = 256;
+  for (size_t round = 0; round < 4; ++round) {
+    for (size_t i = 0; i < n_records; ++i) {
+      rox::Record record;
+      record.id = i;
+      record.vectors.push_back({dist(gen), dist(gen), dist(gen), dist(gen)});
+      db.PutRecord(i, record);
+    }
+  }
+  db.FlushRecords();
+
+  rox::Query q;
+  q.AddVector("vec", {0.5, -0.5, 0.5, -0.5});
+  q.WithLimit(5);
+  auto results = db.KnnSearch(q);
+  auto gt = db.FullScan(q);
+  ASSERT_EQ(results.size(), 5);
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].id, gt[i].id);
+  }
+}
+
+TEST(KNN, IvfPq) {
+  if (std::filesystem::exists("/tmp/roxdb")) {
+    std::filesystem::remove_all("/tmp/roxdb");
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<rox::Float> dist(-1.0, 1.0);
+
+  rox::Schema schema;
+  schema.AddIvfPqVectorField("vec", 4, 2, 2);
+
+  rox::DbOptions options;
+  rox::DB db("/tmp/roxdb", options, schema);
+  db.SetCentroids("vec", {{-0.5, -0.5, -0.5, -0.5}, {0.5, 0.5, 0.5, 0.5}});
+
+  // Too few vectors to train the quantizer, so search stays exact
+  const size_t n_records = 256;
+  for (size_t i = 0; i < n_records; ++i) {
+    rox::Record record;
+    record.id = i;
+    record.vectors.push_back({dist(gen), dist(gen), dist(gen), dist(gen)});
+    db.PutRecord(i, record);
+  }
+  db.DeleteRecord(0);
+  db.FlushRecords();
+
+  rox::Query q;
+  q.AddVector("vec", {0.5, -0.5, 0.5, -0.5});
+  q.WithLimit(5);
+  auto results = db.KnnSearch(q);
+  auto gt = db.FullScan(q);
+  ASSERT_EQ(results.size(), 5);
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].id, gt[i].id);
+    EXPECT_NE(results[i].id, 0);
+  }
+}
+
+TEST(KNN, ScalarQuantization) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<rox::Float> dist(-1.0, 1.0);
+
+  for (const auto quantization : {rox::VectorField::Quantization::kSq8,
+                                  rox::VectorField::Quantization::kFp16}) {
+    if (std::filesystem::exists("/tmp/roxdb")) {
+      std::filesystem::remove_all("/tmp/roxdb");
+    }
+    rox::Schema schema;
+    schema.AddVectorField("vec", 4, 1, rox::VectorField::Metric::kL2,
+                          quantization);
+
+    rox::DbOptions options;
+    rox::DB db("/tmp/roxdb", options, schema);
+
+    // Enough records to train the SQ8 ranges
+    const size_t n_records = 2048;
+    for (size_t i = 0; i < n_records; ++i) {
+      rox::Record record;
+      record.id = i;
+      record.vectors.push_back({dist(gen), dist(gen), dist(gen), dist(gen)});
+      db.PutRecord(i, record);
+    }
+    db.FlushRecords();
+
+    // Candidates are reranked with exact vectors
+    rox::Query q;
+    q.AddVector("vec", {0.5, -0.5, 0.5, -0.5});
+    q.WithLimit(5);
+    auto results = db.KnnSearch(q);
+    auto gt = db.FullScan(q);
+    ASSERT_EQ(results.size(), 5);
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].id, gt[i].id);
+    }
+  }
+  // The 4-dim records would be read by the next test
+  std::filesystem::remove_all("/tmp/roxdb");
+}
+
+TEST(KNN, TrainIndex) {
+  if (std::filesystem::exists("/tmp/roxdb")) {
+    std::filesystem::remove_all("/tmp/roxdb");
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<rox::Float> dist(-0.1, 0.1);
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 4);
+
+  rox::DbOptions options;
+  rox::DB db("/tmp/roxdb", options, schema);
+
+  // Vectors around four well separated points, centroids are learnt
+  const std::vector<rox::Vector> points = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+  const size_t n_records = 256;
+  for (size_t i = 0; i < n_records; ++i) {
+    const auto &point = points[i % 4];
+    rox::Record record;
+    record.id = i;
+    record.vectors.push_back({point[0] + dist(gen), point[1] + dist(gen)});
+    db.PutRecord(i, record);
+  }
+  db.TrainIndex("vec", 128, 10);
+
+  // A single probed cluster holds all the nearest vectors
+  for (const auto &point : points) {
+    rox::Query q;
+    q.AddVector("vec", point);
+    q.WithLimit(3);
+    auto results = db.KnnSearch(q, 1);
+    auto gt = db.FullScan(q);
+    ASSERT_EQ(results.size(), 3);
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].id, gt[i].id);
+    }
+  }
+  EXPECT_THROW(db.TrainIndex("missing"), std::invalid_argument);
+}
+
+TEST(KNN, DeleteAndReput) {
+  if (std::filesystem::exists("/tmp/roxdb")) {
+    std::filesystem::remove_all("/tmp/roxdb");
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<rox::Float> dist(-1.0, 1.0);
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 4);
+
+  rox::DbOptions options;
+  rox::DB db("/tmp/roxdb", options, schema);
+  db.SetCentroids("vec", {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}});
+
+  const size_t n_records = 64;
+  for (size_t i = 0; i < n_records; ++i) {
+    rox::Record record;
+    record.id = i;
+    record.vectors.push_back({dist(gen), dist(gen)});
+    db.PutRecord(i, record);
+  }
+  // Deleted keys leave tombstones, re-put keys move to their new list
+  for (size_t i = 0; i < n_records; i += 2) {
+    db.DeleteRecord(i);
+  }
+  for (size_t i = 1; i < n_records; i += 4) {
+    rox::Record record;
+    record.id = i;
+    record.vectors.push_back({dist(gen), dist(gen)});
+    db.PutRecord(i, record);
+  }
+  db.FlushRecords();
+
+  rox::Query q;
+  q.AddVector("vec", {0.2, -0.3});
+  q.WithLimit(n_records);
+  auto results = db.KnnSearch(q, 4);
+  auto gt = db.FullScan(q);
+  ASSERT_EQ(results.size(), n_records / 2);
+  ASSERT_EQ(gt.size(), n_records / 2);
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].id % 2, 1);
+    EXPECT_FLOAT_EQ(results[i].distance, gt[i].distance);
+  }
+}
+
+TEST(KNN, PreFilter) {
+  if (std::filesystem::exists("/tmp/roxdb")) {
+    std::filesystem::remove_all("/tmp/roxdb");
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<rox::Float> dist(-1.0, 1.0);
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 4);
+  schema.AddScalarField("category", rox::ScalarField::Type::kInt);
+
+  rox::DbOptions options;
+  options.scalar_columns = true;
+  rox::DB db("/tmp/roxdb", options, schema);
+  db.SetCentroids("vec", {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}});
+
+  const size_t n_records = 256;
+  const size_t n_categories = 16;
+  for (size_t i = 0; i < n_records; ++i) {
+    rox::Record record;
+    record.id = i;
+    record.vectors.push_back({dist(gen), dist(gen)});
+    record.scalars.emplace_back(static_cast<int>(i % n_categories));
+    db.PutRecord(i, record);
+  }
+  db.FlushRecords();
+
+  // All records of the category, whichever way the filter is applied
+  rox::Query q;
+  q.AddVector("vec", {0.2, -0.3});
+  q.AddScalarFilter("category", rox::ScalarFilter::Op::kEq, 5);
+  q.WithLimit(n_records);
+  auto results = db.KnnSearch(q, 4);
+  auto gt = db.FullScan(q);
+  ASSERT_EQ(results.size(), n_records / n_categories);
+  ASSERT_EQ(gt.size(), results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].id % n_categories, 5);
+    EXPECT_FLOAT_EQ(results[i].distance, gt[i].distance);
+  }
+
+  rox::Query none;
+  none.AddVector("vec", {0.2, -0.3});
+  none.AddScalarFilter("category", rox::ScalarFilter::Op::kGt, 100);
+  none.WithLimit(10);
+  EXPECT_TRUE(db.KnnSearch(none, 4).empty());
+}
+
+TEST(KNN, FilterPlan) {
+  if (std::filesystem::exists("/tmp/roxdb")) {
+    std::filesystem::remove_all("/tmp/roxdb");
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<rox::Float> dist(-1.0, 1.0);
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 4);
+  schema.AddScalarField("category", rox::ScalarField::Type::kInt);
+
+  rox::DbOptions options;
+  options.scalar_columns = true;
+  rox::DB db("/tmp/roxdb", options, schema);
+  db.SetCentroids("vec", {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}});
+
+  const size_t n_records = 256;
+  for (size_t i = 0; i < n_records; ++i) {
+    rox::Record record;
+    record.id = i;
+    record.vectors.push_back({dist(gen), dist(gen)});
+    record.scalars.emplace_back(static_cast<int>(i % 64));
+    db.PutRecord(i, record);
+  }
+  db.FlushRecords();
+
+  // Probing a single list would find about one of the 4 matches, the
+  // matching records are scored directly instead
+  rox::Query rare;
+  rare.AddVector("vec", {0.2, -0.3});
+  rare.AddScalarFilter("category", rox::ScalarFilter::Op::kEq, 5);
+  rare.WithLimit(4);
+  auto results = db.KnnSearch(rare, 1);
+  auto gt = db.FullScan(rare);
+  ASSERT_EQ(results.size(), 4);
+  ASSERT_EQ(gt.size(), 4);
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].id, gt[i].id);
+    EXPECT_FLOAT_EQ(results[i].distance, gt[i].distance);
+  }
+
+  // nprobe is widened until the probed lists hold enough matches
+  rox::Query common;
+  common.AddVector("vec", {0.2, -0.3});
+  common.AddScalarFilter("category", rox::ScalarFilter::Op::kLt, 16);
+  common.WithLimit(10);
+  results = db.KnnSearch(common, 1);
+  ASSERT_EQ(results.size(), 10);
+  for (const auto &result : results) {
+    EXPECT_LT(result.id % 64, 16);
+  }
+}
+
+TEST(KNN, ZoneMaps) {
+  if (std::filesystem::exists("/tmp/roxdb")) {
+    std::filesystem::remove_all("/tmp/roxdb");
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<rox::Float> dist(0.2, 0.8);
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 4);
+  schema.AddScalarField("quadrant", rox::ScalarField::Type::kInt);
+
+  // Each list holds the records of one quadrant
+  rox::Query query;
+  query.AddVector("vec", {-0.9, -0.9});
+  query.AddScalarFilter("quadrant", rox::ScalarFilter::Op::kEq, 3);
+  query.WithLimit(4);
+  auto check = [&](rox::DB &db) {
+    // The nearest list has no match and is skipped for the next ones
+    const auto results = db.KnnSearch(query, 1);
+    const auto gt = db.FullScan(query);
+    ASSERT_EQ(results.size(), 4);
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].id, gt[i].id);
+    }
+  };
+
+  {
+    rox::DbOptions options;
+    options.scalar_columns = true;
+    rox::DB db("/tmp/roxdb", options, schema);
+    db.SetCentroids("vec", {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}});
+    for (size_t i = 0; i < 256; ++i) {
+      const int quadrant = static_cast<int>(i % 4);
+      rox::Record record;
+      record.id = i;
+      record.vectors.push_back({(quadrant & 2) != 0 ? dist(gen) : -dist(gen),
+                                (quadrant & 1) != 0 ? dist(gen) : -dist(gen)});
+      record.scalars.emplace_back(quadrant);
+      db.PutRecord(i, record);
+    }
+    db.FlushRecords();
+    check(db);
+
+    // A record changing quadrant but not vector widens its list's zone map
+    auto record = db.GetRecord(0);
+    record.scalars[0] = 3;
+    db.PutRecord(0, record);
+    const auto results = db.KnnSearch(query, 1);
+    ASSERT_FALSE(results.empty());
+    EXPECT_EQ(results.front().id, db.FullScan(query).front().id);
+    record.scalars[0] = 0;
+    db.PutRecord(0, record);
+  }
+
+  {
+    // Zone maps are read with the centroids
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    options.scalar_columns = true;
+    rox::DB db("/tmp/roxdb", options);
+    check(db);
+  }
+
+  {
+    // Without scalar columns, a write drops the saved zone maps
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db("/tmp/roxdb", options);
+    auto record = db.GetRecord(0);
+    record.scalars[0] = 3;
+    db.PutRecord(0, record);
+  }
+
+  {
+    // Zone maps are rebuilt as lists are loaded
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    options.scalar_columns = true;
+    rox::DB db("/tmp/roxdb", options);
+    const auto results = db.KnnSearch(query, 1);
+    ASSERT_FALSE(results.empty());
+    EXPECT_EQ(results.front().id, 0);
+  }
+}
@@ -1,8 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <filesystem>
 #include <vector>
 
+#include <rocksdb/db.h>
+
 #include "roxdb/db.h"
 
 TEST(Persistency, ScalarPersistency) {
@@ -127,4 +131,712 @@ TEST(Persistency, VectorPersistency) {
   }
 
   std::filesystem::remove_all(kPath);
-}
\ No newline at end of file
+}
+
+TEST(Persistency, HnswPersistency) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  rox::Schema schema;
+  schema.AddHnswVectorField("vec", 3, rox::VectorField::Metric::kL2, 4, 16);
+
+  rox::Query query;
+  query.AddVector("vec", {1.0, 2.0, 3.0});
+  query.WithLimit(3);
+
+  std::vector<rox::QueryResult> expected;
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    rox::DB db(kPath, options, schema);
+
+    const size_t n_records = 64;
+    for (size_t i = 0; i < n_records; ++i) {
+      rox::Record record;
+      record.id = i;
+      const auto x = static_cast<rox::Float>(i);
+      record.vectors.push_back({x, x * 0.5F, -x});
+      db.PutRecord(i, record);
+    }
+    db.DeleteRecord(1);
+    expected = db.KnnSearch(query);
+  }
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+
+    auto results = db.KnnSearch(query);
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].id, expected[i].id);
+      EXPECT_NE(results[i].id, 1);
+    }
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, IvfSqPersistency) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 3, 1, rox::VectorField::Metric::kL2,
+                        rox::VectorField::Quantization::kSq8);
+
+  rox::Query query;
+  query.AddVector("vec", {1.0, 2.0, 3.0});
+  query.WithLimit(3);
+
+  std::vector<rox::QueryResult> expected;
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    rox::DB db(kPath, options, schema);
+
+    // Enough records to train the SQ8 ranges
+    const size_t n_records = 1100;
+    for (size_t i = 0; i < n_records; ++i) {
+      rox::Record record;
+      record.id = i;
+      const auto x = static_cast<rox::Float>(i) * 0.01F;
+      record.vectors.push_back({x, x * 0.5F, -x});
+      db.PutRecord(i, record);
+    }
+    db.DeleteRecord(100);
+    expected = db.KnnSearch(query);
+  }
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+
+    auto results = db.KnnSearch(query);
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].id, expected[i].id);
+      EXPECT_NE(results[i].id, 100);
+    }
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, BulkLoad) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  const size_t n_records = 100;
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    options.bulk_load = true;
+    rox::Schema schema;
+    schema.AddScalarField("int", rox::ScalarField::Type::kInt)
+        .AddVectorField("vec", 2, 2);
+
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec", {{0.0, 0.0}, {10.0, 10.0}});
+
+    std::vector<rox::Record> records(n_records);
+    for (size_t i = 0; i < n_records; ++i) {
+      records[i].id = i;
+      records[i].scalars.emplace_back(static_cast<int>(i));
+      const auto x = static_cast<rox::Float>(i % 2 == 0 ? 0 : 10);
+      records[i].vectors.push_back({x, x});
+    }
+    db.PutRecords(records);
+    // Later puts of a key win
+    db.PutRecord(0, records[1]);
+  }
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+
+    for (size_t i = 1; i < n_records; ++i) {
+      auto record = db.GetRecord(i);
+      EXPECT_EQ(std::get<int>(record.scalars[0]), i);
+    }
+    EXPECT_EQ(std::get<int>(db.GetRecord(0).scalars[0]), 1);
+
+    rox::Query q;
+    q.AddVector("vec", {10.0, 10.0});
+    q.WithLimit(n_records / 2);
+    auto results = db.KnnSearch(q, 1);
+    EXPECT_EQ(results.size(), n_records / 2);
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, BulkLoadDelete) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  const size_t n_records = 100;
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    options.bulk_load = true;
+    rox::Schema schema;
+    schema.AddScalarField("int", rox::ScalarField::Type::kInt)
+        .AddVectorField("vec", 2, 2);
+
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec", {{0.0, 0.0}, {10.0, 10.0}});
+
+    std::vector<rox::Record> records(n_records);
+    for (size_t i = 0; i < n_records; ++i) {
+      records[i].id = i;
+      records[i].scalars.emplace_back(static_cast<int>(i));
+      records[i].vectors.push_back({0.0, 0.0});
+    }
+    // Written to SST files that are not ingested yet
+    db.PutRecords(records);
+    db.DeleteRecord(0);
+    // Moves to the other list, replacing its posting
+    records[1].vectors[0] = {10.0, 10.0};
+    db.PutRecord(1, records[1]);
+    db.FlushRecords();
+  }
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+    EXPECT_THROW(db.GetRecord(0), std::invalid_argument);
+
+    rox::Query q;
+    q.AddVector("vec", {0.0, 0.0});
+    q.WithLimit(n_records);
+    auto results = db.KnnSearch(q, 2);
+    EXPECT_EQ(results.size(), n_records - 1);
+    EXPECT_EQ(std::ranges::count(results, rox::Key{1}, &rox::QueryResult::id),
+              1);
+    EXPECT_EQ(std::ranges::count(results, rox::Key{0}, &rox::QueryResult::id),
+              0);
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, LazyIvfLists) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 4);
+
+  rox::Query query;
+  query.AddVector("vec", {10.0, 0.0});
+  query.WithLimit(5);
+
+  std::vector<rox::QueryResult> expected;
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec",
+                    {{0.0, 0.0}, {10.0, 0.0}, {0.0, 10.0}, {10.0, 10.0}});
+
+    const size_t n_records = 400;
+    for (size_t i = 0; i < n_records; ++i) {
+      rox::Record record;
+      record.id = i;
+      record.vectors.push_back({static_cast<rox::Float>(i % 20),
+                                static_cast<rox::Float>(i / 20)});
+      db.PutRecord(i, record);
+    }
+    expected = db.KnnSearch(query, 4);
+    ASSERT_EQ(expected.size(), 5);
+  }
+
+  // Lists are loaded on first search, writes load the lists they touch
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+
+    auto results = db.KnnSearch(query, 4);
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].id, expected[i].id);
+    }
+    db.DeleteRecord(expected[0].id);
+    rox::Record moved;
+    moved.id = expected[1].id;
+    moved.vectors.push_back({0.0, 10.0});
+    db.PutRecord(moved.id, moved);
+  }
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    options.warm_up_indexes = true;
+    rox::DB db(kPath, options);
+
+    auto results = db.KnnSearch(query, 4);
+    ASSERT_EQ(results.size(), expected.size());
+    for (const auto& result : results) {
+      EXPECT_NE(result.id, expected[0].id);
+      EXPECT_NE(result.id, expected[1].id);
+    }
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, IndexSegments) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 2);
+
+  rox::Query query;
+  query.AddVector("vec", {3.0, 3.0});
+  query.WithLimit(4);
+
+  std::vector<rox::QueryResult> expected;
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    options.index_segments = true;
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec", {{0.0, 0.0}, {10.0, 10.0}});
+
+    const size_t n_records = 100;
+    for (size_t i = 0; i < n_records; ++i) {
+      rox::Record record;
+      record.id = i;
+      const auto x = static_cast<rox::Float>(i % 10);
+      record.vectors.push_back({x, static_cast<rox::Float>(i / 10)});
+      db.PutRecord(i, record);
+    }
+    expected = db.KnnSearch(query, 2);
+  }
+  EXPECT_TRUE(std::filesystem::exists(std::string(kPath) + "/ivf-vec.seg"));
+
+  // The segment is mapped and searched in place, then copied on write
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    options.index_segments = true;
+    rox::DB db(kPath, options);
+
+    auto results = db.KnnSearch(query, 2);
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].id, expected[i].id);
+    }
+    db.DeleteRecord(expected[0].id);
+    rox::Record moved;
+    moved.id = expected[1].id;
+    moved.vectors.push_back({0.0, 10.0});
+    db.PutRecord(moved.id, moved);
+  }
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+
+    auto results = db.KnnSearch(query, 2);
+    ASSERT_EQ(results.size(), expected.size());
+    for (const auto& result : results) {
+      EXPECT_NE(result.id, expected[0].id);
+    }
+    // Saved back into RocksDB values
+    db.DeleteRecord(expected[1].id);
+  }
+  EXPECT_FALSE(std::filesystem::exists(std::string(kPath) + "/ivf-vec.seg"));
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, IncrementalIndexSave) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 2);
+
+  auto put = [](rox::DB& db, size_t key, rox::Float x) {
+    rox::Record record;
+    record.id = key;
+    record.vectors.push_back({x, x});
+    db.PutRecord(key, record);
+  };
+  auto search = [](rox::DB& db, rox::Float x) {
+    rox::Query query;
+    query.AddVector("vec", {x, x});
+    query.WithLimit(1);
+    return db.KnnSearch(query, 2);
+  };
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    options.checkpoint_interval = 10;
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec", {{0.0, 0.0}, {10.0, 10.0}});
+    for (size_t i = 0; i < 20; ++i) {
+      put(db, i, static_cast<rox::Float>(i));
+    }
+  }
+
+  // Only the partition of the changed list is rewritten
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+    put(db, 100, 100.0);
+    db.DeleteRecord(0);
+    db.Checkpoint();
+    put(db, 101, -100.0);
+  }
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+    EXPECT_EQ(search(db, 100.0)[0].id, 100);
+    EXPECT_EQ(search(db, -100.0)[0].id, 101);
+    EXPECT_EQ(search(db, 0.0)[0].id, 1);
+    EXPECT_EQ(search(db, 5.0)[0].id, 5);
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, DurableWrites) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 1);
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    rox::DB db(kPath, options, schema);
+  }
+
+  // Exit without closing the database, as in a crash
+  EXPECT_EXIT(
+      {
+        rox::DbOptions options;
+        options.create_if_missing = false;
+        options.durable_writes = true;
+        auto* db = new rox::DB(kPath, options);
+        for (size_t i = 0; i < 10; ++i) {
+          rox::Record record;
+          record.id = i;
+          const auto x = static_cast<rox::Float>(i);
+          record.vectors.push_back({x, x});
+          db->PutRecord(i, record);
+        }
+        db->DeleteRecord(3);
+        std::_Exit(0);
+      },
+      ::testing::ExitedWithCode(0), "");
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+
+    rox::Query query;
+    query.AddVector("vec", {3.0, 3.0});
+    query.WithLimit(3);
+    auto results = db.KnnSearch(query);
+    ASSERT_EQ(results.size(), 3);
+    for (const auto& result : results) {
+      EXPECT_NE(result.id, 3);
+      EXPECT_EQ(db.GetRecord(result.id).id, result.id);
+    }
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, DurableCentroids) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  rox::Schema schema;
+  schema.AddVectorField("vec", 2, 2);
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    rox::DB db(kPath, options, schema);
+  }
+
+  // Centroids set before a crash are kept, with the postings replayed
+  EXPECT_EXIT(
+      {
+        rox::DbOptions options;
+        options.create_if_missing = false;
+        options.durable_writes = true;
+        auto* db = new rox::DB(kPath, options);
+        db->SetCentroids("vec", {{0.0, 0.0}, {10.0, 10.0}});
+        for (size_t i = 0; i < 10; ++i) {
+          rox::Record record;
+          record.id = i;
+          const auto x = static_cast<rox::Float>(i % 2 == 0 ? 0 : 10);
+          record.vectors.push_back({x, x});
+          db->PutRecord(i, record);
+        }
+        std::_Exit(0);
+      },
+      ::testing::ExitedWithCode(0), "");
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+
+    // Only the list of the records near the query is probed
+    rox::Query query;
+    query.AddVector("vec", {10.0, 10.0});
+    query.WithLimit(10);
+    auto results = db.KnnSearch(query, 1);
+    ASSERT_EQ(results.size(), 5);
+    for (const auto& result : results) {
+      EXPECT_EQ(result.id % 2, 1);
+    }
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, ReplayLoadsTouchedLists) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  // List 0 fills a partition of its own, list 1 is in the next one
+  constexpr const size_t kDim = 256;
+  const size_t n_records = 16400;
+  auto make_record = [&](rox::Key key, rox::Float x) {
+    rox::Record record;
+    record.id = key;
+    record.vectors.emplace_back(kDim, 0.0F);
+    record.vectors[0][0] = x;
+    return record;
+  };
+  rox::Schema schema;
+  schema.AddVectorField("vec", kDim, 2);
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec", {rox::Vector(kDim, 0.0), rox::Vector(kDim, 10.0)});
+    std::vector<rox::Record> records;
+    for (size_t i = 0; i < n_records; ++i) {
+      records.push_back(make_record(i, static_cast<rox::Float>(i) * 1e-3F));
+    }
+    records.push_back(make_record(n_records, 0.0));
+    records.back().vectors[0].assign(kDim, 10.0);
+    db.PutRecords(records);
+  }
+
+  // Changes to list 0 only, logged but not saved in the index
+  EXPECT_EXIT(
+      {
+        rox::DbOptions options;
+        options.create_if_missing = false;
+        options.durable_writes = true;
+        auto* db = new rox::DB(kPath, options);
+        db->DeleteRecord(0);
+        db->PutRecord(5, make_record(5, -1.0));
+        db->PutRecord(n_records + 1, make_record(n_records + 1, -2.0));
+        std::_Exit(0);
+      },
+      ::testing::ExitedWithCode(0), "");
+
+  // Without list 1, loading its partition would fail
+  {
+    rocksdb::Options options;
+    std::vector<std::string> names;
+    ASSERT_TRUE(rocksdb::DB::ListColumnFamilies(options, kPath, &names).ok());
+    std::vector<rocksdb::ColumnFamilyDescriptor> descriptors;
+    for (const auto& name : names) {
+      descriptors.emplace_back(name, rocksdb::ColumnFamilyOptions());
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::DB* db = nullptr;
+    ASSERT_TRUE(
+        rocksdb::DB::Open(options, kPath, descriptors, &handles, &db).ok());
+    for (auto* handle : handles) {
+      if (handle->GetName() == "indexes") {
+        EXPECT_TRUE(
+            db->Delete(rocksdb::WriteOptions(), handle, "i:vec:1").ok());
+      }
+      EXPECT_TRUE(db->DestroyColumnFamilyHandle(handle).ok());
+    }
+    delete db;
+  }
+
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    rox::DB db(kPath, options);
+    auto nearest = [&](rox::Float x) {
+      rox::Query query;
+      query.AddVector("vec", make_record(0, x).vectors[0]);
+      query.WithLimit(1);
+      const auto results = db.KnnSearch(query, 1);
+      return results.empty() ? n_records + 2 : results.front().id;
+    };
+    EXPECT_EQ(nearest(0.0), 1);
+    EXPECT_EQ(nearest(-1.0), 5);
+    EXPECT_EQ(nearest(-2.0), n_records + 1);
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, SavedZoneMaps) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  // List 0 fills a partition of its own, list 1 is in the next one
+  constexpr const size_t kDim = 256;
+  const size_t n_records = 16400;
+  auto make_record = [&](rox::Key key, rox::Float x, int tag) {
+    rox::Record record;
+    record.id = key;
+    record.vectors.emplace_back(kDim, x);
+    record.scalars.emplace_back(tag);
+    return record;
+  };
+  rox::Schema schema;
+  schema.AddVectorField("vec", kDim, 2);
+  schema.AddScalarField("tag", rox::ScalarField::Type::kInt);
+  {
+    rox::DbOptions options;
+    options.create_if_missing = true;
+    options.scalar_columns = true;
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec", {rox::Vector(kDim, 0.0), rox::Vector(kDim, 10.0)});
+    std::vector<rox::Record> records;
+    for (size_t i = 0; i < n_records; ++i) {
+      records.push_back(
+          make_record(i, static_cast<rox::Float>(i) * 1e-4F, 0));
+    }
+    records.push_back(make_record(n_records, 10.0, 1));
+    db.PutRecords(records);
+  }
+
+  // Without list 1, loading its partition would fail
+  {
+    rocksdb::Options options;
+    std::vector<std::string> names;
+    ASSERT_TRUE(rocksdb::DB::ListColumnFamilies(options, kPath, &names).ok());
+    std::vector<rocksdb::ColumnFamilyDescriptor> descriptors;
+    for (const auto& name : names) {
+      descriptors.emplace_back(name, rocksdb::ColumnFamilyOptions());
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::DB* db = nullptr;
+    ASSERT_TRUE(
+        rocksdb::DB::Open(options, kPath, descriptors, &handles, &db).ok());
+    for (auto* handle : handles) {
+      if (handle->GetName() == "indexes") {
+        EXPECT_TRUE(
+            db->Delete(rocksdb::WriteOptions(), handle, "i:vec:1").ok());
+      }
+      EXPECT_TRUE(db->DestroyColumnFamilyHandle(handle).ok());
+    }
+    delete db;
+  }
+
+  {
+    // The zone map of list 1 rules it out without loading it
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    options.scalar_columns = true;
+    rox::DB db(kPath, options);
+    rox::Query query;
+    query.AddVector("vec", rox::Vector(kDim, 10.0));
+    query.AddScalarFilter("tag", rox::ScalarFilter::Op::kEq, 0);
+    query.WithLimit(1);
+    const auto results = db.KnnSearch(query, 1);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(results.front().id, n_records - 1);
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Persistency, StorageProfile) {
+  constexpr const char* kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+
+  const size_t n_records = 64;
+  {
+    rox::DbOptions options;
+    options.block_cache_bytes = 0;
+    options.bloom_bits_per_key = 0;
+    rox::Schema schema;
+    schema.AddScalarField("int", rox::ScalarField::Type::kInt)
+        .AddVectorField("vec", 2, 2);
+
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec", {{0.0, 0.0}, {1.0, 1.0}});
+    for (size_t i = 0; i < n_records; ++i) {
+      rox::Record record;
+      record.id = i;
+      record.scalars.emplace_back(static_cast<int>(i));
+      record.vectors.push_back({static_cast<rox::Float>(i % 2), 0.5});
+      db.PutRecord(i, record);
+    }
+  }
+
+  // Records and indexes are found in their column families with other
+  // table options
+  {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    options.block_size = size_t{4} << 10;
+    options.max_background_jobs = 2;
+    rox::DB db(kPath, options);
+    for (size_t i = 0; i < n_records; ++i) {
+      EXPECT_EQ(std::get<int>(db.GetRecord(i).scalars[0]), i);
+    }
+    rox::Query q;
+    q.AddVector("vec", {1.0, 0.5});
+    q.WithLimit(n_records);
+    EXPECT_EQ(db.KnnSearch(q, 2).size(), n_records);
+  }
+
+  std::filesystem::remove_all(kPath);
+}
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <filesystem>
+#include <string>
 #include <vector>
 
 TEST(Scan, SingleVectorScan) {
@@ -171,3 +172,188 @@ TEST(Scan, MultiVectorScan) {
     EXPECT_EQ(results[i].id, records[i].id);
   }
 }
+
+TEST(Scan, ScalarColumns) {
+  const std::string kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+  rox::Schema schema;
+  schema.AddScalarField("i", rox::ScalarField::Type::kInt)
+      .AddScalarField("d", rox::ScalarField::Type::kDouble)
+      .AddScalarField("s", rox::ScalarField::Type::kString)
+      .AddVectorField("vec", 2, 1);
+  auto make_record = [](rox::Key key, int value) {
+    rox::Record record;
+    record.id = key;
+    record.scalars.emplace_back(value % 7);
+    record.scalars.emplace_back(value * 0.5);
+    record.scalars.emplace_back(std::string(1, "abcde"[value % 5]));
+    record.vectors.push_back({static_cast<float>(key), 0.0F});
+    return record;
+  };
+
+  std::vector<rox::Query> queries(4);
+  queries[0].AddScalarFilter("i", rox::ScalarFilter::Op::kEq, 3);
+  queries[1]
+      .AddScalarFilter("i", rox::ScalarFilter::Op::kGe, 2)
+      .AddScalarFilter("d", rox::ScalarFilter::Op::kLt, 40.0);
+  queries[2].AddScalarFilter("s", rox::ScalarFilter::Op::kGt, std::string("b"));
+  queries[3]
+      .AddScalarFilter("s", rox::ScalarFilter::Op::kNe, std::string("c"))
+      .AddScalarFilter("d", rox::ScalarFilter::Op::kGe, 10.0);
+
+  // Keys of the records in records matching query, in scan order
+  std::vector<rox::Record> records;
+  auto expected = [&](const rox::Query& query) {
+    std::vector<rox::Key> keys;
+    for (const auto& record : records) {
+      if (std::ranges::all_of(query.filters, [&](const auto& filter) {
+            return rox::ApplyFilter(schema, record, filter);
+          })) {
+        keys.push_back(record.id);
+      }
+    }
+    return keys;
+  };
+  auto check = [&](rox::DB& db) {
+    for (auto query : queries) {
+      query.AddVector("vec", {0.0F, 0.0F}).WithLimit(records.size());
+      std::vector<rox::Key> keys;
+      for (const auto& result : db.FullScan(query)) {
+        keys.push_back(result.id);
+      }
+      std::ranges::sort(keys);
+      EXPECT_EQ(keys, expected(query));
+    }
+  };
+
+  {
+    rox::DbOptions options;
+    options.scalar_columns = true;
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec", {{0.0F, 0.0F}});
+    for (rox::Key key = 0; key < 100; ++key) {
+      records.push_back(make_record(key, static_cast<int>(key)));
+    }
+    db.PutRecords(records);
+    // Updated and deleted records leave the filters
+    for (rox::Key key = 0; key < 100; key += 3) {
+      records[key] = make_record(key, static_cast<int>(key) + 1);
+      db.PutRecord(key, records[key]);
+    }
+    for (rox::Key key = 0; key < 100; key += 10) {
+      db.DeleteRecord(key);
+    }
+    std::erase_if(records,
+                  [](const auto& record) { return record.id % 10 == 0; });
+    db.FlushRecords();
+    check(db);
+  }
+
+  {
+    // Columns are rebuilt from the stored records
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    options.scalar_columns = true;
+    rox::DB db(kPath, options);
+    check(db);
+  }
+
+  std::filesystem::remove_all(kPath);
+}
+
+TEST(Scan, ScalarIndex) {
+  const std::string kPath = "/tmp/roxdb";
+  if (std::filesystem::exists(kPath)) {
+    std::filesystem::remove_all(kPath);
+  }
+  rox::Schema schema;
+  schema.AddScalarField("i", rox::ScalarField::Type::kInt, true)
+      .AddScalarField("d", rox::ScalarField::Type::kDouble, true)
+      .AddScalarField("s", rox::ScalarField::Type::kString, true)
+      .AddScalarField("u", rox::ScalarField::Type::kInt)
+      .AddVectorField("vec", 2, 1);
+  auto make_record = [](rox::Key key, int value) {
+    rox::Record record;
+    record.id = key;
+    record.scalars.emplace_back((value % 7) - 3);
+    record.scalars.emplace_back((value - 50) * 0.5);
+    record.scalars.emplace_back(std::string(value % 3, "abcde"[value % 5]));
+    record.scalars.emplace_back(value % 2);
+    record.vectors.push_back({static_cast<float>(key), 0.0F});
+    return record;
+  };
+
+  std::vector<std::vector<rox::ScalarFilter>> filters = {
+      {{"i", rox::ScalarFilter::Op::kEq, -2}},
+      {{"i", rox::ScalarFilter::Op::kGe, 1},
+       {"u", rox::ScalarFilter::Op::kEq, 0}},
+      {{"d", rox::ScalarFilter::Op::kLt, -10.0}},
+      {{"d", rox::ScalarFilter::Op::kGt, 0.0},
+       {"i", rox::ScalarFilter::Op::kNe, 0}},
+      {{"s", rox::ScalarFilter::Op::kLe, std::string("c")}},
+      {{"s", rox::ScalarFilter::Op::kEq, std::string("dd")}},
+      {{"u", rox::ScalarFilter::Op::kEq, 1}},
+  };
+
+  // Keys of the records in records matching filter, in ascending order
+  std::vector<rox::Record> records;
+  auto expected = [&](const std::vector<rox::ScalarFilter>& filter) {
+    std::vector<rox::Key> keys;
+    for (const auto& record : records) {
+      if (std::ranges::all_of(filter, [&](const auto& f) {
+            return rox::ApplyFilter(schema, record, f);
+          })) {
+        keys.push_back(record.id);
+      }
+    }
+    return keys;
+  };
+  auto check = [&](rox::DB& db) {
+    for (const auto& filter : filters) {
+      EXPECT_EQ(db.FindRecords(filter), expected(filter));
+
+      rox::Query query;
+      query.AddVector("vec", {0.0F, 0.0F}).WithLimit(10);
+      query.filters = filter;
+      std::vector<rox::Key> keys;
+      for (const auto& result : db.KnnSearch(query, 1)) {
+        keys.push_back(result.id);
+      }
+      auto matches = expected(filter);
+      matches.resize(std::min<size_t>(matches.size(), 10));
+      EXPECT_EQ(keys, matches);
+    }
+  };
+
+  {
+    rox::DbOptions options;
+    options.scalar_columns = false;
+    rox::DB db(kPath, options, schema);
+    db.SetCentroids("vec", {{0.0F, 0.0F}});
+    for (rox::Key key = 0; key < 100; ++key) {
+      records.push_back(make_record(key, static_cast<int>(key)));
+    }
+    db.PutRecords(records);
+    // Updated and deleted records move out of the index
+    for (rox::Key key = 0; key < 100; key += 3) {
+      records[key] = make_record(key, static_cast<int>(key) + 1);
+      db.PutRecord(key, records[key]);
+    }
+    for (rox::Key key = 0; key < 100; key += 10) {
+      db.DeleteRecord(key);
+    }
+    std::erase_if(records,
+                  [](const auto& record) { return record.id % 10 == 0; });
+    check(db);
+  }
+
+  for (const bool scalar_columns : {false, true}) {
+    rox::DbOptions options;
+    options.create_if_missing = false;
+    options.scalar_columns = scalar_columns;
+    rox::DB db(kPath, options);
+    check(db);
+  }
+}